@@ -42,11 +42,22 @@ public:
 
 	void SendRequestToHub(const FHubServiceAction& Key) const;
 
+	// Serialization moved to worker thread, useful for big or frequent requests
 	template <typename T>
-	typename FCallbackMessageHandle<T>::FOnCallback& GetBindedHandle();
+	TFuture<EHubSendResult> SendRequestToHubAsync(const FHubServiceAction& Key, T&& InStructure) const;
+
+	// Correlated request, answer comes to the future instead of binded handles
+	template <typename TResponse, typename TRequest>
+	TFuture<THubRequestResult<TResponse>> RequestFromHub(const TRequest& InStructure, float TimeoutSeconds = 0.0f) const;
+
+	template <typename TResponse, typename TRequest>
+	TFuture<THubRequestResult<TResponse>> RequestFromHub(const FHubServiceAction& Key, const TRequest& InStructure, float TimeoutSeconds = 0.0f) const;
+
+	template <typename T>
+	typename FCallbackMessageHandle<T>::FOnCallback& GetBindedHandle(EHubDecodeThread DecodeThread = EHubDecodeThread::GameThread);
 
 	template <typename T>
-	typename FCallbackMessageHandle<T>::FOnCallback& BindHandle(const FHubServiceAction& Key);
+	typename FCallbackMessageHandle<T>::FOnCallback& BindHandle(const FHubServiceAction& Key, EHubDecodeThread DecodeThread = EHubDecodeThread::GameThread);
 
 	FCallbackErrorHandle::FOnError& GetBindedErrorHandle() const;
 	FCallbackErrorHandle::FOnError& GetBindedErrorHandle(const FHubServiceAction& Key) const;
@@ -88,19 +99,36 @@ void UBFHubService_Base::SendRequestToHub(const FHubServiceAction& Key, const T&
 	SocketSystem->Send(Key, InStructure);
 }
 
+template <typename T>
+TFuture<EHubSendResult> UBFHubService_Base::SendRequestToHubAsync(const FHubServiceAction& Key, T&& InStructure) const
+{
+	return SocketSystem->SendAsync(Key, Forward<T>(InStructure));
+}
+
+template <typename TResponse, typename TRequest>
+TFuture<THubRequestResult<TResponse>> UBFHubService_Base::RequestFromHub(const TRequest& InStructure, const float TimeoutSeconds) const
+{
+	return RequestFromHub<TResponse>(BaseAction, InStructure, TimeoutSeconds);
+}
+
+template <typename TResponse, typename TRequest>
+TFuture<THubRequestResult<TResponse>> UBFHubService_Base::RequestFromHub(const FHubServiceAction& Key, const TRequest& InStructure, const float TimeoutSeconds) const
+{
+	return SocketSystem->Request<TResponse>(Key, InStructure, TimeoutSeconds);
+}
 
 template <typename T>
-typename FCallbackMessageHandle<T>::FOnCallback& UBFHubService_Base::GetBindedHandle()
+typename FCallbackMessageHandle<T>::FOnCallback& UBFHubService_Base::GetBindedHandle(const EHubDecodeThread DecodeThread)
 {
-	auto& Callback = SocketSystem->Bind<T>(BaseAction);
+	auto& Callback = SocketSystem->Bind<T>(BaseAction, DecodeThread);
 	GetBindedErrorHandle().AddUObject(this, &UBFHubService_Base::OnErrorReceived);
 	return Callback;
 }
 
 template <typename T>
-typename FCallbackMessageHandle<T>::FOnCallback& UBFHubService_Base::BindHandle(const FHubServiceAction& Key)
+typename FCallbackMessageHandle<T>::FOnCallback& UBFHubService_Base::BindHandle(const FHubServiceAction& Key, const EHubDecodeThread DecodeThread)
 {
-	auto& Callback = SocketSystem->Bind<T>(Key);
+	auto& Callback = SocketSystem->Bind<T>(Key, DecodeThread);
 	GetBindedErrorHandle(Key).AddUObject(this, &UBFHubService_Base::OnErrorReceived);
 	return Callback;
 }
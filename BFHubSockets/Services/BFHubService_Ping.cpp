@@ -18,6 +18,13 @@ void UBFHubService_Ping::Init()
 	BaseAction.Fill("ping", EHubControllerType::AUTH);
 	BaseAction.RequiredAuth = false;
 
+	// ping measures latency, waiting in batch would spoil it
+	FHubActionPolicy PingPolicy;
+	PingPolicy.bBypassBatching = true;
+	// pings queued during outage are outdated, one is enough
+	PingPolicy.DropPolicy = EHubDropPolicy::CollapseLatest;
+	SocketSystem->SetActionPolicy(BaseAction, PingPolicy);
+
 	SocketSystem->SubscribeToMessageSentEvent(FMessageSentDelegate::FDelegate::CreateUObject(
 		this, &UBFHubService_Ping::OnAnyMessageSent));
 }
@@ -27,6 +34,9 @@ void UBFHubService_Ping::Start()
 	Super::Start();
 	GetBindedHandle<FBFHubResponseData_Ping>().AddUObject(this, &UBFHubService_Ping::OnResponse);
 	StartTimer();
+
+	// timer is reset by every sent message, so pings are rare on busy connection; first sample comes with connection
+	SendPing();
 }
 
 void UBFHubService_Ping::Stop()
@@ -38,40 +48,74 @@ void UBFHubService_Ping::Stop()
 
 void UBFHubService_Ping::StartTimer()
 {
-	if (const UWorld* World = GetWorld())
-	{
-		World->GetTimerManager().SetTimer(
-			PingTimerHandle, this, &UBFHubService_Ping::SendPing, PingInterval, true);
-		VERBOSE("Ping timer started with interval {0} s", PingInterval);
-	}
+	StopTimer();
+
+	LastSentTime = FPlatformTime::Seconds();
+	SchedulePingTimer();
+	VERBOSE("Ping timer started with interval {0} s", PingInterval);
 }
 
 void UBFHubService_Ping::StopTimer()
 {
-	if (PingTimerHandle.IsValid())
+	if (SocketSystem->GetTimers().Cancel(PingTimer))
 	{
-		GetWorld()->GetTimerManager().ClearTimer(PingTimerHandle);
-
 		VERBOSE("Ping timer stopped");
 	}
 }
 
+void UBFHubService_Ping::OnPingTimer()
+{
+	const double Now = FPlatformTime::Seconds();
+	if (Now - LastSentTime >= PingInterval)
+	{
+		SendPing();
+		// ping queued while disconnected is not sent, it still counts, otherwise timer would fire every tick
+		LastSentTime = Now;
+	}
+
+	SchedulePingTimer();
+}
+
+void UBFHubService_Ping::SchedulePingTimer()
+{
+	PingTimer = SocketSystem->GetTimers().Schedule(LastSentTime + PingInterval, [WeakThis = TWeakObjectPtr<UBFHubService_Ping>(this)]()
+	{
+		if (UBFHubService_Ping* This = WeakThis.Get())
+		{
+			This->OnPingTimer();
+		}
+	});
+}
+
 void UBFHubService_Ping::SendPing() const
 {
-	SendRequestToHub(FBFHubRequestData_Ping{GetCurrentTimestampInMS()});
+	SendRequestToHub(FBFHubRequestData_Ping{GetMonotonicMicroseconds()});
 }
 
 void UBFHubService_Ping::OnAnyMessageSent()
 {
-	VERBOSE("Connection save aftet sent message - reset ping timer");
-
-	StopTimer();
-	StartTimer();
+	// no reschedule per message, timer moves its deadline when it fires
+	LastSentTime = FPlatformTime::Seconds();
 }
 
 void UBFHubService_Ping::OnResponse(const FBFHubResponseData_Ping& Data)
 {
-	LastPingTime = GetCurrentTimestampInMS() - Data.Nonce;
+	const double ReceiveTime = FPlatformTime::Seconds();
+	const double SendTime = Data.Nonce / 1e6;
+	if (Data.Nonce <= 0 || SendTime > ReceiveTime)
+	{
+		WARNING("Ping response with unknown nonce {0} skipped", Data.Nonce);
+		return;
+	}
+
+	Rtt.AddSample(ReceiveTime - SendTime, ReceiveTime);
+	Clock.AddSample(SendTime, ReceiveTime, Data.TimeStamp);
+
+	VERBOSE("Ping {0} ms, smoothed {1} ms, min {2} ms, hub clock offset {3} ms (+-{4}), drift {5} ppm",
+		Rtt.GetLatest() * 1000.0, Rtt.GetSmoothed() * 1000.0, Rtt.GetMin() * 1000.0,
+		Clock.GetOffsetMs(ReceiveTime), Clock.GetUncertaintyMs(), Clock.GetDriftPpm());
+
+	LastPingTime = FMath::RoundToInt32(Rtt.GetLatest() * 1000.0);
 	OnPingReceived.Broadcast(LastPingTime);
 
 	if (HighestPingTime < LastPingTime)
@@ -81,7 +125,7 @@ void UBFHubService_Ping::OnResponse(const FBFHubResponseData_Ping& Data)
 	}
 }
 
-int64 UBFHubService_Ping::GetCurrentTimestampInMS()
+int64 UBFHubService_Ping::GetMonotonicMicroseconds()
 {
-	return FDateTime::UtcNow().ToUnixTimestamp() * 1000 + FDateTime::UtcNow().GetMillisecond();
+	return static_cast<int64>(FPlatformTime::Seconds() * 1e6);
 }
@@ -2,6 +2,7 @@
 
 #include "CoreMinimal.h"
 #include "BFHubService_Base.h"
+#include "BFHubSockets/SocketSystem/HubLatency.h"
 
 #include "BFHubService_Ping.generated.h"
 
@@ -12,6 +13,7 @@ struct FBFHubRequestData_Ping
 {
 	GENERATED_BODY()
 
+	// Send time on local monotonic clock in microseconds, echoed by hub
 	UPROPERTY()
 	int64 Nonce = 0;
 };
@@ -24,12 +26,69 @@ struct FBFHubResponseData_Ping
 	UPROPERTY()
 	int64 Nonce = 0;
 
+	// Hub clock in unix milliseconds when ping was answered
 	UPROPERTY()
 	int64 TimeStamp = 0;
 };
 
+template <>
+struct THubStructCodec<FBFHubRequestData_Ping>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FBFHubRequestData_Ping& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("nonce")))
+			{
+				return Field.Read(Out.Nonce);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FBFHubRequestData_Ping& In)
+	{
+		Writer.WriteValue(TEXT("nonce"), In.Nonce);
+	}
+};
+
+template <>
+struct THubStructCodec<FBFHubResponseData_Ping>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FBFHubResponseData_Ping& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("nonce")))
+			{
+				return Field.Read(Out.Nonce);
+			}
+			if (Field.IsField(TEXT("timeStamp")))
+			{
+				return Field.Read(Out.TimeStamp);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FBFHubResponseData_Ping& In)
+	{
+		Writer.WriteValue(TEXT("nonce"), In.Nonce);
+		Writer.WriteValue(TEXT("timeStamp"), In.TimeStamp);
+	}
+};
+
 /**
  * This service need for ping hub server because socket can close connection if we not send any messages
+ * Ping answers measure round trip time and synchronize with hub clock, game code converts hub timestamps with GetClock
  */
 
 DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FPingReceived, float, latency);
@@ -42,6 +101,19 @@ class BFHUBSOCKETS_API UBFHubService_Ping : public UBFHubService_Base
 public:
 	float GetLastPingTime() const { return LastPingTime; }
 
+	const FHubRttEstimator& GetRtt() const { return Rtt; }
+	const FHubClockSync& GetClock() const { return Clock; }
+
+	// Hub timestamp (unix milliseconds) as FPlatformTime::Seconds time
+	double HubTimeToLocal(int64 HubTimestampMs) const { return Clock.HubToLocal(HubTimestampMs); }
+
+	// Timeout for requests from measured RTT, not less than MinSeconds
+	float GetRequestTimeout(float MinSeconds) const { return static_cast<float>(Rtt.GetTimeout(MinSeconds)); }
+
+	// Also heartbeat of liveness check (FHubLiveness), any answer proves connection is alive
+	UFUNCTION()
+	void SendPing() const;
+
 	virtual void Init() override;
 	virtual void Start() override;
 	virtual void Stop() override;
@@ -52,9 +124,8 @@ public:
 private:
 	void StartTimer();
 	void StopTimer();
-
-	UFUNCTION()
-	void SendPing() const;
+	void OnPingTimer();
+	void SchedulePingTimer();
 
 	UFUNCTION()
 	void OnAnyMessageSent();
@@ -62,13 +133,18 @@ private:
 	UFUNCTION()
 	void OnResponse(const FBFHubResponseData_Ping& Data);
 
-	static int64 GetCurrentTimestampInMS();
+	static int64 GetMonotonicMicroseconds();
 
 private:
 	float PingInterval = 28.0f;
 
-	FTimerHandle PingTimerHandle;
+	// timer of socket system, checks time of last sent message when it fires instead of being reset by every message
+	FHubTimerHandle PingTimer;
+	double LastSentTime = 0.0;
 
 	int32 LastPingTime = 0;
 	int32 HighestPingTime = 0;
+
+	FHubRttEstimator Rtt;
+	FHubClockSync Clock;
 };
@@ -20,6 +20,11 @@ void UBFHubService_ServerInit::Init()
 	BaseAction.Fill("init", EHubControllerType::AUTH);
 	BaseAction.RequiredAuth = false;
 
+	FHubActionPolicy InitPolicy;
+	InitPolicy.bBypassBatching = true;
+	InitPolicy.Priority = EHubOutboundPriority::Critical;
+	SocketSystem->SetActionPolicy(BaseAction, InitPolicy);
+
 	GetBindedHandle<FBFHubResponseData_ServerInit>().AddUObject(this, &UBFHubService_ServerInit::OnResponse);
 }
 
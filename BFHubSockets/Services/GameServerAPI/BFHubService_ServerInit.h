@@ -37,6 +37,71 @@ struct FBFHubResponseData_ServerInit
 	FString MatchId;
 };
 
+template <>
+struct THubStructCodec<FBFHubRequestData_ServerInit>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FBFHubRequestData_ServerInit& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("name")))
+			{
+				return Field.Read(Out.Name);
+			}
+			if (Field.IsField(TEXT("password")))
+			{
+				return Field.Read(Out.Password);
+			}
+			if (Field.IsField(TEXT("version")))
+			{
+				return Field.Read(Out.Version);
+			}
+			if (Field.IsField(TEXT("regionId")))
+			{
+				return Field.Read(Out.regionId);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FBFHubRequestData_ServerInit& In)
+	{
+		Writer.WriteValue(TEXT("name"), In.Name);
+		Writer.WriteValue(TEXT("password"), In.Password);
+		Writer.WriteValue(TEXT("version"), In.Version);
+		Writer.WriteValue(TEXT("regionId"), In.regionId);
+	}
+};
+
+template <>
+struct THubStructCodec<FBFHubResponseData_ServerInit>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FBFHubResponseData_ServerInit& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("matchId")))
+			{
+				return Field.Read(Out.MatchId);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FBFHubResponseData_ServerInit& In)
+	{
+		Writer.WriteValue(TEXT("matchId"), In.MatchId);
+	}
+};
+
 
 template <>
 inline FString GetFakeResponseData<FBFHubRequestData_ServerInit>(const FHubServiceAction& Action)
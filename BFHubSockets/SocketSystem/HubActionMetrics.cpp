@@ -0,0 +1,187 @@
+﻿#include "HubActionMetrics.h"
+
+#include "HubSocketSystem.h"
+#include "HAL/IConsoleManager.h"
+#include "UObject/UObjectIterator.h"
+
+DEFINE_STAT(STAT_BFHub_Encode);
+DEFINE_STAT(STAT_BFHub_Decode);
+DEFINE_STAT(STAT_BFHub_Handler);
+DEFINE_STAT(STAT_BFHub_HandleFrame);
+DEFINE_STAT(STAT_BFHub_MessagesIn);
+DEFINE_STAT(STAT_BFHub_MessagesOut);
+DEFINE_STAT(STAT_BFHub_BytesIn);
+DEFINE_STAT(STAT_BFHub_BytesOut);
+
+namespace HubActionMetrics
+{
+	// read by decode and encode workers, console variable only writes it on game thread
+	static std::atomic<bool> bEnabled = true;
+	static FAutoConsoleVariable EnabledVariable(
+		TEXT("BFHub.Metrics.Enabled"),
+		true,
+		TEXT("Record per action counters and timings of hub socket system"),
+		FConsoleVariableDelegate::CreateLambda([](IConsoleVariable* Variable)
+		{
+			bEnabled.store(Variable->GetBool(), std::memory_order_relaxed);
+		}));
+
+	template <typename FunctionType>
+	void ForEachSocketSystem(FunctionType&& Function)
+	{
+		for (TObjectIterator<UHubSocketSystem> It; It; ++It)
+		{
+			if (It->HasAnyFlags(RF_ClassDefaultObject) == false)
+			{
+				Function(**It);
+			}
+		}
+	}
+
+	static FAutoConsoleCommand LogCommand(
+		TEXT("BFHub.Metrics"),
+		TEXT("Print per action message counts, bytes and encode/decode/handler/queue timings, most expensive actions first"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			ForEachSocketSystem([](const UHubSocketSystem& System) { System.LogActionMetrics(); });
+		}));
+
+	static FAutoConsoleCommand ResetCommand(
+		TEXT("BFHub.Metrics.Reset"),
+		TEXT("Reset per action metrics of hub socket systems"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			ForEachSocketSystem([](UHubSocketSystem& System) { System.ResetActionMetrics(); });
+		}));
+}
+
+void FHubHistogram::Record(const uint64 Value)
+{
+	Buckets[GetBucket(Value)].fetch_add(1, std::memory_order_relaxed);
+	Count.fetch_add(1, std::memory_order_relaxed);
+	Total.fetch_add(Value, std::memory_order_relaxed);
+
+	uint64 CurrentMax = Max.load(std::memory_order_relaxed);
+	while (Value > CurrentMax && Max.compare_exchange_weak(CurrentMax, Value, std::memory_order_relaxed) == false)
+	{
+	}
+}
+
+void FHubHistogram::Reset()
+{
+	for (std::atomic<uint32>& Bucket : Buckets)
+	{
+		Bucket = 0;
+	}
+	Count = 0;
+	Total = 0;
+	Max = 0;
+}
+
+uint64 FHubHistogram::GetPercentile(const double Fraction) const
+{
+	// counts are read without snapshot, concurrent records may shift result by a bucket
+	uint64 Recorded = 0;
+	for (const std::atomic<uint32>& Bucket : Buckets)
+	{
+		Recorded += Bucket.load(std::memory_order_relaxed);
+	}
+	if (Recorded == 0)
+	{
+		return 0;
+	}
+
+	const uint64 Target = FMath::Max<uint64>(1, static_cast<uint64>(FMath::CeilToDouble(Fraction * Recorded)));
+	uint64 Seen = 0;
+	for (int32 Bucket = 0; Bucket < NumBuckets; ++Bucket)
+	{
+		Seen += Buckets[Bucket].load(std::memory_order_relaxed);
+		if (Seen >= Target)
+		{
+			return FMath::Min(GetBucketUpperBound(Bucket), GetMax());
+		}
+	}
+	return GetMax();
+}
+
+int32 FHubHistogram::GetBucket(const uint64 Value)
+{
+	if (Value < SubBuckets)
+	{
+		return static_cast<int32>(Value);
+	}
+
+	const int32 Exponent = FMath::FloorLog2_64(Value);
+	if (Exponent > MaxExponent)
+	{
+		return NumBuckets - 1;
+	}
+
+	const int32 SubBucket = static_cast<int32>(Value >> (Exponent - SubBucketBits)) & (SubBuckets - 1);
+	return (Exponent - SubBucketBits + 1) * SubBuckets + SubBucket;
+}
+
+uint64 FHubHistogram::GetBucketUpperBound(const int32 Bucket)
+{
+	if (Bucket < SubBuckets)
+	{
+		return Bucket;
+	}
+
+	const int32 Shift = Bucket / SubBuckets - 1;
+	const uint64 LowerBound = static_cast<uint64>(SubBuckets + Bucket % SubBuckets) << Shift;
+	return LowerBound + (uint64(1) << Shift) - 1;
+}
+
+bool FHubActionMetrics::IsEnabled()
+{
+	return HubActionMetrics::bEnabled.load(std::memory_order_relaxed);
+}
+
+void FHubActionMetrics::RecordIn(const int64 Bytes)
+{
+	if (IsEnabled())
+	{
+		MessagesIn.fetch_add(1, std::memory_order_relaxed);
+		BytesIn.fetch_add(Bytes, std::memory_order_relaxed);
+	}
+	INC_DWORD_STAT(STAT_BFHub_MessagesIn);
+	INC_DWORD_STAT_BY(STAT_BFHub_BytesIn, Bytes);
+}
+
+void FHubActionMetrics::RecordOut(const int64 Bytes)
+{
+	if (IsEnabled())
+	{
+		MessagesOut.fetch_add(1, std::memory_order_relaxed);
+		BytesOut.fetch_add(Bytes, std::memory_order_relaxed);
+	}
+	INC_DWORD_STAT(STAT_BFHub_MessagesOut);
+	INC_DWORD_STAT_BY(STAT_BFHub_BytesOut, Bytes);
+}
+
+void FHubActionMetrics::RecordTime(const EHubActionMetric Metric, const uint64 Nanoseconds)
+{
+	if (IsEnabled())
+	{
+		Histograms[static_cast<int32>(Metric)].Record(Nanoseconds);
+	}
+}
+
+void FHubActionMetrics::RecordCycles(const EHubActionMetric Metric, const uint64 Cycles)
+{
+	RecordTime(Metric, static_cast<uint64>(FPlatformTime::ToSeconds64(Cycles) * 1e9));
+}
+
+void FHubActionMetrics::Reset()
+{
+	MessagesIn = 0;
+	MessagesOut = 0;
+	BytesIn = 0;
+	BytesOut = 0;
+
+	for (FHubHistogram& Histogram : Histograms)
+	{
+		Histogram.Reset();
+	}
+}
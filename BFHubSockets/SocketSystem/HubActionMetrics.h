@@ -0,0 +1,122 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include <atomic>
+
+DECLARE_STATS_GROUP(TEXT("BFHub"), STATGROUP_BFHub, STATCAT_Advanced);
+
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Encode"), STAT_BFHub_Encode, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Decode"), STAT_BFHub_Decode, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Handler"), STAT_BFHub_Handler, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Handle Frame"), STAT_BFHub_HandleFrame, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Messages In"), STAT_BFHub_MessagesIn, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Messages Out"), STAT_BFHub_MessagesOut, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bytes In"), STAT_BFHub_BytesIn, STATGROUP_BFHub, BFHUBSOCKETS_API);
+DECLARE_DWORD_COUNTER_STAT_EXTERN(TEXT("Bytes Out"), STAT_BFHub_BytesOut, STATGROUP_BFHub, BFHUBSOCKETS_API);
+
+/**
+ * Log-linear histogram of durations in nanoseconds, HDR style: every power of two is split into SubBuckets linear buckets
+ * Recorded value is kept with relative error under 1 / SubBuckets up to ~17 s, longer values go into the last bucket
+ * Record is lock free and may be called from any thread
+ */
+class BFHUBSOCKETS_API FHubHistogram
+{
+public:
+	void Record(uint64 Value);
+	void Reset();
+
+	uint64 GetCount() const { return Count; }
+	uint64 GetTotal() const { return Total; }
+	uint64 GetMax() const { return Max; }
+	// Upper bound of the bucket with the percentile, 0 if nothing recorded
+	uint64 GetPercentile(double Fraction) const;
+
+	static constexpr int32 SubBucketBits = 3;
+	static constexpr int32 SubBuckets = 1 << SubBucketBits;
+	static constexpr int32 MaxExponent = 34;
+	static constexpr int32 NumBuckets = (MaxExponent - SubBucketBits + 2) * SubBuckets;
+
+private:
+	static int32 GetBucket(uint64 Value);
+	static uint64 GetBucketUpperBound(int32 Bucket);
+
+	std::atomic<uint32> Buckets[NumBuckets] = {};
+	std::atomic<uint64> Count = 0;
+	std::atomic<uint64> Total = 0;
+	std::atomic<uint64> Max = 0;
+};
+
+enum class EHubActionMetric : uint8
+{
+	// struct into message, on game or worker thread
+	Encode,
+	// payload into struct, on game or worker thread
+	Decode,
+	// broadcast of decoded struct to bound delegates
+	Handler,
+	// time message waited in outbound queue for connection or authorization
+	QueueDwell,
+
+	Num,
+};
+
+/**
+ * Hot path counters and timings of one action
+ * Shared with message handle and async send tasks, so it may outlive the socket system; recorded from game and worker threads
+ */
+class BFHUBSOCKETS_API FHubActionMetrics
+{
+public:
+	void RecordIn(int64 Bytes);
+	void RecordOut(int64 Bytes);
+	void RecordTime(EHubActionMetric Metric, uint64 Nanoseconds);
+	void RecordCycles(EHubActionMetric Metric, uint64 Cycles);
+	void Reset();
+
+	uint64 GetMessagesIn() const { return MessagesIn; }
+	uint64 GetMessagesOut() const { return MessagesOut; }
+	uint64 GetBytesIn() const { return BytesIn; }
+	uint64 GetBytesOut() const { return BytesOut; }
+	const FHubHistogram& GetHistogram(const EHubActionMetric Metric) const { return Histograms[static_cast<int32>(Metric)]; }
+
+	// Switched by BFHub.Metrics.Enabled
+	static bool IsEnabled();
+
+private:
+	std::atomic<uint64> MessagesIn = 0;
+	std::atomic<uint64> MessagesOut = 0;
+	std::atomic<uint64> BytesIn = 0;
+	std::atomic<uint64> BytesOut = 0;
+
+	FHubHistogram Histograms[static_cast<int32>(EHubActionMetric::Num)];
+};
+
+/**
+ * Measures the scope into histogram of action, does nothing while metrics are disabled
+ */
+class FHubMetricScope
+{
+public:
+	UE_NONCOPYABLE(FHubMetricScope);
+
+	FHubMetricScope(FHubActionMetrics* InMetrics, const EHubActionMetric InMetric)
+		: Metrics(FHubActionMetrics::IsEnabled() ? InMetrics : nullptr)
+		, Metric(InMetric)
+		, StartCycles(Metrics ? FPlatformTime::Cycles64() : 0)
+	{
+	}
+
+	~FHubMetricScope()
+	{
+		if (Metrics)
+		{
+			Metrics->RecordCycles(Metric, FPlatformTime::Cycles64() - StartCycles);
+		}
+	}
+
+private:
+	FHubActionMetrics* Metrics;
+	EHubActionMetric Metric;
+	uint64 StartCycles;
+};
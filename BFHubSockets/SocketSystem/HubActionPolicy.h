@@ -0,0 +1,101 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+class UScriptStruct;
+
+// Order in which queued messages are sent after reconnect, lower priority messages are dropped first when queue is full
+enum class EHubOutboundPriority : uint8
+{
+	Critical,
+	High,
+	Normal,
+	Low,
+
+	Num
+};
+
+// What happens with queued message of the action when outbound queue is full
+enum class EHubDropPolicy : uint8
+{
+	// Oldest messages of the same or lower priority dropped to make room
+	DropOldest,
+	/** Only latest message of the action (or of its sub key, see FHubActionPolicy::CoalesceBy) kept in queue
+	 * Meant for "latest state wins" actions, full queue handled as DropOldest */
+	CollapseLatest,
+	// New message rejected, queued messages kept
+	Reject,
+};
+
+/**
+ * Sub key of CoalesceBy kept by value, hash only finds candidates: queued messages are replaced when keys are equal
+ * Empty key (action without sub key) is equal to every other empty key
+ */
+struct FHubCoalescingKey
+{
+	template <typename TKey>
+	static FHubCoalescingKey Make(TKey&& InValue)
+	{
+		using FValueType = std::decay_t<TKey>;
+
+		FHubCoalescingKey Key;
+		Key.Hash = GetTypeHash(InValue);
+		Key.Value = MakeShared<FValueType>(Forward<TKey>(InValue));
+		Key.EqualsFunction = [](const void* A, const void* B)
+		{
+			return *static_cast<const FValueType*>(A) == *static_cast<const FValueType*>(B);
+		};
+		return Key;
+	}
+
+	// keys of one action always have the same value type
+	bool operator==(const FHubCoalescingKey& Other) const
+	{
+		if (Hash != Other.Hash || Value.IsValid() != Other.Value.IsValid())
+		{
+			return false;
+		}
+		return Value.IsValid() == false || EqualsFunction(Value.Get(), Other.Value.Get());
+	}
+
+	friend uint32 GetTypeHash(const FHubCoalescingKey& Key) { return Key.Hash; }
+
+private:
+	uint32 Hash = 0;
+	TSharedPtr<const void> Value;
+	bool (*EqualsFunction)(const void* A, const void* B) = nullptr;
+};
+
+/**
+ * Per action rules of outbound traffic, set by services with UHubSocketSystem::SetActionPolicy
+ */
+struct FHubActionPolicy
+{
+	// Latency critical actions sent in own frame immediately even when batching enabled
+	bool bBypassBatching = false;
+
+	EHubOutboundPriority Priority = EHubOutboundPriority::Normal;
+	EHubDropPolicy DropPolicy = EHubDropPolicy::DropOldest;
+
+	/** Connection of the action: 0 - control connection, 1..USocketSettings::BulkLaneCount - bulk lanes
+	 * Messages go to control connection while their lane is not connected
+	 * Actions with RequiredAuth use the lane only after it is attached to hub session (USocketSettings::bSessionResumeEnabled) */
+	uint8 Lane = 0;
+
+	// Set by CoalesceBy, without it all queued messages of the action replace each other
+	const UScriptStruct* CoalescingStruct = nullptr;
+	TFunction<FHubCoalescingKey(const void* Struct)> CoalescingSubKey;
+
+	/** Queued messages of the action replace each other only when sub keys taken from request struct are equal
+	 * e.g. status of every player is kept: CoalesceBy<FPlayerStatus>([](const FPlayerStatus& Status) { return Status.PlayerId; }) */
+	template <typename TStruct, typename FunctionType>
+	void CoalesceBy(FunctionType&& GetSubKey)
+	{
+		DropPolicy = EHubDropPolicy::CollapseLatest;
+		CoalescingStruct = TStruct::StaticStruct();
+		CoalescingSubKey = [GetSubKey = Forward<FunctionType>(GetSubKey)](const void* Struct)
+		{
+			return FHubCoalescingKey::Make(Invoke(GetSubKey, *static_cast<const TStruct*>(Struct)));
+		};
+	}
+};
@@ -0,0 +1,85 @@
+﻿#include "HubActionRegistry.h"
+
+int32 FHubActionRegistry::FindOrAdd(const FHubServiceAction& Action)
+{
+	const int32 ExistingId = Find(Action);
+	if (ExistingId != InvalidId)
+	{
+		return ExistingId;
+	}
+
+	if ((Actions.Num() + 1) * 2 > Slots.Num())
+	{
+		Grow();
+	}
+
+	const int32 Id = Actions.Add(Action);
+	Insert(HashAction(Action.Controller, Action.Method), Id);
+	return Id;
+}
+
+int32 FHubActionRegistry::Find(const EHubControllerType Controller, const FStringView Method) const
+{
+	if (Slots.IsEmpty())
+	{
+		return InvalidId;
+	}
+
+	const uint32 Hash = HashAction(Controller, Method);
+	const uint32 Mask = Slots.Num() - 1;
+
+	for (uint32 Index = Hash & Mask;; Index = (Index + 1) & Mask)
+	{
+		const FSlot& Slot = Slots[Index];
+		if (Slot.Id == InvalidId)
+		{
+			return InvalidId;
+		}
+
+		// full hash compared first, strings compared only for real match
+		if (Slot.Hash == Hash)
+		{
+			const FHubServiceAction& Action = Actions[Slot.Id];
+			if (Action.Controller == Controller && Method.Equals(Action.Method, ESearchCase::IgnoreCase))
+			{
+				return Slot.Id;
+			}
+		}
+	}
+}
+
+uint32 FHubActionRegistry::HashAction(const EHubControllerType Controller, const FStringView Method)
+{
+	// FNV-1a over lower case characters
+	uint32 Hash = 2166136261u ^ static_cast<uint32>(Controller);
+	for (const TCHAR Char : Method)
+	{
+		Hash = (Hash ^ static_cast<uint32>(FChar::ToLower(Char))) * 16777619u;
+	}
+	return Hash;
+}
+
+void FHubActionRegistry::Grow()
+{
+	Slots.Reset();
+	Slots.SetNum(FMath::Max(16, static_cast<int32>(FMath::RoundUpToPowerOfTwo((Actions.Num() + 1) * 4))));
+
+	for (int32 Id = 0; Id < Actions.Num(); ++Id)
+	{
+		Insert(HashAction(Actions[Id].Controller, Actions[Id].Method), Id);
+	}
+}
+
+void FHubActionRegistry::Insert(const uint32 Hash, const int32 Id)
+{
+	const uint32 Mask = Slots.Num() - 1;
+
+	uint32 Index = Hash & Mask;
+	while (Slots[Index].Id != InvalidId)
+	{
+		Index = (Index + 1) & Mask;
+	}
+
+	Slots[Index].Hash = Hash;
+	Slots[Index].Id = Id;
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubServicesBaseData.h"
+
+/**
+ * Interned hub actions: every (controller, method) pair gets dense id once, when it is bound or gets a policy
+ * Per action data (handlers, policies) stored in arrays indexed by id
+ * Inbound method is resolved straight from the frame view, without building FString and FHubServiceAction
+ * Method names compared case insensitive, the same way as FHubServiceAction
+ */
+class BFHUBSOCKETS_API FHubActionRegistry
+{
+public:
+	static constexpr int32 InvalidId = INDEX_NONE;
+
+	int32 FindOrAdd(const FHubServiceAction& Action);
+
+	int32 Find(const FHubServiceAction& Action) const { return Find(Action.Controller, Action.Method); }
+	int32 Find(EHubControllerType Controller, FStringView Method) const;
+
+	const FHubServiceAction& GetAction(const int32 Id) const { return Actions[Id]; }
+	int32 Num() const { return Actions.Num(); }
+
+private:
+	static uint32 HashAction(EHubControllerType Controller, FStringView Method);
+
+	void Grow();
+	void Insert(uint32 Hash, int32 Id);
+
+	struct FSlot
+	{
+		uint32 Hash = 0;
+		int32 Id = InvalidId;
+	};
+
+	// open addressing, power of two size, kept at most half full so probe sequences stay short
+	TArray<FSlot> Slots;
+	TArray<FHubServiceAction> Actions;
+};
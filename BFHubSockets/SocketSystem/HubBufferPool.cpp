@@ -0,0 +1,70 @@
+﻿#include "HubBufferPool.h"
+
+#include "HubSocketSystem.h"
+#include "HAL/IConsoleManager.h"
+
+#include "Logging/StructuredLog.h"
+
+namespace HubBufferPool
+{
+	static FAutoConsoleCommand StatsCommand(
+		TEXT("BFHub.BufferPool.Stats"),
+		TEXT("Print how many outbound buffers were taken from pool instead of allocated"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			const FHubBufferPool& Pool = FHubBufferPool::Get();
+			UE_LOGFMT(BFHubSocketSystem, Display, "Buffer pool: acquired {0}, reused {1}", Pool.GetAcquiredCount(), Pool.GetReusedCount());
+		}));
+}
+
+FHubBufferPool& FHubBufferPool::Get()
+{
+	static FHubBufferPool Pool;
+	return Pool;
+}
+
+TArray<uint8> FHubBufferPool::Acquire()
+{
+	++AcquiredCount;
+
+	FScopeLock ScopeLock(&Lock);
+	if (Buffers.IsEmpty())
+	{
+		return TArray<uint8>();
+	}
+
+	++ReusedCount;
+	return Buffers.Pop();
+}
+
+void FHubBufferPool::Release(TArray<uint8>&& Buffer)
+{
+	if (Buffer.Max() == 0)
+	{
+		return;
+	}
+	if (Buffer.Max() > MaxPooledCapacity)
+	{
+		// caller keeps using the array, e.g. as reassembly buffer, so it must not keep old content either
+		Buffer.Empty();
+		return;
+	}
+
+	Buffer.Reset();
+
+	FScopeLock ScopeLock(&Lock);
+	if (Buffers.Num() < MaxPooledBuffers)
+	{
+		Buffers.Add(MoveTemp(Buffer));
+		return;
+	}
+	Buffer.Empty();
+}
+
+void FHubBufferPool::Release(const TArrayView<TArray<uint8>> InBuffers)
+{
+	for (TArray<uint8>& Buffer : InBuffers)
+	{
+		Release(MoveTemp(Buffer));
+	}
+}
@@ -0,0 +1,35 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Reused byte buffers of outbound messages and frames, shared by all socket systems of the process
+ * Message is encoded into capacity left from previous messages, so steady traffic does not allocate
+ * Thread safe, SendAsync acquires buffers on worker threads
+ */
+class BFHUBSOCKETS_API FHubBufferPool
+{
+public:
+	static FHubBufferPool& Get();
+
+	// Empty buffer, with capacity if pool had one
+	TArray<uint8> Acquire();
+
+	// Buffer is always left empty; buffers bigger than MaxPooledCapacity and buffers over MaxPooledBuffers are freed
+	void Release(TArray<uint8>&& Buffer);
+	void Release(TArrayView<TArray<uint8>> Buffers);
+
+	uint64 GetAcquiredCount() const { return AcquiredCount; }
+	uint64 GetReusedCount() const { return ReusedCount; }
+
+	static constexpr int32 MaxPooledBuffers = 64;
+	static constexpr int32 MaxPooledCapacity = 64 * 1024;
+
+private:
+	FCriticalSection Lock;
+	TArray<TArray<uint8>> Buffers;
+
+	std::atomic<uint64> AcquiredCount = 0;
+	std::atomic<uint64> ReusedCount = 0;
+};
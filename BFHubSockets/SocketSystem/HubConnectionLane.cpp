@@ -0,0 +1,182 @@
+﻿#include "HubConnectionLane.h"
+
+#include "HubBufferPool.h"
+#include "HubSocketSystem.h"
+#include "IWebSocket.h"
+#include "SocketSettings.h"
+
+#include "Logging/StructuredLog.h"
+#undef CHANNEL
+#define CHANNEL(Verbosity, Format, ...) UE_LOGFMT(BFHubSocketSystem, Verbosity, Format, ##__VA_ARGS__)
+#define LOG(Format, ...) CHANNEL(Log, Format, ##__VA_ARGS__)
+#define WARNING(Format, ...) CHANNEL(Warning, Format, ##__VA_ARGS__)
+#define ERROR(Format, ...) CHANNEL(Error, Format, ##__VA_ARGS__)
+#define VERBOSE(Format, ...) CHANNEL(Verbose, Format, ##__VA_ARGS__)
+
+FHubConnectionLane::FHubConnectionLane(const int32 InIndex, const TSharedRef<IWebSocket>& InSocket, FOnFrame&& InOnFrame, FOnEstablished&& InOnEstablished)
+	: Index(InIndex)
+	, Socket(InSocket)
+	, OnFrame(MoveTemp(InOnFrame))
+	, OnEstablished(MoveTemp(InOnEstablished))
+{
+	ReconnectInterval = GetDefault<USocketSettings>()->ReconnectTimeStartInterval;
+
+	Socket->OnConnected().AddRaw(this, &FHubConnectionLane::OnConnected);
+	Socket->OnClosed().AddRaw(this, &FHubConnectionLane::OnClosed);
+	Socket->OnConnectionError().AddRaw(this, &FHubConnectionLane::OnConnectionError);
+	Socket->OnRawMessage().AddRaw(this, &FHubConnectionLane::OnRawMessage);
+}
+
+FHubConnectionLane::~FHubConnectionLane()
+{
+	Stop();
+
+	Socket->OnConnected().RemoveAll(this);
+	Socket->OnClosed().RemoveAll(this);
+	Socket->OnConnectionError().RemoveAll(this);
+	Socket->OnRawMessage().RemoveAll(this);
+
+	FHubBufferPool::Get().Release(OutboundBatch.Messages);
+	FHubBufferPool::Get().Release(MoveTemp(RawMessageBuffer));
+}
+
+void FHubConnectionLane::Start()
+{
+	if (bStarted)
+	{
+		return;
+	}
+
+	bStarted = true;
+	Connect();
+}
+
+void FHubConnectionLane::Stop()
+{
+	if (bStarted == false)
+	{
+		return;
+	}
+
+	// cleared before close, closing lane is not reconnected
+	bStarted = false;
+	bEstablished = false;
+	bAuthorized = false;
+	ReconnectTime = 0.0;
+	RawMessageBuffer.Reset();
+
+	// also cancels connect in progress
+	Socket->Close();
+}
+
+void FHubConnectionLane::Tick(const double Now)
+{
+	if (bStarted && ReconnectTime > 0.0 && Now >= ReconnectTime)
+	{
+		Connect();
+	}
+}
+
+bool FHubConnectionLane::IsReady() const
+{
+	return bEstablished && Socket->IsConnected();
+}
+
+void FHubConnectionLane::Send(const TArray<uint8>& Frame, const bool bBinary)
+{
+	Socket->Send(Frame.GetData(), Frame.Num(), bBinary);
+}
+
+void FHubConnectionLane::Connect()
+{
+	ReconnectTime = 0.0;
+	Socket->Connect();
+}
+
+void FHubConnectionLane::ScheduleReconnect()
+{
+	bEstablished = false;
+	// new connection is not attached to the session
+	bAuthorized = false;
+	// tail of the frame will never come
+	RawMessageBuffer.Reset();
+
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	if (bStarted == false || Settings->bAutoReconnectEnabled == false)
+	{
+		return;
+	}
+
+	WARNING("Reconnect lane {0} in {1} seconds", Index, ReconnectInterval);
+
+	ReconnectTime = FPlatformTime::Seconds() + ReconnectInterval;
+
+	// the same backoff as control connection, but lanes do not wait for each other
+	ReconnectInterval = FMath::Clamp(ReconnectInterval * Settings->ReconnectTimeIncreaseStep, Settings->ReconnectTimeStartInterval, Settings->ReconnectTimeMaxInterval);
+}
+
+void FHubConnectionLane::OnConnected()
+{
+	LOG("Lane {0} connected", Index);
+}
+
+void FHubConnectionLane::OnClosed(const int32 StatusCode, const FString& Reason, bool bWasClean)
+{
+	if (bStarted)
+	{
+		WARNING("Lane {0} closed with code: {1}, Reason: {2}", Index, StatusCode, Reason);
+	}
+	ScheduleReconnect();
+}
+
+void FHubConnectionLane::OnConnectionError(const FString& ErrorString)
+{
+	ERROR("Lane {0} connection error: {1}", Index, ErrorString);
+	ScheduleReconnect();
+}
+
+void FHubConnectionLane::OnRawMessage(const void* Data, const SIZE_T Size, const SIZE_T BytesRemaining)
+{
+	if (RawMessageBuffer.IsEmpty() && BytesRemaining == 0)
+	{
+		HandleFrame(TConstArrayView<uint8>(static_cast<const uint8*>(Data), static_cast<int32>(Size)));
+		return;
+	}
+
+	if (RawMessageBuffer.Max() == 0)
+	{
+		RawMessageBuffer = FHubBufferPool::Get().Acquire();
+	}
+	RawMessageBuffer.Append(static_cast<const uint8*>(Data), Size);
+
+	if (BytesRemaining > 0)
+	{
+		return;
+	}
+
+	// taken out of the member, next frame starts from empty buffer whatever pool does with this one
+	TArray<uint8> Frame = MoveTemp(RawMessageBuffer);
+	HandleFrame(Frame);
+	FHubBufferPool::Get().Release(MoveTemp(Frame));
+}
+
+void FHubConnectionLane::HandleFrame(const TConstArrayView<uint8> Frame)
+{
+	if (bStarted == false)
+	{
+		return;
+	}
+
+	if (bEstablished == false)
+	{
+		LOG("First message received - lane {0} established", Index);
+
+		bEstablished = true;
+		++Generation;
+		ReconnectInterval = GetDefault<USocketSettings>()->ReconnectTimeStartInterval;
+		OnEstablished.ExecuteIfBound(*this);
+		return;
+	}
+
+	OnFrame.ExecuteIfBound(Frame);
+}
@@ -0,0 +1,69 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubMessageBatch.h"
+
+class IWebSocket;
+
+/**
+ * Extra connection to the same hub, so bulk traffic does not stand in front of control messages in one TCP stream
+ * Lane lives only while control connection of UHubSocketSystem is established, it has own frame reassembly, outbound batch and reconnect backoff
+ * First frame from hub marks lane as established, the same as for control connection
+ * Lane sends no credentials: it carries actions with RequiredAuth only after socket system attached it to the session of control connection,
+ * every reconnect of the lane loses it until attach is sent again
+ */
+class BFHUBSOCKETS_API FHubConnectionLane
+{
+public:
+	DECLARE_DELEGATE_OneParam(FOnFrame, TConstArrayView<uint8> /*Frame*/);
+	DECLARE_DELEGATE_OneParam(FOnEstablished, FHubConnectionLane& /*Lane*/);
+
+	// Index of bulk lane starts from 1, 0 is control connection
+	FHubConnectionLane(int32 InIndex, const TSharedRef<IWebSocket>& InSocket, FOnFrame&& InOnFrame, FOnEstablished&& InOnEstablished);
+	~FHubConnectionLane();
+
+	// Connects and keeps lane connected until Stop
+	void Start();
+	void Stop();
+	// Reconnects lane when its backoff is elapsed
+	void Tick(double Now);
+
+	bool IsReady() const;
+	void Send(const TArray<uint8>& Frame, bool bBinary);
+
+	// Hub attached lane to authorized session, cleared when lane is lost
+	bool IsAuthorized() const { return bAuthorized && IsReady(); }
+	void SetAuthorized(bool bInAuthorized) { bAuthorized = bInAuthorized; }
+
+	int32 GetIndex() const { return Index; }
+	// Grows with every established connection, answer to attach sent on previous connection is ignored
+	uint32 GetGeneration() const { return Generation; }
+
+	FHubOutboundBatch OutboundBatch;
+
+private:
+	void Connect();
+	void ScheduleReconnect();
+
+	void OnConnected();
+	void OnClosed(int32 StatusCode, const FString& Reason, bool bWasClean);
+	void OnConnectionError(const FString& ErrorString);
+	void OnRawMessage(const void* Data, SIZE_T Size, SIZE_T BytesRemaining);
+	void HandleFrame(TConstArrayView<uint8> Frame);
+
+	int32 Index = 0;
+	TSharedRef<IWebSocket> Socket;
+	FOnFrame OnFrame;
+	FOnEstablished OnEstablished;
+	TArray<uint8> RawMessageBuffer;
+
+	bool bStarted = false;
+	bool bEstablished = false;
+	bool bAuthorized = false;
+	uint32 Generation = 0;
+
+	// 0 - reconnect is not scheduled
+	double ReconnectTime = 0.0;
+	// will be increase if reconnect fail, reset when lane is established
+	float ReconnectInterval = 0.0f;
+};
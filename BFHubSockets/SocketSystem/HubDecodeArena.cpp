@@ -0,0 +1,91 @@
+﻿#include "HubDecodeArena.h"
+
+#include "HubSocketSystem.h"
+#include "HAL/IConsoleManager.h"
+
+#include "Logging/StructuredLog.h"
+
+std::atomic<uint64> FHubDecodeArena::AllocationCount = 0;
+std::atomic<uint64> FHubDecodeArena::AllocatedBytes = 0;
+std::atomic<uint64> FHubDecodeArena::HeapBlockCount = 0;
+std::atomic<uint64> FHubDecodeArena::ResetCount = 0;
+
+namespace HubDecodeArena
+{
+	static FAutoConsoleCommand StatsCommand(
+		TEXT("BFHub.DecodeArena.Stats"),
+		TEXT("Print how many decode allocations were served by arenas and how many heap blocks arenas took"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UE_LOGFMT(BFHubSocketSystem, Display, "Decode arena: {0} allocations ({1} bytes) in {2} frames, heap blocks {3}",
+				FHubDecodeArena::GetAllocationCount(), FHubDecodeArena::GetAllocatedBytes(), FHubDecodeArena::GetResetCount(), FHubDecodeArena::GetHeapBlockCount());
+		}));
+}
+
+FHubDecodeArena::FHubDecodeArena(const int32 InBlockSize)
+	: BlockSize(InBlockSize)
+{
+}
+
+void* FHubDecodeArena::Allocate(const int32 Size, const int32 Alignment)
+{
+	++AllocationCount;
+	AllocatedBytes += Size;
+
+	if (CurrentBlock != INDEX_NONE)
+	{
+		const int32 Offset = Align(CurrentOffset, Alignment);
+		if (Offset + Size <= Blocks[CurrentBlock].Size)
+		{
+			CurrentOffset = Offset + Size;
+			return Blocks[CurrentBlock].Memory.Get() + Offset;
+		}
+	}
+
+	// block memory comes from operator new, aligned enough for any scalar
+	NextBlock(Size);
+	CurrentOffset = Size;
+	return Blocks[CurrentBlock].Memory.Get();
+}
+
+void FHubDecodeArena::NextBlock(const int32 MinSize)
+{
+	const int32 Next = CurrentBlock + 1;
+	if (Blocks.IsValidIndex(Next) && Blocks[Next].Size >= MinSize)
+	{
+		CurrentBlock = Next;
+		return;
+	}
+
+	FBlock Block;
+	Block.Size = FMath::Max(BlockSize, MinSize);
+	Block.Memory = MakeUnique<uint8[]>(Block.Size);
+	++HeapBlockCount;
+
+	Blocks.Insert(MoveTemp(Block), Next);
+	CurrentBlock = Next;
+}
+
+void FHubDecodeArena::Reset()
+{
+	++ResetCount;
+
+	Blocks.RemoveAll([this](const FBlock& Block) { return Block.Size != BlockSize; });
+	if (Blocks.Num() > MaxRetainedBlocks)
+	{
+		Blocks.SetNum(MaxRetainedBlocks);
+	}
+
+	CurrentBlock = Blocks.IsEmpty() ? INDEX_NONE : 0;
+	CurrentOffset = 0;
+}
+
+int64 FHubDecodeArena::GetUsedBytes() const
+{
+	int64 Bytes = CurrentOffset;
+	for (int32 Index = 0; Index < CurrentBlock; ++Index)
+	{
+		Bytes += Blocks[Index].Size;
+	}
+	return Bytes;
+}
@@ -0,0 +1,63 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+#include <type_traits>
+
+/**
+ * Linear scratch memory for decoding one inbound frame: unescaped payloads and strings of envelopes
+ * Allocation is a pointer bump, everything is released at once by Reset after the frame is handled
+ * Blocks are kept between frames, so steady traffic does not touch the heap
+ * Not thread safe, payload which outlives the frame must be copied (see FHubOwnedMessagePayload)
+ */
+class BFHUBSOCKETS_API FHubDecodeArena
+{
+public:
+	UE_NONCOPYABLE(FHubDecodeArena);
+
+	explicit FHubDecodeArena(int32 InBlockSize = DefaultBlockSize);
+
+	void* Allocate(int32 Size, int32 Alignment);
+
+	// Uninitialized memory, arena never runs destructors
+	template <typename T>
+	TArrayView<T> AllocateArray(const int32 Num)
+	{
+		static_assert(std::is_trivially_destructible_v<T>, "Arena memory is released without destruction");
+		return TArrayView<T>(static_cast<T*>(Allocate(Num * sizeof(T), alignof(T))), Num);
+	}
+
+	// Releases everything allocated since previous reset, oversized blocks and blocks over MaxRetainedBlocks go back to heap
+	void Reset();
+
+	int64 GetUsedBytes() const;
+
+	static constexpr int32 DefaultBlockSize = 16 * 1024;
+	static constexpr int32 MaxRetainedBlocks = 16;
+
+	// Counters of all arenas of the process
+	static uint64 GetAllocationCount() { return AllocationCount; }
+	static uint64 GetAllocatedBytes() { return AllocatedBytes; }
+	static uint64 GetHeapBlockCount() { return HeapBlockCount; }
+	static uint64 GetResetCount() { return ResetCount; }
+
+private:
+	struct FBlock
+	{
+		TUniquePtr<uint8[]> Memory;
+		int32 Size = 0;
+	};
+
+	// Next retained block if it fits, new block otherwise
+	void NextBlock(int32 MinSize);
+
+	TArray<FBlock> Blocks;
+	int32 CurrentBlock = INDEX_NONE;
+	int32 CurrentOffset = 0;
+	int32 BlockSize = 0;
+
+	static std::atomic<uint64> AllocationCount;
+	static std::atomic<uint64> AllocatedBytes;
+	static std::atomic<uint64> HeapBlockCount;
+	static std::atomic<uint64> ResetCount;
+};
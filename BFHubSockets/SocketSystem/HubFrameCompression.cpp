@@ -0,0 +1,147 @@
+﻿#include "HubFrameCompression.h"
+
+#include "HubSocketSystem.h"
+#include "HAL/IConsoleManager.h"
+#include "Misc/Compression.h"
+
+#include "Logging/StructuredLog.h"
+
+namespace HubFrameCompression
+{
+	constexpr uint8 Magic[] = {'B', 'F', 'Z'};
+	constexpr uint8 FormatZlib = 1;
+
+	// guard against broken or malicious size in header
+	constexpr uint32 MaxUncompressedSize = 64 * 1024 * 1024;
+
+	void WriteUInt32(uint8* Destination, const uint32 Value)
+	{
+		Destination[0] = static_cast<uint8>(Value);
+		Destination[1] = static_cast<uint8>(Value >> 8);
+		Destination[2] = static_cast<uint8>(Value >> 16);
+		Destination[3] = static_cast<uint8>(Value >> 24);
+	}
+
+	uint32 ReadUInt32(const uint8* Source)
+	{
+		return Source[0] | (Source[1] << 8) | (Source[2] << 16) | (static_cast<uint32>(Source[3]) << 24);
+	}
+
+	double Ratio(const uint64 Numerator, const uint64 Denominator)
+	{
+		return Denominator > 0 ? static_cast<double>(Numerator) / Denominator : 0.0;
+	}
+
+	static FAutoConsoleCommand StatsCommand(
+		TEXT("BFHub.Compression.Stats"),
+		TEXT("Print hub frame compression counters"),
+		FConsoleCommandDelegate::CreateLambda([]()
+		{
+			UE_LOGFMT(BFHubSocketSystem, Display, "{0}", FHubFrameCompression::GetStats().ToString());
+		}));
+}
+
+double FHubCompressionStats::GetCompressionRatio() const
+{
+	return HubFrameCompression::Ratio(BytesAfterCompression, BytesBeforeCompression);
+}
+
+double FHubCompressionStats::GetDecompressionRatio() const
+{
+	return HubFrameCompression::Ratio(BytesBeforeDecompression, BytesAfterDecompression);
+}
+
+double FHubCompressionStats::GetCompressMicrosecondsPerFrame() const
+{
+	return FPlatformTime::ToMilliseconds64(CompressCycles) * 1000.0 / FMath::Max<uint64>(FramesCompressed, 1);
+}
+
+double FHubCompressionStats::GetDecompressMicrosecondsPerFrame() const
+{
+	return FPlatformTime::ToMilliseconds64(DecompressCycles) * 1000.0 / FMath::Max<uint64>(FramesDecompressed, 1);
+}
+
+FString FHubCompressionStats::ToString() const
+{
+	return FString::Printf(TEXT("Compressed %llu frames (%llu -> %llu bytes, ratio %.3f, %.1f us/frame); decompressed %llu frames (%llu -> %llu bytes, ratio %.3f, %.1f us/frame)"),
+		FramesCompressed.load(), BytesBeforeCompression.load(), BytesAfterCompression.load(), GetCompressionRatio(), GetCompressMicrosecondsPerFrame(),
+		FramesDecompressed.load(), BytesBeforeDecompression.load(), BytesAfterDecompression.load(), GetDecompressionRatio(), GetDecompressMicrosecondsPerFrame());
+}
+
+bool FHubFrameCompression::Compress(const TConstArrayView<uint8> Frame, TArray<uint8>& OutFrame)
+{
+	using namespace HubFrameCompression;
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const int32 UncompressedSize = Frame.Num();
+
+	int32 CompressedSize = FCompression::CompressMemoryBound(NAME_Zlib, UncompressedSize);
+	OutFrame.SetNumUninitialized(HeaderSize + CompressedSize);
+
+	if (FCompression::CompressMemory(NAME_Zlib, OutFrame.GetData() + HeaderSize, CompressedSize, Frame.GetData(), UncompressedSize) == false)
+	{
+		OutFrame.Reset();
+		return false;
+	}
+
+	OutFrame.SetNum(HeaderSize + CompressedSize);
+	FMemory::Memcpy(OutFrame.GetData(), Magic, sizeof(Magic));
+	OutFrame[sizeof(Magic)] = FormatZlib;
+	WriteUInt32(OutFrame.GetData() + sizeof(Magic) + 1, UncompressedSize);
+
+	FHubCompressionStats& Stats = GetStats();
+	++Stats.FramesCompressed;
+	Stats.BytesBeforeCompression += UncompressedSize;
+	Stats.BytesAfterCompression += OutFrame.Num();
+	Stats.CompressCycles += FPlatformTime::Cycles64() - StartCycles;
+
+	return true;
+}
+
+bool FHubFrameCompression::IsCompressedFrame(const void* Data, const SIZE_T Size)
+{
+	using namespace HubFrameCompression;
+
+	return Size >= HeaderSize && FMemory::Memcmp(Data, Magic, sizeof(Magic)) == 0;
+}
+
+bool FHubFrameCompression::Decompress(const void* Data, const SIZE_T Size, TArray<uint8>& OutFrame)
+{
+	using namespace HubFrameCompression;
+
+	if (IsCompressedFrame(Data, Size) == false)
+	{
+		return false;
+	}
+
+	const uint64 StartCycles = FPlatformTime::Cycles64();
+
+	const uint8* Bytes = static_cast<const uint8*>(Data);
+	const uint32 UncompressedSize = ReadUInt32(Bytes + sizeof(Magic) + 1);
+	if (Bytes[sizeof(Magic)] != FormatZlib || UncompressedSize > MaxUncompressedSize)
+	{
+		return false;
+	}
+
+	OutFrame.SetNumUninitialized(UncompressedSize);
+	if (FCompression::UncompressMemory(NAME_Zlib, OutFrame.GetData(), UncompressedSize, Bytes + HeaderSize, static_cast<int32>(Size - HeaderSize)) == false)
+	{
+		OutFrame.Reset();
+		return false;
+	}
+
+	FHubCompressionStats& Stats = GetStats();
+	++Stats.FramesDecompressed;
+	Stats.BytesBeforeDecompression += Size;
+	Stats.BytesAfterDecompression += UncompressedSize;
+	Stats.DecompressCycles += FPlatformTime::Cycles64() - StartCycles;
+
+	return true;
+}
+
+FHubCompressionStats& FHubFrameCompression::GetStats()
+{
+	static FHubCompressionStats Stats;
+	return Stats;
+}
@@ -0,0 +1,45 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Counters of frame compression, shared by all socket systems of the process
+ */
+struct FHubCompressionStats
+{
+	std::atomic<uint64> FramesCompressed = 0;
+	std::atomic<uint64> BytesBeforeCompression = 0;
+	std::atomic<uint64> BytesAfterCompression = 0;
+	std::atomic<uint64> CompressCycles = 0;
+
+	std::atomic<uint64> FramesDecompressed = 0;
+	std::atomic<uint64> BytesBeforeDecompression = 0;
+	std::atomic<uint64> BytesAfterDecompression = 0;
+	std::atomic<uint64> DecompressCycles = 0;
+
+	// compressed size / original size, lower is better
+	double GetCompressionRatio() const;
+	double GetDecompressionRatio() const;
+	double GetCompressMicrosecondsPerFrame() const;
+	double GetDecompressMicrosecondsPerFrame() const;
+
+	FString ToString() const;
+};
+
+/**
+ * Application level compression of hub frames
+ * WebSockets module does not expose permessage-deflate negotiation, so large messages sent as binary frames:
+ * "BFZ" magic, format version, uncompressed size (uint32 little endian), zlib stream of the frame in connection wire format
+ */
+struct BFHUBSOCKETS_API FHubFrameCompression
+{
+	static bool Compress(TConstArrayView<uint8> Frame, TArray<uint8>& OutFrame);
+
+	static bool IsCompressedFrame(const void* Data, SIZE_T Size);
+	static bool Decompress(const void* Data, SIZE_T Size, TArray<uint8>& OutFrame);
+
+	static FHubCompressionStats& GetStats();
+
+	static constexpr int32 HeaderSize = 8;
+};
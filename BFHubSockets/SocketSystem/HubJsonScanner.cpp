@@ -0,0 +1,226 @@
+﻿#include "HubJsonScanner.h"
+
+#include "HubDecodeArena.h"
+
+namespace HubJsonScanner
+{
+	template <typename CharType>
+	bool TryParseHex(const TStringView<CharType> Text, uint32& OutValue)
+	{
+		OutValue = 0;
+		for (const CharType Char : Text)
+		{
+			if (FChar::IsHexDigit(static_cast<TCHAR>(Char)) == false)
+			{
+				return false;
+			}
+			OutValue = (OutValue << 4) | FParse::HexDigit(static_cast<TCHAR>(Char));
+		}
+		return true;
+	}
+
+	// Writes into memory sized for the whole string
+	template <typename CharType>
+	struct TFixedStringWriter
+	{
+		CharType* Data = nullptr;
+		int32 Len = 0;
+
+		void Add(const CharType Char) { Data[Len++] = Char; }
+		void AppendChar(const CharType Char) { Data[Len++] = Char; }
+
+		void Append(const CharType* Chars, const int32 Num)
+		{
+			FMemory::Memcpy(Data + Len, Chars, Num * sizeof(CharType));
+			Len += Num;
+		}
+	};
+
+	template <typename StringType>
+	void AppendCodePoint(StringType& OutString, const uint32 CodePoint)
+	{
+		if (sizeof(TCHAR) == 4 || CodePoint <= 0xFFFF)
+		{
+			OutString.AppendChar(static_cast<TCHAR>(CodePoint));
+			return;
+		}
+
+		OutString.AppendChar(static_cast<TCHAR>(0xD800 + ((CodePoint - 0x10000) >> 10)));
+		OutString.AppendChar(static_cast<TCHAR>(0xDC00 + ((CodePoint - 0x10000) & 0x3FF)));
+	}
+
+	template <typename StringType>
+	void AppendUtf8CodePoint(StringType& OutString, const uint32 CodePoint)
+	{
+		if (CodePoint < 0x80)
+		{
+			OutString.Add(static_cast<UTF8CHAR>(CodePoint));
+		}
+		else if (CodePoint < 0x800)
+		{
+			OutString.Add(static_cast<UTF8CHAR>(0xC0 | (CodePoint >> 6)));
+			OutString.Add(static_cast<UTF8CHAR>(0x80 | (CodePoint & 0x3F)));
+		}
+		else if (CodePoint < 0x10000)
+		{
+			OutString.Add(static_cast<UTF8CHAR>(0xE0 | (CodePoint >> 12)));
+			OutString.Add(static_cast<UTF8CHAR>(0x80 | ((CodePoint >> 6) & 0x3F)));
+			OutString.Add(static_cast<UTF8CHAR>(0x80 | (CodePoint & 0x3F)));
+		}
+		else
+		{
+			OutString.Add(static_cast<UTF8CHAR>(0xF0 | (CodePoint >> 18)));
+			OutString.Add(static_cast<UTF8CHAR>(0x80 | ((CodePoint >> 12) & 0x3F)));
+			OutString.Add(static_cast<UTF8CHAR>(0x80 | ((CodePoint >> 6) & 0x3F)));
+			OutString.Add(static_cast<UTF8CHAR>(0x80 | (CodePoint & 0x3F)));
+		}
+	}
+
+	/**
+	 * Text between escapes is appended by runs, so utf-8 is converted once per run and not per char
+	 */
+	template <typename CharType, typename AppendRunType, typename AppendCodePointType>
+	bool Unescape(const TStringView<CharType> Raw, AppendRunType&& AppendRun, AppendCodePointType&& AppendCodePoint)
+	{
+		int32 RunStart = 0;
+		for (int32 Index = 0; Index < Raw.Len(); ++Index)
+		{
+			if (Raw[Index] != '\\')
+			{
+				continue;
+			}
+
+			AppendRun(Raw.Mid(RunStart, Index - RunStart));
+
+			if (++Index >= Raw.Len())
+			{
+				return false;
+			}
+
+			switch (static_cast<uint32>(Raw[Index]))
+			{
+			case '"': AppendCodePoint('"'); break;
+			case '\\': AppendCodePoint('\\'); break;
+			case '/': AppendCodePoint('/'); break;
+			case 'b': AppendCodePoint('\b'); break;
+			case 'f': AppendCodePoint('\f'); break;
+			case 'n': AppendCodePoint('\n'); break;
+			case 'r': AppendCodePoint('\r'); break;
+			case 't': AppendCodePoint('\t'); break;
+			case 'u':
+				{
+					uint32 CodePoint = 0;
+					if (Index + 4 >= Raw.Len() || TryParseHex(Raw.Mid(Index + 1, 4), CodePoint) == false)
+					{
+						return false;
+					}
+					Index += 4;
+
+					// surrogate pair comes as two escapes in a row
+					uint32 LowSurrogate = 0;
+					if (CodePoint >= 0xD800 && CodePoint <= 0xDBFF && Index + 6 < Raw.Len() && Raw[Index + 1] == '\\' && Raw[Index + 2] == 'u'
+						&& TryParseHex(Raw.Mid(Index + 3, 4), LowSurrogate) && LowSurrogate >= 0xDC00 && LowSurrogate <= 0xDFFF)
+					{
+						CodePoint = 0x10000 + ((CodePoint - 0xD800) << 10) + (LowSurrogate - 0xDC00);
+						Index += 6;
+					}
+
+					AppendCodePoint(CodePoint);
+					break;
+				}
+			default:
+				return false;
+			}
+
+			RunStart = Index + 1;
+		}
+
+		AppendRun(Raw.Mid(RunStart));
+		return true;
+	}
+}
+
+bool HubJson::Unescape(const FUtf8StringView Raw, FString& OutString)
+{
+	OutString.Reset(Raw.Len());
+	return HubJsonScanner::Unescape(Raw,
+		[&OutString](const FUtf8StringView Run)
+		{
+			const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Run.GetData()), Run.Len());
+			OutString.Append(Converted.Get(), Converted.Length());
+		},
+		[&OutString](const uint32 CodePoint) { HubJsonScanner::AppendCodePoint(OutString, CodePoint); });
+}
+
+bool HubJson::Unescape(const FUtf8StringView Raw, TArray<UTF8CHAR>& OutString)
+{
+	OutString.Reset(Raw.Len());
+	return HubJsonScanner::Unescape(Raw,
+		[&OutString](const FUtf8StringView Run) { OutString.Append(Run.GetData(), Run.Len()); },
+		[&OutString](const uint32 CodePoint) { HubJsonScanner::AppendUtf8CodePoint(OutString, CodePoint); });
+}
+
+bool HubJson::Unescape(const FStringView Raw, FHubDecodeArena& Arena, FStringView& OutString)
+{
+	HubJsonScanner::TFixedStringWriter<TCHAR> Writer{Arena.AllocateArray<TCHAR>(Raw.Len()).GetData()};
+	const bool bUnescaped = HubJsonScanner::Unescape(Raw,
+		[&Writer](const FStringView Run) { Writer.Append(Run.GetData(), Run.Len()); },
+		[&Writer](const uint32 CodePoint) { HubJsonScanner::AppendCodePoint(Writer, CodePoint); });
+
+	OutString = FStringView(Writer.Data, Writer.Len);
+	return bUnescaped;
+}
+
+bool HubJson::Unescape(const FUtf8StringView Raw, FHubDecodeArena& Arena, FUtf8StringView& OutString)
+{
+	HubJsonScanner::TFixedStringWriter<UTF8CHAR> Writer{Arena.AllocateArray<UTF8CHAR>(Raw.Len()).GetData()};
+	const bool bUnescaped = HubJsonScanner::Unescape(Raw,
+		[&Writer](const FUtf8StringView Run) { Writer.Append(Run.GetData(), Run.Len()); },
+		[&Writer](const uint32 CodePoint) { HubJsonScanner::AppendUtf8CodePoint(Writer, CodePoint); });
+
+	OutString = FUtf8StringView(Writer.Data, Writer.Len);
+	return bUnescaped;
+}
+
+void HubJson::AppendQuoted(const FUtf8StringView Text, TArray<uint8>& OutJson)
+{
+	static constexpr ANSICHAR HexDigits[] = "0123456789abcdef";
+
+	// escapes are rare, text between them is copied in runs
+	OutJson.Reserve(OutJson.Num() + Text.Len() + 2);
+	OutJson.Add('"');
+
+	int32 RunStart = 0;
+	for (int32 Index = 0; Index < Text.Len(); ++Index)
+	{
+		const uint8 Char = static_cast<uint8>(Text[Index]);
+		if (Char >= 0x20 && Char != '"' && Char != '\\')
+		{
+			continue;
+		}
+
+		OutJson.Append(reinterpret_cast<const uint8*>(Text.GetData()) + RunStart, Index - RunStart);
+		RunStart = Index + 1;
+
+		OutJson.Add('\\');
+		switch (Char)
+		{
+		case '"': OutJson.Add('"'); break;
+		case '\\': OutJson.Add('\\'); break;
+		case '\b': OutJson.Add('b'); break;
+		case '\f': OutJson.Add('f'); break;
+		case '\n': OutJson.Add('n'); break;
+		case '\r': OutJson.Add('r'); break;
+		case '\t': OutJson.Add('t'); break;
+		default:
+			{
+				const uint8 Escape[] = {'u', '0', '0', static_cast<uint8>(HexDigits[Char >> 4]), static_cast<uint8>(HexDigits[Char & 0xF])};
+				OutJson.Append(Escape, UE_ARRAY_COUNT(Escape));
+			}
+			break;
+		}
+	}
+
+	OutJson.Append(reinterpret_cast<const uint8*>(Text.GetData()) + RunStart, Text.Len() - RunStart);
+	OutJson.Add('"');
+}
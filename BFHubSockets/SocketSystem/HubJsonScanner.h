@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <type_traits>
+
+class FHubDecodeArena;
+
+/**
+ * Minimal forward only json scanner, enough to walk over envelope object and codec structs
+ * Works over TCHAR text and over utf-8 bytes of the frame, values we are not interested in are skipped without building any DOM
+ */
+template <typename CharType>
+class THubJsonScanner
+{
+public:
+	using FView = TStringView<CharType>;
+
+	explicit THubJsonScanner(const FView Text)
+		: Current(Text.GetData())
+		, End(Text.GetData() + Text.Len())
+	{
+	}
+
+	static bool IsWhitespace(const CharType Char)
+	{
+		return Char == ' ' || Char == '\t' || Char == '\n' || Char == '\r';
+	}
+
+	static bool IsDigit(const CharType Char)
+	{
+		return Char >= '0' && Char <= '9';
+	}
+
+	void SkipWhitespace()
+	{
+		while (Current < End && IsWhitespace(*Current))
+		{
+			++Current;
+		}
+	}
+
+	bool TryConsume(const ANSICHAR Char)
+	{
+		SkipWhitespace();
+		if (Current < End && *Current == Char)
+		{
+			++Current;
+			return true;
+		}
+		return false;
+	}
+
+	// 0 at the end of text
+	ANSICHAR Peek()
+	{
+		SkipWhitespace();
+		return Current < End && *Current < 0x80 ? static_cast<ANSICHAR>(*Current) : 0;
+	}
+
+	bool IsAtEnd()
+	{
+		SkipWhitespace();
+		return Current >= End;
+	}
+
+	// Returns raw string content between quotes, escapes are not processed
+	bool ReadString(FView& OutRaw, bool& bOutHasEscapes)
+	{
+		if (TryConsume('"') == false)
+		{
+			return false;
+		}
+
+		bOutHasEscapes = false;
+		const CharType* Begin = Current;
+		while (Current < End)
+		{
+			if (*Current == '\\')
+			{
+				bOutHasEscapes = true;
+				Current += 2;
+				continue;
+			}
+			if (*Current == '"')
+			{
+				OutRaw = FView(Begin, static_cast<int32>(Current - Begin));
+				++Current;
+				return true;
+			}
+			++Current;
+		}
+		return false;
+	}
+
+	bool ReadInteger(int64& OutValue)
+	{
+		SkipWhitespace();
+
+		const bool bNegative = Current < End && *Current == '-';
+		if (bNegative)
+		{
+			++Current;
+		}
+
+		const CharType* Begin = Current;
+		int64 Value = 0;
+		while (Current < End && IsDigit(*Current))
+		{
+			Value = Value * 10 + (*Current - '0');
+			++Current;
+		}
+
+		// fraction or exponent is not expected in envelope integers, skip it as hub sends them sometimes
+		while (Current < End && (*Current == '.' || *Current == 'e' || *Current == 'E' || *Current == '+' || *Current == '-' || IsDigit(*Current)))
+		{
+			++Current;
+		}
+
+		OutValue = bNegative ? -Value : Value;
+		return Current != Begin;
+	}
+
+	// Skips any value and returns its raw text
+	bool SkipValue(FView& OutRaw)
+	{
+		SkipWhitespace();
+		const CharType* Begin = Current;
+
+		bool bHasEscapes = false;
+		FView Unused;
+		switch (Peek())
+		{
+		case '"':
+			if (ReadString(Unused, bHasEscapes) == false)
+			{
+				return false;
+			}
+			break;
+		case '{':
+		case '[':
+			if (SkipContainer() == false)
+			{
+				return false;
+			}
+			break;
+		default:
+			// number, true, false, null
+			while (Current < End && *Current != ',' && *Current != '}' && *Current != ']' && IsWhitespace(*Current) == false)
+			{
+				++Current;
+			}
+			if (Current == Begin)
+			{
+				return false;
+			}
+			break;
+		}
+
+		OutRaw = FView(Begin, static_cast<int32>(Current - Begin));
+		return true;
+	}
+
+private:
+	bool SkipContainer()
+	{
+		int32 Depth = 0;
+		while (Current < End)
+		{
+			const CharType Char = *Current;
+			if (Char == '"')
+			{
+				bool bHasEscapes = false;
+				FView Unused;
+				if (ReadString(Unused, bHasEscapes) == false)
+				{
+					return false;
+				}
+				continue;
+			}
+
+			++Current;
+			if (Char == '{' || Char == '[')
+			{
+				++Depth;
+			}
+			else if (Char == '}' || Char == ']')
+			{
+				if (--Depth == 0)
+				{
+					return true;
+				}
+			}
+		}
+		return false;
+	}
+
+	const CharType* Current;
+	const CharType* End;
+};
+
+namespace HubJson
+{
+	// Text of TCHAR or utf-8 view as FString
+	template <typename CharType>
+	FString ToString(const TStringView<CharType> Text)
+	{
+		if constexpr (std::is_same_v<CharType, TCHAR>)
+		{
+			return FString(Text);
+		}
+		else
+		{
+			const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Text.GetData()), Text.Len());
+			return FString(Converted.Length(), Converted.Get());
+		}
+	}
+
+	template <typename CharType>
+	bool IsNull(const TStringView<CharType> Raw)
+	{
+		return Raw.Len() == 4 && Raw[0] == 'n' && Raw[1] == 'u' && Raw[2] == 'l' && Raw[3] == 'l';
+	}
+
+	// Json string content without quotes, escapes processed
+	BFHUBSOCKETS_API bool Unescape(FUtf8StringView Raw, FString& OutString);
+
+	// Stays utf-8, used for string encoded payload which is parsed as utf-8 json later
+	BFHUBSOCKETS_API bool Unescape(FUtf8StringView Raw, TArray<UTF8CHAR>& OutString);
+
+	// Utf-8 text as quoted json string, escaped the same way as TJsonWriter does it
+	BFHUBSOCKETS_API void AppendQuoted(FUtf8StringView Text, TArray<uint8>& OutJson);
+
+	// Unescaped text is never longer than raw one, so it is written into single arena allocation
+	BFHUBSOCKETS_API bool Unescape(FStringView Raw, FHubDecodeArena& Arena, FStringView& OutString);
+	BFHUBSOCKETS_API bool Unescape(FUtf8StringView Raw, FHubDecodeArena& Arena, FUtf8StringView& OutString);
+
+	// Ascii field name compared case insensitive, the same way as FJsonObjectConverter does
+	template <typename CharType>
+	bool IsKey(const TStringView<CharType> Key, const TCHAR* Name)
+	{
+		int32 Index = 0;
+		for (; Name[Index] != 0; ++Index)
+		{
+			if (Index >= Key.Len() || FChar::ToLower(static_cast<TCHAR>(Key[Index])) != FChar::ToLower(Name[Index]))
+			{
+				return false;
+			}
+		}
+		return Index == Key.Len();
+	}
+}
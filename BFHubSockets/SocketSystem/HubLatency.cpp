@@ -0,0 +1,165 @@
+﻿#include "HubLatency.h"
+
+void FHubRttEstimator::AddSample(const double RttSeconds, const double Now)
+{
+	if (RttSeconds < 0.0)
+	{
+		return;
+	}
+
+	// RFC 6298: alpha 1/8, beta 1/4, first sample initializes both
+	if (NumSamples == 0)
+	{
+		Smoothed = RttSeconds;
+		Variance = RttSeconds / 2.0;
+	}
+	else
+	{
+		Variance = 0.75 * Variance + 0.25 * FMath::Abs(Smoothed - RttSeconds);
+		Smoothed = 0.875 * Smoothed + 0.125 * RttSeconds;
+	}
+	Latest = RttSeconds;
+	++NumSamples;
+
+	// monotonic window: bigger older samples can never become minimum again
+	while (MinWindow.IsEmpty() == false && MinWindow.Last().Value >= RttSeconds)
+	{
+		MinWindow.Pop();
+	}
+	MinWindow.Add({Now, RttSeconds});
+
+	int32 NumExpired = 0;
+	while (NumExpired < MinWindow.Num() - 1 && MinWindow[NumExpired].Time < Now - MinWindowSeconds)
+	{
+		++NumExpired;
+	}
+	MinWindow.RemoveAt(0, NumExpired);
+
+	Histogram.Record(static_cast<uint64>(RttSeconds * 1e9));
+}
+
+void FHubRttEstimator::Reset()
+{
+	NumSamples = 0;
+	Latest = 0.0;
+	Smoothed = 0.0;
+	Variance = 0.0;
+	MinWindow.Reset();
+	Histogram.Reset();
+}
+
+double FHubRttEstimator::GetTimeout(const double MinSeconds) const
+{
+	if (NumSamples == 0)
+	{
+		return MinSeconds;
+	}
+	return FMath::Max(MinSeconds, Smoothed + 4.0 * Variance);
+}
+
+FHubClockSync::FHubClockSync()
+{
+	Reset();
+}
+
+void FHubClockSync::AddSample(const double SendTime, const double ReceiveTime, const int64 HubTimestampMs)
+{
+	if (ReceiveTime < SendTime || HubTimestampMs <= 0)
+	{
+		return;
+	}
+
+	FSample Sample;
+	Sample.LocalTime = (SendTime + ReceiveTime) / 2.0;
+	Sample.OffsetMs = HubTimestampMs - ToLocalMs(Sample.LocalTime);
+	Sample.RttMs = (ReceiveTime - SendTime) * 1000.0;
+
+	if (Samples.Num() >= MaxSamples)
+	{
+		Samples.RemoveAt(0);
+	}
+	Samples.Add(Sample);
+
+	UpdateEstimate();
+}
+
+void FHubClockSync::Reset()
+{
+	// wall clock is read once, later time comes from monotonic clock
+	MonotonicAnchor = FPlatformTime::Seconds();
+	const FDateTime UtcNow = FDateTime::UtcNow();
+	WallAnchorMs = UtcNow.ToUnixTimestamp() * 1000.0 + UtcNow.GetMillisecond();
+
+	Samples.Reset();
+	ReferenceIndex = INDEX_NONE;
+	Drift = 0.0;
+}
+
+double FHubClockSync::GetOffsetMs(const double LocalTime) const
+{
+	if (Samples.IsValidIndex(ReferenceIndex) == false)
+	{
+		return 0.0;
+	}
+
+	const FSample& Reference = Samples[ReferenceIndex];
+	return Reference.OffsetMs + Drift * (LocalTime - Reference.LocalTime) * 1000.0;
+}
+
+double FHubClockSync::GetUncertaintyMs() const
+{
+	return Samples.IsValidIndex(ReferenceIndex) ? Samples[ReferenceIndex].RttMs / 2.0 : 0.0;
+}
+
+double FHubClockSync::HubToLocal(const int64 HubTimestampMs) const
+{
+	// offset depends on time being converted, one refinement is enough for ppm drift
+	const double Guess = MonotonicAnchor + (HubTimestampMs - GetOffsetMs(FPlatformTime::Seconds()) - WallAnchorMs) / 1000.0;
+	return MonotonicAnchor + (HubTimestampMs - GetOffsetMs(Guess) - WallAnchorMs) / 1000.0;
+}
+
+int64 FHubClockSync::LocalToHub(const double LocalTime) const
+{
+	return FMath::RoundToInt64(ToLocalMs(LocalTime) + GetOffsetMs(LocalTime));
+}
+
+void FHubClockSync::UpdateEstimate()
+{
+	// sample with smallest RTT has smallest error of offset
+	ReferenceIndex = Samples.Num() - 1;
+	for (int32 Index = FMath::Max(0, Samples.Num() - FilterSamples); Index < Samples.Num(); ++Index)
+	{
+		if (Samples[Index].RttMs < Samples[ReferenceIndex].RttMs)
+		{
+			ReferenceIndex = Index;
+		}
+	}
+
+	if (Samples.Last().LocalTime - Samples[0].LocalTime < MinDriftSpanSeconds)
+	{
+		Drift = 0.0;
+		return;
+	}
+
+	// least squares slope of offset over time
+	double MeanTime = 0.0;
+	double MeanOffset = 0.0;
+	for (const FSample& Sample : Samples)
+	{
+		MeanTime += Sample.LocalTime;
+		MeanOffset += Sample.OffsetMs;
+	}
+	MeanTime /= Samples.Num();
+	MeanOffset /= Samples.Num();
+
+	double Covariance = 0.0;
+	double TimeVariance = 0.0;
+	for (const FSample& Sample : Samples)
+	{
+		Covariance += (Sample.LocalTime - MeanTime) * (Sample.OffsetMs - MeanOffset);
+		TimeVariance += FMath::Square(Sample.LocalTime - MeanTime);
+	}
+
+	// offset milliseconds per local second into milliseconds per millisecond
+	Drift = FMath::Clamp(Covariance / TimeVariance / 1000.0, -MaxDrift, MaxDrift);
+}
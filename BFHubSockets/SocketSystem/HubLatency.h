@@ -0,0 +1,109 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubActionMetrics.h"
+
+/**
+ * Round trip time of hub connection on monotonic clock (FPlatformTime::Seconds)
+ * Smoothed RTT and its variance as in RFC 6298, windowed minimum and histogram of all samples
+ */
+class BFHUBSOCKETS_API FHubRttEstimator
+{
+public:
+	void AddSample(double RttSeconds, double Now);
+	void Reset();
+
+	bool HasSamples() const { return NumSamples > 0; }
+	int32 GetNumSamples() const { return NumSamples; }
+
+	double GetLatest() const { return Latest; }
+	double GetSmoothed() const { return Smoothed; }
+	// Mean deviation of samples from smoothed RTT
+	double GetVariance() const { return Variance; }
+	// Minimum during MinWindowSeconds, closest to network path delay without queueing
+	double GetMin() const { return MinWindow.IsEmpty() ? 0.0 : MinWindow[0].Value; }
+
+	/** Time to wait for answer before it is considered lost: smoothed RTT + 4 variances, not less than MinSeconds
+	 * MinSeconds is returned until first sample */
+	double GetTimeout(double MinSeconds) const;
+
+	// Samples in nanoseconds
+	const FHubHistogram& GetHistogram() const { return Histogram; }
+
+	static constexpr double MinWindowSeconds = 300.0;
+
+private:
+	struct FWindowSample
+	{
+		double Time = 0.0;
+		double Value = 0.0;
+	};
+
+	int32 NumSamples = 0;
+	double Latest = 0.0;
+	double Smoothed = 0.0;
+	double Variance = 0.0;
+
+	// Ascending by value and by time, front is the minimum
+	TArray<FWindowSample> MinWindow;
+	FHubHistogram Histogram;
+};
+
+/**
+ * Offset and drift of hub clock against local monotonic clock, NTP style
+ * Every sample is request send time, response receive time and hub timestamp taken between them,
+ * hub time is assumed to be in the middle of the round trip, so error of a sample is within half of its RTT
+ * Offset is taken from the sample with the smallest RTT of recent ones, drift is fitted over all kept samples
+ */
+class BFHUBSOCKETS_API FHubClockSync
+{
+public:
+	FHubClockSync();
+
+	// Send and receive time on FPlatformTime::Seconds clock, hub timestamp in unix milliseconds
+	void AddSample(double SendTime, double ReceiveTime, int64 HubTimestampMs);
+	void Reset();
+
+	bool IsSynchronized() const { return Samples.IsEmpty() == false; }
+
+	// Hub clock minus local clock at the time, milliseconds
+	double GetOffsetMs(double LocalTime) const;
+	// Hub clock rate against local clock, parts per million
+	double GetDriftPpm() const { return Drift * 1e6; }
+	// Error bound of offset, half of RTT of the sample it is taken from
+	double GetUncertaintyMs() const;
+
+	// Hub timestamp as FPlatformTime::Seconds time
+	double HubToLocal(int64 HubTimestampMs) const;
+	int64 LocalToHub(double LocalTime) const;
+	int64 GetHubNow() const { return LocalToHub(FPlatformTime::Seconds()); }
+
+	static constexpr int32 MaxSamples = 16;
+	// offset is taken from the best of these last samples
+	static constexpr int32 FilterSamples = 8;
+	// shorter span gives drift of RTT noise rather than of clocks
+	static constexpr double MinDriftSpanSeconds = 60.0;
+	// crystal clocks are within hundreds of ppm, anything bigger is noise
+	static constexpr double MaxDrift = 1e-3;
+
+private:
+	struct FSample
+	{
+		double LocalTime = 0.0;
+		double OffsetMs = 0.0;
+		double RttMs = 0.0;
+	};
+
+	// Local monotonic clock in unix milliseconds, anchored once, so wall clock adjustments do not move it
+	double ToLocalMs(double LocalTime) const { return WallAnchorMs + (LocalTime - MonotonicAnchor) * 1000.0; }
+	void UpdateEstimate();
+
+	double MonotonicAnchor = 0.0;
+	double WallAnchorMs = 0.0;
+
+	TArray<FSample> Samples;
+
+	int32 ReferenceIndex = INDEX_NONE;
+	// milliseconds of offset change per millisecond
+	double Drift = 0.0;
+};
@@ -0,0 +1,79 @@
+﻿#include "HubLiveness.h"
+
+void FHubLiveness::Configure(const double InMinInterval, const double InMaxInterval, const int32 InMaxMissedBeats)
+{
+	MinInterval = InMinInterval;
+	MaxInterval = FMath::Max(InMinInterval, InMaxInterval);
+	MaxMissedBeats = FMath::Max(1, InMaxMissedBeats);
+}
+
+void FHubLiveness::Start(const double Now)
+{
+	bActive = true;
+	LastReceiveTime = Now;
+	Interval = MinInterval;
+	BeatSentTime = 0.0;
+	MissedBeats = 0;
+}
+
+void FHubLiveness::Stop()
+{
+	bActive = false;
+	BeatSentTime = 0.0;
+}
+
+void FHubLiveness::OnReceived(const double Now)
+{
+	LastReceiveTime = Now;
+
+	// answered heartbeat means connection is quiet, not dead: beat less often
+	if (BeatSentTime > 0.0)
+	{
+		BeatSentTime = 0.0;
+		MissedBeats = 0;
+		Interval = FMath::Min(Interval * 2.0, MaxInterval);
+	}
+}
+
+void FHubLiveness::OnSent(const double Now)
+{
+	// requests go out and nothing comes back, it is the case when half-open connection loses them
+	if (bActive && BeatSentTime == 0.0 && Now - LastReceiveTime > MinInterval)
+	{
+		Interval = MinInterval;
+	}
+}
+
+FHubLiveness::EAction FHubLiveness::Tick(const double Now, const double BeatTimeout)
+{
+	if (bActive == false)
+	{
+		return EAction::None;
+	}
+
+	if (BeatSentTime > 0.0)
+	{
+		if (Now - BeatSentTime < BeatTimeout)
+		{
+			return EAction::None;
+		}
+
+		if (++MissedBeats >= MaxMissedBeats)
+		{
+			Stop();
+			return EAction::Dead;
+		}
+
+		// beat or its answer could be lost alone, connection gets another chance
+		BeatSentTime = Now;
+		return EAction::SendBeat;
+	}
+
+	if (Now - LastReceiveTime >= Interval)
+	{
+		BeatSentTime = Now;
+		return EAction::SendBeat;
+	}
+
+	return EAction::None;
+}
@@ -0,0 +1,48 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+/**
+ * Detects half-open control connection: socket looks connected, but nothing comes from hub
+ * Any inbound data proves connection is alive, heartbeat is sent only after silence of keepalive interval
+ * Interval grows while heartbeats are answered on quiet connection and drops to minimum when messages are sent into silence
+ * Dead connection is reported not later than MaxInterval + MaxMissedBeats * beat timeout after last inbound data
+ */
+class BFHUBSOCKETS_API FHubLiveness
+{
+public:
+	enum class EAction : uint8
+	{
+		None,
+		SendBeat,
+		Dead,
+	};
+
+	void Configure(double InMinInterval, double InMaxInterval, int32 InMaxMissedBeats);
+
+	// Connection established, silence is counted from now
+	void Start(double Now);
+	void Stop();
+	bool IsActive() const { return bActive; }
+
+	void OnReceived(double Now);
+	void OnSent(double Now);
+
+	// BeatTimeout is how long heartbeat answer is waited for, Dead stops the check
+	EAction Tick(double Now, double BeatTimeout);
+
+	double GetSilence(double Now) const { return Now - LastReceiveTime; }
+	double GetInterval() const { return Interval; }
+
+private:
+	double MinInterval = 5.0;
+	double MaxInterval = 20.0;
+	int32 MaxMissedBeats = 2;
+
+	bool bActive = false;
+	double LastReceiveTime = 0.0;
+	double Interval = 0.0;
+	// 0 - no heartbeat waits for answer
+	double BeatSentTime = 0.0;
+	int32 MissedBeats = 0;
+};
@@ -0,0 +1,392 @@
+﻿#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HubSocketSystem.h"
+#include "HubLoopbackWebSocket.h"
+#include "HubOrderedDispatcher.h"
+#include "HubWireSerializer.h"
+#include "BFHubSockets/Services/GameServerAPI/BFHubService_ServerInit.h"
+#include "Misc/App.h"
+#include "Misc/DateTime.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Policies/CondensedJsonPrintPolicy.h"
+#include "Serialization/JsonWriter.h"
+#include "UObject/Package.h"
+
+#include "Logging/StructuredLog.h"
+
+#if !UE_BUILD_SHIPPING
+
+namespace HubLoopbackBenchmark
+{
+	/**
+	 * Counts allocations while installed over GMalloc, everything else goes to the wrapped allocator
+	 * Count is process-wide: allocations of other threads during the run are included
+	 * Never destroyed, a thread may still be inside the proxy after it is removed
+	 */
+	class FCountingMalloc final : public FMalloc
+	{
+	public:
+		explicit FCountingMalloc(FMalloc* InInner)
+			: Inner(InInner)
+		{
+		}
+
+		virtual void* Malloc(SIZE_T Count, uint32 Alignment) override
+		{
+			++Allocations;
+			return Inner->Malloc(Count, Alignment);
+		}
+
+		virtual void* TryMalloc(SIZE_T Count, uint32 Alignment) override
+		{
+			++Allocations;
+			return Inner->TryMalloc(Count, Alignment);
+		}
+
+		virtual void* Realloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			++Allocations;
+			return Inner->Realloc(Original, Count, Alignment);
+		}
+
+		virtual void* TryRealloc(void* Original, SIZE_T Count, uint32 Alignment) override
+		{
+			++Allocations;
+			return Inner->TryRealloc(Original, Count, Alignment);
+		}
+
+		virtual void Free(void* Original) override { Inner->Free(Original); }
+		virtual SIZE_T QuantizeSize(SIZE_T Count, uint32 Alignment) override { return Inner->QuantizeSize(Count, Alignment); }
+		virtual bool GetAllocationSize(void* Original, SIZE_T& SizeOut) override { return Inner->GetAllocationSize(Original, SizeOut); }
+		virtual void Trim(bool bTrimThreadCaches) override { Inner->Trim(bTrimThreadCaches); }
+		virtual void SetupTLSCachesOnCurrentThread() override { Inner->SetupTLSCachesOnCurrentThread(); }
+		virtual void ClearAndDisableTLSCachesOnCurrentThread() override { Inner->ClearAndDisableTLSCachesOnCurrentThread(); }
+		virtual bool IsInternallyThreadSafe() const override { return Inner->IsInternallyThreadSafe(); }
+		virtual void GetAllocatorStats(FGenericMemoryStats& OutStats) override { Inner->GetAllocatorStats(OutStats); }
+		virtual void DumpAllocatorStats(FOutputDevice& Ar) override { Inner->DumpAllocatorStats(Ar); }
+		virtual bool ValidateHeap() override { return Inner->ValidateHeap(); }
+		virtual const TCHAR* GetDescriptiveName() override { return Inner->GetDescriptiveName(); }
+
+		std::atomic<uint64> Allocations = 0;
+
+	private:
+		FMalloc* Inner;
+	};
+
+	FCountingMalloc& GetCountingMalloc()
+	{
+		static FCountingMalloc* CountingMalloc = new FCountingMalloc(GMalloc);
+		return *CountingMalloc;
+	}
+
+	// Value at fraction of sorted samples
+	double Percentile(const TArray<double>& Sorted, const double Fraction)
+	{
+		if (Sorted.IsEmpty())
+		{
+			return 0.0;
+		}
+		const int32 Index = FMath::CeilToInt(Fraction * Sorted.Num()) - 1;
+		return Sorted[FMath::Clamp(Index, 0, Sorted.Num() - 1)];
+	}
+}
+
+/**
+ * Load benchmark of the whole socket system against FHubLoopbackWebSocket:
+ * Send<T>, batching, compression, frame reassembly, decode and handler dispatch in one round trip per message
+ * Every simulated game frame sends PerFrame messages, ticks the system and pumps the socket
+ * Results are written as json into Saved/HubSockets/Benchmarks, so runs can be compared by scripts
+ */
+class FHubLoopbackBenchmark
+{
+public:
+	struct FConfig
+	{
+		int32 Messages = 100000;
+		int32 PerFrame = 100;
+		// Approximate payload size in bytes
+		int32 Size = 64;
+		int32 Actions = 16;
+		// Inbound frames are split into fragments of this size, 0 - whole frames
+		int32 Fragment = 0;
+		bool bCountAllocations = true;
+		EHubWireFormat WireFormat = EHubWireFormat::Json;
+	};
+
+	struct FResult
+	{
+		int32 Sent = 0;
+		int32 Received = 0;
+		int32 Rejected = 0;
+		int32 Frames = 0;
+		double ElapsedSeconds = 0.0;
+		double MessagesPerSecond = 0.0;
+		double LatencyP50Us = 0.0;
+		double LatencyP99Us = 0.0;
+		double LatencyP999Us = 0.0;
+		double LatencyMaxUs = 0.0;
+		// -1 when not counted
+		double AllocationsPerMessage = -1.0;
+		double FrameAvgMs = 0.0;
+		double FrameP99Ms = 0.0;
+		uint64 FramesOnWire = 0;
+		uint64 BytesOnWire = 0;
+	};
+
+	static void Run(const TArray<FString>& Args);
+
+private:
+	static FConfig ParseConfig(const TArray<FString>& Args);
+	static FResult RunScenario(const FConfig& Config);
+	static FString ToJson(const FConfig& Config, const FResult& Result);
+};
+
+FHubLoopbackBenchmark::FConfig FHubLoopbackBenchmark::ParseConfig(const TArray<FString>& Args)
+{
+	FConfig Config;
+	FString Format;
+	for (const FString& Arg : Args)
+	{
+		FParse::Value(*Arg, TEXT("Messages="), Config.Messages);
+		FParse::Value(*Arg, TEXT("PerFrame="), Config.PerFrame);
+		FParse::Value(*Arg, TEXT("Size="), Config.Size);
+		FParse::Value(*Arg, TEXT("Actions="), Config.Actions);
+		FParse::Value(*Arg, TEXT("Fragment="), Config.Fragment);
+		FParse::Bool(*Arg, TEXT("Allocs="), Config.bCountAllocations);
+		FParse::Value(*Arg, TEXT("Format="), Format);
+	}
+
+	Config.Messages = FMath::Max(Config.Messages, 1);
+	Config.PerFrame = FMath::Max(Config.PerFrame, 1);
+	Config.Size = FMath::Max(Config.Size, 0);
+	Config.Actions = FMath::Max(Config.Actions, 1);
+	Config.Fragment = FMath::Max(Config.Fragment, 0);
+	if (Format.Equals(TEXT("MessagePack"), ESearchCase::IgnoreCase))
+	{
+		Config.WireFormat = EHubWireFormat::MessagePack;
+	}
+	return Config;
+}
+
+FHubLoopbackBenchmark::FResult FHubLoopbackBenchmark::RunScenario(const FConfig& Config)
+{
+	using namespace HubLoopbackBenchmark;
+
+	FResult Result;
+
+	// not registered in game instance: no services, no ticker, no journal
+	UHubSocketSystem* System = NewObject<UHubSocketSystem>(GetTransientPackage());
+	System->AddToRoot();
+	System->InboundDispatcher = MakeShared<FHubOrderedDispatcher>();
+	System->OutboundDispatcher = MakeShared<FHubOrderedDispatcher>();
+	System->WireSerializer = &IHubWireSerializer::Get(Config.WireFormat);
+	System->OutboundQueue.SetMaxBytes(GetDefault<USocketSettings>()->OutboundQueueMaxBytes);
+
+	FHubLoopbackOptions Options;
+	Options.FragmentSize = Config.Fragment;
+	const TSharedRef<FHubLoopbackWebSocket> Loopback = MakeShared<FHubLoopbackWebSocket>(Options);
+	Loopback->OnRawMessage().AddUObject(System, &UHubSocketSystem::OnRawMessage);
+	Loopback->Connect();
+	Loopback->Pump();
+	System->Socket = Loopback;
+	System->ConnectionState = EBFSocketConnectionState::Authorized;
+
+	// sent in order and echoed in order, so n-th response answers n-th send
+	TArray<double> SendTimes;
+	TArray<double> Latencies;
+	SendTimes.SetNumUninitialized(Config.Messages);
+	Latencies.SetNumUninitialized(Config.Messages);
+
+	TArray<FHubServiceAction> Actions;
+	for (int32 Index = 0; Index < Config.Actions; ++Index)
+	{
+		FHubServiceAction& Action = Actions.AddDefaulted_GetRef();
+		Action.Fill(FString::Printf(TEXT("bench.loopback%d"), Index), EHubControllerType::AUTH);
+		System->Bind<FBFHubRequestData_ServerInit>(Action).AddLambda([&Result, &SendTimes, &Latencies](const FBFHubRequestData_ServerInit&)
+		{
+			if (Latencies.IsValidIndex(Result.Received))
+			{
+				Latencies[Result.Received] = FPlatformTime::Seconds() - SendTimes[Result.Received];
+			}
+			++Result.Received;
+		});
+	}
+
+	const FBFHubRequestData_ServerInit Sample{FString::ChrN(Config.Size, TEXT('x')), TEXT("password"), TEXT("1.0.12345"), TEXT("eu-west")};
+
+	TArray<double> FrameTimes;
+	const int32 MaxFrames = Config.Messages / Config.PerFrame + 1000;
+	FrameTimes.Reserve(MaxFrames);
+
+	FCountingMalloc& CountingMalloc = GetCountingMalloc();
+	FMalloc* PreviousMalloc = GMalloc;
+	if (Config.bCountAllocations)
+	{
+		GMalloc = &CountingMalloc;
+	}
+	const uint64 StartAllocations = CountingMalloc.Allocations;
+	const double StartTime = FPlatformTime::Seconds();
+
+	while (Result.Received + Result.Rejected < Config.Messages && FrameTimes.Num() < MaxFrames)
+	{
+		const double FrameStart = FPlatformTime::Seconds();
+
+		for (int32 Index = 0; Index < Config.PerFrame && Result.Sent + Result.Rejected < Config.Messages; ++Index)
+		{
+			const int32 Message = Result.Sent;
+			SendTimes[Message] = FPlatformTime::Seconds();
+			const EHubSendResult SendResult = System->Send(Actions[(Message + Result.Rejected) % Actions.Num()], Sample);
+			if (SendResult == EHubSendResult::Sent || SendResult == EHubSendResult::Queued)
+			{
+				++Result.Sent;
+			}
+			else
+			{
+				++Result.Rejected;
+			}
+		}
+
+		System->Tick(0.0f);
+		if (Result.Sent + Result.Rejected >= Config.Messages)
+		{
+			// nothing more comes to wait for batch window
+			System->FlushOutboundBatch();
+		}
+		Loopback->Pump();
+
+		FrameTimes.Add(FPlatformTime::Seconds() - FrameStart);
+	}
+
+	Result.ElapsedSeconds = FPlatformTime::Seconds() - StartTime;
+	const uint64 Allocations = CountingMalloc.Allocations - StartAllocations;
+	GMalloc = PreviousMalloc;
+
+	Result.Frames = FrameTimes.Num();
+	Result.FramesOnWire = Loopback->GetFramesSent();
+	Result.BytesOnWire = Loopback->GetBytesSent();
+	Result.MessagesPerSecond = Result.Received / FMath::Max(Result.ElapsedSeconds, UE_SMALL_NUMBER);
+	if (Config.bCountAllocations)
+	{
+		Result.AllocationsPerMessage = static_cast<double>(Allocations) / FMath::Max(Result.Received, 1);
+	}
+
+	Latencies.SetNum(FMath::Min(Result.Received, Config.Messages));
+	Latencies.Sort();
+	Result.LatencyP50Us = Percentile(Latencies, 0.5) * 1e6;
+	Result.LatencyP99Us = Percentile(Latencies, 0.99) * 1e6;
+	Result.LatencyP999Us = Percentile(Latencies, 0.999) * 1e6;
+	Result.LatencyMaxUs = Latencies.IsEmpty() ? 0.0 : Latencies.Last() * 1e6;
+
+	double FrameTotal = 0.0;
+	for (const double FrameTime : FrameTimes)
+	{
+		FrameTotal += FrameTime;
+	}
+	FrameTimes.Sort();
+	Result.FrameAvgMs = FrameTotal / FMath::Max(FrameTimes.Num(), 1) * 1e3;
+	Result.FrameP99Ms = Percentile(FrameTimes, 0.99) * 1e3;
+
+	for (const FHubServiceAction& Action : Actions)
+	{
+		System->Unbind(Action);
+	}
+	System->Socket.Reset();
+	Loopback->Close();
+	System->RemoveFromRoot();
+	System->MarkAsGarbage();
+
+	return Result;
+}
+
+FString FHubLoopbackBenchmark::ToJson(const FConfig& Config, const FResult& Result)
+{
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+
+	FString Json;
+	const TSharedRef<TJsonWriter<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>> Writer = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Json);
+	Writer->WriteObjectStart();
+	Writer->WriteValue(TEXT("benchmark"), TEXT("BFHub.Bench.Loopback"));
+	Writer->WriteValue(TEXT("timestamp"), FDateTime::UtcNow().ToIso8601());
+	Writer->WriteValue(TEXT("buildConfiguration"), LexToString(FApp::GetBuildConfiguration()));
+
+	Writer->WriteObjectStart(TEXT("config"));
+	Writer->WriteValue(TEXT("messages"), Config.Messages);
+	Writer->WriteValue(TEXT("perFrame"), Config.PerFrame);
+	Writer->WriteValue(TEXT("size"), Config.Size);
+	Writer->WriteValue(TEXT("actions"), Config.Actions);
+	Writer->WriteValue(TEXT("fragment"), Config.Fragment);
+	Writer->WriteValue(TEXT("wireFormat"), Config.WireFormat == EHubWireFormat::MessagePack ? TEXT("MessagePack") : TEXT("Json"));
+	Writer->WriteValue(TEXT("batching"), Settings->bBatchingEnabled);
+	Writer->WriteValue(TEXT("maxBatchMessages"), Settings->MaxBatchMessages);
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectStart(TEXT("results"));
+	Writer->WriteValue(TEXT("sent"), Result.Sent);
+	Writer->WriteValue(TEXT("received"), Result.Received);
+	Writer->WriteValue(TEXT("rejected"), Result.Rejected);
+	Writer->WriteValue(TEXT("elapsedSeconds"), Result.ElapsedSeconds);
+	Writer->WriteValue(TEXT("messagesPerSecond"), Result.MessagesPerSecond);
+	Writer->WriteValue(TEXT("latencyP50Us"), Result.LatencyP50Us);
+	Writer->WriteValue(TEXT("latencyP99Us"), Result.LatencyP99Us);
+	Writer->WriteValue(TEXT("latencyP999Us"), Result.LatencyP999Us);
+	Writer->WriteValue(TEXT("latencyMaxUs"), Result.LatencyMaxUs);
+	Writer->WriteValue(TEXT("allocationsPerMessage"), Result.AllocationsPerMessage);
+	Writer->WriteValue(TEXT("gameFrames"), Result.Frames);
+	Writer->WriteValue(TEXT("gameFrameAvgMs"), Result.FrameAvgMs);
+	Writer->WriteValue(TEXT("gameFrameP99Ms"), Result.FrameP99Ms);
+	Writer->WriteValue(TEXT("wireFrames"), static_cast<int64>(Result.FramesOnWire));
+	Writer->WriteValue(TEXT("wireBytes"), static_cast<int64>(Result.BytesOnWire));
+	Writer->WriteObjectEnd();
+
+	Writer->WriteObjectEnd();
+	Writer->Close();
+	return Json;
+}
+
+void FHubLoopbackBenchmark::Run(const TArray<FString>& Args)
+{
+	const FConfig Config = ParseConfig(Args);
+	const FResult Result = RunScenario(Config);
+	const FString Json = ToJson(Config, Result);
+
+	UE_LOGFMT(BFHubSocketSystem, Display, "Loopback benchmark ({0} messages, {1} per frame, {2} bytes, {3} actions): {4} msg/s, latency p50 {5} us, p99 {6} us, p999 {7} us, {8} allocations/msg, frame avg {9} ms, p99 {10} ms",
+		Config.Messages, Config.PerFrame, Config.Size, Config.Actions, Result.MessagesPerSecond,
+		Result.LatencyP50Us, Result.LatencyP99Us, Result.LatencyP999Us, Result.AllocationsPerMessage, Result.FrameAvgMs, Result.FrameP99Ms);
+	UE_LOGFMT(BFHubSocketSystem, Display, "Loopback benchmark result: {0}", Json);
+
+	if (Result.Received != Result.Sent)
+	{
+		UE_LOGFMT(BFHubSocketSystem, Warning, "Loopback benchmark lost messages: sent {0}, received {1}", Result.Sent, Result.Received);
+	}
+
+	FString OutputPath;
+	for (const FString& Arg : Args)
+	{
+		FParse::Value(*Arg, TEXT("Output="), OutputPath);
+	}
+	if (OutputPath.IsEmpty())
+	{
+		OutputPath = FPaths::ProjectSavedDir() / TEXT("HubSockets/Benchmarks") / FString::Printf(TEXT("Loopback-%s.json"), *FDateTime::Now().ToString());
+	}
+
+	if (FFileHelper::SaveStringToFile(Json, *OutputPath, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM))
+	{
+		UE_LOGFMT(BFHubSocketSystem, Display, "Loopback benchmark result saved to {0}", OutputPath);
+	}
+	else
+	{
+		UE_LOGFMT(BFHubSocketSystem, Warning, "Failed to save loopback benchmark result to {0}", OutputPath);
+	}
+}
+
+namespace HubLoopbackBenchmark
+{
+	static FAutoConsoleCommand LoopbackBenchmarkCommand(
+		TEXT("BFHub.Bench.Loopback"),
+		TEXT("Send, receive and dispatch messages through the socket system and loopback hub, result saved as json. ")
+		TEXT("Args: Messages=N PerFrame=N Size=Bytes Actions=N Fragment=Bytes Format=Json|MessagePack Allocs=true|false Output=Path"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&FHubLoopbackBenchmark::Run));
+}
+
+#endif
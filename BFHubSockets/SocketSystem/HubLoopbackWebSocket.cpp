@@ -0,0 +1,314 @@
+#include "HubLoopbackWebSocket.h"
+
+#include "HubBufferPool.h"
+
+FHubLoopbackOptions FHubLoopbackOptions::FromUrl(const FString& Url)
+{
+	FHubLoopbackOptions Options;
+	// nobody else pumps socket created from url
+	Options.bAutoPump = true;
+
+	FString Address;
+	FString Query;
+	if (Url.Split(TEXT("?"), &Address, &Query) == false)
+	{
+		return Options;
+	}
+
+	TArray<FString> Params;
+	Query.ParseIntoArray(Params, TEXT("&"));
+	for (const FString& Param : Params)
+	{
+		FString Name;
+		FString Value;
+		if (Param.Split(TEXT("="), &Name, &Value) == false)
+		{
+			Name = Param;
+			Value = TEXT("1");
+		}
+
+		if (Name == TEXT("latencyMs"))
+		{
+			Options.LatencySeconds = FCString::Atod(*Value) / 1000.0;
+		}
+		else if (Name == TEXT("jitterMs"))
+		{
+			Options.JitterSeconds = FCString::Atod(*Value) / 1000.0;
+		}
+		else if (Name == TEXT("drop"))
+		{
+			Options.DropChance = FCString::Atof(*Value);
+		}
+		else if (Name == TEXT("fragment"))
+		{
+			Options.FragmentSize = FCString::Atoi(*Value);
+		}
+		else if (Name == TEXT("closeAfter"))
+		{
+			Options.CloseAfterFrames = FCString::Atoi(*Value);
+		}
+		else if (Name == TEXT("closeCode"))
+		{
+			Options.CloseCode = FCString::Atoi(*Value);
+		}
+		else if (Name == TEXT("failConnect"))
+		{
+			Options.bFailConnect = FCString::ToBool(*Value);
+		}
+		else if (Name == TEXT("seed"))
+		{
+			Options.Seed = FCString::Atoi(*Value);
+		}
+	}
+	return Options;
+}
+
+FHubLoopbackWebSocket::FHubLoopbackWebSocket(const FHubLoopbackOptions& InOptions)
+	: Options(InOptions)
+	, Random(InOptions.Seed)
+	, Clock(FPlatformTime::Seconds())
+{
+	LastEventTime = Clock;
+
+	if (Options.bAutoPump)
+	{
+		TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateLambda([this](float)
+		{
+			Pump();
+			return true;
+		}));
+	}
+}
+
+FHubLoopbackWebSocket::~FHubLoopbackWebSocket()
+{
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+	ClearEvents();
+}
+
+void FHubLoopbackWebSocket::Connect()
+{
+	if (bConnected || bConnecting)
+	{
+		return;
+	}
+
+	++Connection;
+	bConnecting = true;
+	HubFrames = 0;
+	ClearEvents();
+
+	if (Options.bFailConnect)
+	{
+		AddEvent(EEventType::ConnectionError).Reason = TEXT("Loopback connection refused");
+	}
+	else
+	{
+		AddEvent(EEventType::Connected);
+	}
+}
+
+void FHubLoopbackWebSocket::Close(const int32 Code, const FString& Reason)
+{
+	if (bConnected == false && bConnecting == false)
+	{
+		return;
+	}
+
+	// nothing is sent or received after close, closed event still comes asynchronously as from network socket
+	++Connection;
+	bConnected = false;
+	bConnecting = false;
+	ClearEvents();
+
+	FEvent& Event = AddEvent(EEventType::Closed);
+	Event.Code = Code;
+	Event.Reason = Reason;
+}
+
+void FHubLoopbackWebSocket::Send(const FString& Data)
+{
+	const FTCHARToUTF8 Utf8(*Data, Data.Len());
+	Send(Utf8.Get(), Utf8.Length(), false);
+}
+
+void FHubLoopbackWebSocket::Send(const void* Data, const SIZE_T Size, const bool bIsBinary)
+{
+	if (bConnected == false)
+	{
+		return;
+	}
+
+	++FramesSent;
+	BytesSent += Size;
+
+	if (Options.DropChance > 0.0f && Random.FRand() < Options.DropChance)
+	{
+		++FramesDropped;
+		return;
+	}
+
+	const TConstArrayView<uint8> Frame(static_cast<const uint8*>(Data), Size);
+	if (Responder)
+	{
+		Responder(*this, Frame, bIsBinary);
+	}
+	else
+	{
+		Deliver(Frame);
+	}
+
+	++HubFrames;
+	if (Options.CloseAfterFrames > 0 && HubFrames == Options.CloseAfterFrames)
+	{
+		SimulateClose(Options.CloseCode, FString::Printf(TEXT("Loopback closed after %d frames"), HubFrames));
+	}
+}
+
+void FHubLoopbackWebSocket::Deliver(const TConstArrayView<uint8> Frame)
+{
+	if (bConnected == false)
+	{
+		return;
+	}
+
+	// real socket copies frame into own buffer too
+	FEvent& Event = AddEvent(EEventType::Frame);
+	Event.Frame = FHubBufferPool::Get().Acquire();
+	Event.Frame.Append(Frame.GetData(), Frame.Num());
+}
+
+void FHubLoopbackWebSocket::SimulateClose(const int32 Code, const FString& Reason)
+{
+	if (bConnected == false && bConnecting == false)
+	{
+		return;
+	}
+
+	FEvent& Event = AddEvent(EEventType::Closed);
+	Event.Code = Code;
+	Event.Reason = Reason;
+}
+
+void FHubLoopbackWebSocket::SimulateConnectionError(const FString& Error)
+{
+	if (bConnected == false && bConnecting == false)
+	{
+		return;
+	}
+
+	AddEvent(EEventType::ConnectionError).Reason = Error;
+}
+
+FHubLoopbackWebSocket::FEvent& FHubLoopbackWebSocket::AddEvent(const EEventType Type)
+{
+	double Time = Clock + Options.LatencySeconds;
+	if (Options.JitterSeconds > 0.0)
+	{
+		Time += Random.FRand() * Options.JitterSeconds;
+	}
+	LastEventTime = FMath::Max(LastEventTime, Time);
+
+	FEvent& Event = Events.AddDefaulted_GetRef();
+	Event.Time = LastEventTime;
+	Event.Type = Type;
+	Event.Connection = Connection;
+	return Event;
+}
+
+int32 FHubLoopbackWebSocket::Pump(const double Now)
+{
+	Clock = Now;
+
+	int32 NumDue = 0;
+	while (NumDue < Events.Num() && Events[NumDue].Time <= Now)
+	{
+		++NumDue;
+	}
+	if (NumDue == 0)
+	{
+		return 0;
+	}
+
+	// handlers send and close from inside the broadcasts, so due events are taken out first
+	TArray<FEvent> DueEvents;
+	DueEvents.Reserve(NumDue);
+	for (int32 Index = 0; Index < NumDue; ++Index)
+	{
+		DueEvents.Add(MoveTemp(Events[Index]));
+	}
+	Events.RemoveAt(0, NumDue);
+
+	for (const FEvent& Event : DueEvents)
+	{
+		if (Event.Connection != Connection)
+		{
+			continue;
+		}
+
+		switch (Event.Type)
+		{
+		case EEventType::Connected:
+			bConnecting = false;
+			bConnected = true;
+			ConnectedEvent.Broadcast();
+			break;
+
+		case EEventType::Frame:
+			++FramesDelivered;
+			DeliverFrame(Event.Frame);
+			break;
+
+		case EEventType::Closed:
+		case EEventType::ConnectionError:
+			++Connection;
+			bConnected = false;
+			bConnecting = false;
+			ClearEvents();
+			if (Event.Type == EEventType::Closed)
+			{
+				ClosedEvent.Broadcast(Event.Code, Event.Reason, Event.Code == 1000);
+			}
+			else
+			{
+				ConnectionErrorEvent.Broadcast(Event.Reason);
+			}
+			break;
+		}
+	}
+
+	ReleaseFrames(DueEvents);
+	return NumDue;
+}
+
+void FHubLoopbackWebSocket::DeliverFrame(const TArray<uint8>& Frame)
+{
+	const uint32 FrameConnection = Connection;
+	const int32 Fragment = Options.FragmentSize > 0 ? Options.FragmentSize : Frame.Num();
+	int32 Offset = 0;
+	do
+	{
+		const int32 Size = FMath::Min(Fragment, Frame.Num() - Offset);
+		RawMessageEvent.Broadcast(Frame.GetData() + Offset, Size, Frame.Num() - Offset - Size);
+		Offset += Size;
+	}
+	// handler of the message may close the socket, tail of the frame is lost then
+	while (Offset < Frame.Num() && FrameConnection == Connection);
+}
+
+void FHubLoopbackWebSocket::ClearEvents()
+{
+	ReleaseFrames(Events);
+	Events.Reset();
+}
+
+void FHubLoopbackWebSocket::ReleaseFrames(TArray<FEvent>& InEvents)
+{
+	for (FEvent& Event : InEvents)
+	{
+		if (Event.Type == EEventType::Frame)
+		{
+			FHubBufferPool::Get().Release(MoveTemp(Event.Frame));
+		}
+	}
+}
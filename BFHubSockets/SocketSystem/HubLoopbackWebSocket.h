@@ -0,0 +1,138 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "IWebSocket.h"
+#include "Containers/Ticker.h"
+
+/**
+ * Network conditions of loopback socket, all randomness comes from Seed so a run can be repeated exactly
+ * Can be given in url: loopback://hub?latencyMs=50&jitterMs=10&drop=0.01&fragment=512&closeAfter=100&closeCode=1006&failConnect=1&seed=7
+ */
+struct BFHUBSOCKETS_API FHubLoopbackOptions
+{
+	// Delay of connect and of every frame from hub
+	double LatencySeconds = 0.0;
+	// Extra random delay up to this value, frames still arrive in order as in websocket
+	double JitterSeconds = 0.0;
+	// Chance that sent frame is lost before it reaches hub
+	float DropChance = 0.0f;
+	// Frames from hub are split into fragments of this size to exercise reassembly, 0 - whole frame
+	int32 FragmentSize = 0;
+	// Hub closes connection with CloseCode after this many received frames, 0 - never
+	int32 CloseAfterFrames = 0;
+	int32 CloseCode = 1006;
+	// Connect ends with connection error
+	bool bFailConnect = false;
+	int32 Seed = 0;
+	// Pumped from core ticker, otherwise owner calls Pump
+	bool bAutoPump = false;
+
+	static FHubLoopbackOptions FromUrl(const FString& Url);
+};
+
+/**
+ * In-process socket which plays the hub, events reach the socket system on Pump after simulated latency
+ * By default hub echoes every frame: outbound requests have no "type", so echo is decoded as response of the same action
+ * Responder replaces echo with scripted hub, it may Deliver any frames or SimulateClose
+ */
+class BFHUBSOCKETS_API FHubLoopbackWebSocket : public IWebSocket
+{
+public:
+	using FResponder = TFunction<void(FHubLoopbackWebSocket& Socket, TConstArrayView<uint8> Frame, bool bIsBinary)>;
+
+	static constexpr const TCHAR* UrlScheme = TEXT("loopback://");
+
+	explicit FHubLoopbackWebSocket(const FHubLoopbackOptions& InOptions = FHubLoopbackOptions());
+	virtual ~FHubLoopbackWebSocket() override;
+
+	// Empty responder restores echo
+	void SetResponder(FResponder InResponder) { Responder = MoveTemp(InResponder); }
+
+	// Hub side: frame reaches the socket after latency
+	void Deliver(TConstArrayView<uint8> Frame);
+	// Hub side: connection is closed after already queued frames
+	void SimulateClose(int32 Code, const FString& Reason);
+	void SimulateConnectionError(const FString& Error);
+
+	/** Delivers events due at Now, events queued by handlers during the pump wait for next one; returns number of events
+	 * Now is the clock of the socket, tests may pass virtual time */
+	int32 Pump(double Now = FPlatformTime::Seconds());
+
+	int32 GetPendingEvents() const { return Events.Num(); }
+	uint64 GetFramesSent() const { return FramesSent; }
+	uint64 GetBytesSent() const { return BytesSent; }
+	uint64 GetFramesDropped() const { return FramesDropped; }
+	uint64 GetFramesDelivered() const { return FramesDelivered; }
+
+	// IWebSocket
+	virtual void Connect() override;
+	virtual void Close(int32 Code = 1000, const FString& Reason = FString()) override;
+	virtual bool IsConnected() override { return bConnected; }
+	virtual void Send(const FString& Data) override;
+	virtual void Send(const void* Data, SIZE_T Size, bool bIsBinary = false) override;
+	virtual void SetTextMessageMemoryLimit(uint64 TextMessageMemoryLimit) override {}
+
+	virtual FWebSocketConnectedEvent& OnConnected() override { return ConnectedEvent; }
+	virtual FWebSocketConnectionErrorEvent& OnConnectionError() override { return ConnectionErrorEvent; }
+	virtual FWebSocketClosedEvent& OnClosed() override { return ClosedEvent; }
+	virtual FWebSocketMessageEvent& OnMessage() override { return MessageEvent; }
+	virtual FWebSocketBinaryMessageEvent& OnBinaryMessage() override { return BinaryMessageEvent; }
+	virtual FWebSocketRawMessageEvent& OnRawMessage() override { return RawMessageEvent; }
+	virtual FWebSocketMessageSentEvent& OnMessageSent() override { return MessageSentEvent; }
+
+private:
+	enum class EEventType : uint8
+	{
+		Connected,
+		Frame,
+		Closed,
+		ConnectionError,
+	};
+
+	struct FEvent
+	{
+		double Time = 0.0;
+		EEventType Type = EEventType::Frame;
+		// pooled buffer of frame
+		TArray<uint8> Frame;
+		int32 Code = 0;
+		FString Reason;
+		// events of previous connection are skipped
+		uint32 Connection = 0;
+	};
+
+	// Keeps events in order: jitter never lets a frame overtake previous one
+	FEvent& AddEvent(EEventType Type);
+	void DeliverFrame(const TArray<uint8>& Frame);
+	void ClearEvents();
+	static void ReleaseFrames(TArray<FEvent>& InEvents);
+
+	FHubLoopbackOptions Options;
+	FRandomStream Random;
+	FResponder Responder;
+
+	TArray<FEvent> Events;
+	// time of the last pump, events are scheduled from it
+	double Clock = 0.0;
+	double LastEventTime = 0.0;
+
+	FTSTicker::FDelegateHandle TickerHandle;
+
+	FWebSocketConnectedEvent ConnectedEvent;
+	FWebSocketConnectionErrorEvent ConnectionErrorEvent;
+	FWebSocketClosedEvent ClosedEvent;
+	FWebSocketMessageEvent MessageEvent;
+	FWebSocketBinaryMessageEvent BinaryMessageEvent;
+	FWebSocketRawMessageEvent RawMessageEvent;
+	FWebSocketMessageSentEvent MessageSentEvent;
+
+	bool bConnected = false;
+	bool bConnecting = false;
+	uint32 Connection = 0;
+	// frames which reached hub in current connection, for CloseAfterFrames
+	int32 HubFrames = 0;
+	uint64 FramesSent = 0;
+	uint64 BytesSent = 0;
+	uint64 FramesDropped = 0;
+	uint64 FramesDelivered = 0;
+};
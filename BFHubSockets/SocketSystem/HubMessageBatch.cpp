@@ -0,0 +1,23 @@
+﻿#include "HubMessageBatch.h"
+
+void FHubOutboundBatch::Add(const FHubServiceAction& Key, TArray<uint8>&& Message, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	if (Messages.IsEmpty())
+	{
+		FirstMessageTime = FPlatformTime::Seconds();
+	}
+
+	Keys.Add(Key);
+	Messages.Add(MoveTemp(Message));
+	CoalescingKeys.Add(CoalescingKey);
+	RequestIds.Add(RequestId);
+}
+
+void FHubOutboundBatch::Reset()
+{
+	Keys.Reset();
+	Messages.Reset();
+	CoalescingKeys.Reset();
+	RequestIds.Reset();
+	FirstMessageTime = 0.0;
+}
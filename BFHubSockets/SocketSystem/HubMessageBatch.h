@@ -0,0 +1,32 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubActionPolicy.h"
+#include "HubServicesBaseData.h"
+#include "HubTimerWheel.h"
+
+/**
+ * Outbound messages collected during tick (or batching window) to be sent as one array frame "[{...},{...}]"
+ * Messages are already encoded in wire format of the connection, see IHubWireSerializer::MakeBatchFrame
+ */
+struct FHubOutboundBatch
+{
+	void Add(const FHubServiceAction& Key, TArray<uint8>&& Message, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId = 0);
+	void Reset();
+
+	bool IsEmpty() const { return Messages.IsEmpty(); }
+	int32 Num() const { return Messages.Num(); }
+	double GetFirstMessageTime() const { return FirstMessageTime; }
+
+	TArray<FHubServiceAction> Keys;
+	TArray<TArray<uint8>> Messages;
+	// kept for the case when batch is queued because connection is lost
+	TArray<TOptional<FHubCoalescingKey>> CoalescingKeys;
+	TArray<int64> RequestIds;
+
+	// flush at the end of batching window, scheduled when first message is added
+	FHubTimerHandle FlushTimer;
+
+private:
+	double FirstMessageTime = 0.0;
+};
@@ -0,0 +1,25 @@
+﻿#include "HubMessageEncoder.h"
+
+#include "HubJsonScanner.h"
+
+void FHubMessageEncoder::WriteStringEncodedJson(const FHubServiceAction& Key, const TConstArrayView<uint8> DataJson, const FHubEncodeOptions& Options, TArray<uint8>& OutMessage)
+{
+	// same fields in the same order as WriteJsonWithCodec writes them
+	TAnsiStringBuilder<64> Text;
+	Text.Appendf("{\"controller\":%d,\"method\":", static_cast<int32>(Key.Controller));
+	OutMessage.Append(reinterpret_cast<const uint8*>(Text.GetData()), Text.Len());
+
+	const FTCHARToUTF8 Method(*Key.Method, Key.Method.Len());
+	HubJson::AppendQuoted(FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Method.Get()), Method.Length()), OutMessage);
+
+	Text.Reset();
+	if (Options.RequestId != 0)
+	{
+		Text.Appendf(",\"requestId\":%lld", Options.RequestId);
+	}
+	Text.Append(",\"data\":");
+	OutMessage.Append(reinterpret_cast<const uint8*>(Text.GetData()), Text.Len());
+
+	HubJson::AppendQuoted(FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(DataJson.GetData()), DataJson.Num()), OutMessage);
+	OutMessage.Add('}');
+}
@@ -0,0 +1,226 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "JsonObjectConverter.h"
+#include "Serialization/MemoryWriter.h"
+#include "HubBufferPool.h"
+#include "HubServicesBaseData.h"
+#include "HubStructCodec.h"
+#include "SocketSettings.h"
+
+struct FHubEncodeOptions
+{
+	EHubWireFormat WireFormat = EHubWireFormat::Json;
+	EHubPayloadEncoding PayloadEncoding = EHubPayloadEncoding::StringEncoded;
+
+	// Written as "requestId" when set, hub echoes it in response or error
+	int64 RequestId = 0;
+};
+
+/**
+ * Builds outbound hub message from service action and request data
+ */
+struct FHubMessageEncoder
+{
+	/** Message in wire format of the connection, json written straight as utf-8 without FString in between,
+	 * string encoded data goes through pooled utf-8 scratch buffer
+	 * OutMessage is reset keeping its capacity, so pooled buffer is reused (see FHubBufferPool) */
+	template <typename T>
+	static bool Encode(const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options, TArray<uint8>& OutMessage);
+
+	// Text form of json message, for logs and tools
+	template <typename T>
+	static bool EncodeJson(const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options, FString& OutMessage);
+
+	// "data" is always nested map, there is no escaping to save on
+	template <typename T>
+	static bool EncodeMessagePack(const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options, TArray<uint8>& OutMessage);
+
+private:
+	template <typename CharType>
+	using TJsonWriterRef = TSharedRef<TJsonWriter<CharType, TCondensedJsonPrintPolicy<CharType>>>;
+
+	// Same message for utf-8 and TCHAR writers
+	template <typename T, typename CharType>
+	static bool WriteJson(const TJsonWriterRef<CharType>& JsonWriter, const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options);
+
+	template <typename T, typename CharType>
+	static bool WriteJsonWithCodec(const TJsonWriterRef<CharType>& JsonWriter, const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options);
+
+	// Data struct as utf-8 json object
+	template <typename T>
+	static bool WriteDataJson(const T& Data, TArray<uint8>& OutJson);
+
+	// Envelope is written by hand, TJsonWriter takes string values only as TCHAR
+	static void WriteStringEncodedJson(const FHubServiceAction& Key, TConstArrayView<uint8> DataJson, const FHubEncodeOptions& Options, TArray<uint8>& OutMessage);
+
+	static FHubRequestMessageHeader MakeHeader(const FHubServiceAction& Key)
+	{
+		FHubRequestMessageHeader Message;
+		//we can't send controller as enum name like "EVENT" because hub expect int value
+		Message.Controller = static_cast<int32>(Key.Controller);
+		Message.Method = Key.Method;
+		return Message;
+	}
+};
+
+template <typename T>
+bool FHubMessageEncoder::Encode(const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options, TArray<uint8>& OutMessage)
+{
+	if (Options.WireFormat == EHubWireFormat::MessagePack)
+	{
+		return EncodeMessagePack(Key, Data, Options, OutMessage);
+	}
+
+	OutMessage.Reset();
+
+	// data is written once as utf-8 and copied escaped into the message
+	if (Options.PayloadEncoding == EHubPayloadEncoding::StringEncoded)
+	{
+		TArray<uint8> DataJson = FHubBufferPool::Get().Acquire();
+		const bool bWritten = WriteDataJson(Data, DataJson);
+		if (bWritten)
+		{
+			WriteStringEncodedJson(Key, DataJson, Options, OutMessage);
+		}
+		FHubBufferPool::Get().Release(MoveTemp(DataJson));
+		return bWritten;
+	}
+
+	// utf-8 writer appends encoded characters to the buffer directly
+	FMemoryWriter Archive(OutMessage);
+	return WriteJson<T, UTF8CHAR>(TJsonWriterFactory<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>::Create(&Archive), Key, Data, Options);
+}
+
+template <typename T>
+bool FHubMessageEncoder::EncodeJson(const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options, FString& OutMessage)
+{
+	return WriteJson<T, TCHAR>(TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&OutMessage), Key, Data, Options);
+}
+
+template <typename T>
+bool FHubMessageEncoder::WriteDataJson(const T& Data, TArray<uint8>& OutJson)
+{
+	FMemoryWriter Archive(OutJson);
+	const TJsonWriterRef<UTF8CHAR> JsonWriter = TJsonWriterFactory<UTF8CHAR, TCondensedJsonPrintPolicy<UTF8CHAR>>::Create(&Archive);
+
+	if constexpr (THubStructCodec<T>::bEnabled)
+	{
+		HubStructCodec::WriteWithCodec(*JsonWriter, Data);
+		return JsonWriter->Close();
+	}
+	else
+	{
+		// reflection needs json object of the struct, but not of the envelope
+		const TSharedPtr<FJsonObject> DataObject = FJsonObjectConverter::UStructToJsonObject(Data);
+		return DataObject.IsValid() && FJsonSerializer::Serialize(DataObject.ToSharedRef(), JsonWriter);
+	}
+}
+
+template <typename T, typename CharType>
+bool FHubMessageEncoder::WriteJson(const TJsonWriterRef<CharType>& JsonWriter, const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options)
+{
+	// string encoded data reaches here only from EncodeJson, text form for logs and tools
+	if constexpr (THubStructCodec<T>::bEnabled)
+	{
+		return WriteJsonWithCodec<T, CharType>(JsonWriter, Key, Data, Options);
+	}
+	else
+	{
+		FHubRequestMessageHeader Message = MakeHeader(Key);
+
+		TSharedPtr<FJsonObject> DataObject;
+		if (Options.PayloadEncoding == EHubPayloadEncoding::NestedObject)
+		{
+			DataObject = FJsonObjectConverter::UStructToJsonObject(Data);
+			if (DataObject.IsValid() == false)
+			{
+				return false;
+			}
+		}
+		else if (FJsonObjectConverter::UStructToJsonObjectString(Data, Message.Data, 0, 0, 0, nullptr, false) == false)
+		{
+			return false;
+		}
+
+		const TSharedPtr<FJsonObject> EnvelopeObject = FJsonObjectConverter::UStructToJsonObject(Message);
+		if (EnvelopeObject.IsValid() == false)
+		{
+			return false;
+		}
+
+		// header and data serialized together into single output
+		if (DataObject.IsValid())
+		{
+			EnvelopeObject->SetObjectField(TEXT("data"), DataObject);
+		}
+		// header struct has no request id, field added to its json object
+		if (Options.RequestId != 0)
+		{
+			EnvelopeObject->SetNumberField(TEXT("requestId"), Options.RequestId);
+		}
+
+		return FJsonSerializer::Serialize(EnvelopeObject.ToSharedRef(), JsonWriter);
+	}
+}
+
+template <typename T>
+bool FHubMessageEncoder::EncodeMessagePack(const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options, TArray<uint8>& OutMessage)
+{
+	OutMessage.Reset();
+	FHubMessagePackWriter Writer(OutMessage);
+	Writer.WriteObjectStart();
+	Writer.WriteValue(TEXT("controller"), static_cast<int32>(Key.Controller));
+	Writer.WriteValue(TEXT("method"), Key.Method);
+	if (Options.RequestId != 0)
+	{
+		Writer.WriteValue(TEXT("requestId"), Options.RequestId);
+	}
+
+	if constexpr (THubStructCodec<T>::bEnabled)
+	{
+		HubStructCodec::WriteWithCodec(Writer, Data, TEXT("data"));
+	}
+	else
+	{
+		const TSharedPtr<FJsonObject> DataObject = FJsonObjectConverter::UStructToJsonObject(Data);
+		if (DataObject.IsValid() == false)
+		{
+			return false;
+		}
+		Writer.WriteJsonObject(TEXT("data"), DataObject.ToSharedRef());
+	}
+
+	Writer.WriteObjectEnd();
+	return Writer.Close();
+}
+
+template <typename T, typename CharType>
+bool FHubMessageEncoder::WriteJsonWithCodec(const TJsonWriterRef<CharType>& JsonWriter, const FHubServiceAction& Key, const T& Data, const FHubEncodeOptions& Options)
+{
+	// header fields written by hand, same names as FHubRequestMessageHeader produces through reflection
+	JsonWriter->WriteObjectStart();
+	JsonWriter->WriteValue(TEXT("controller"), static_cast<int32>(Key.Controller));
+	JsonWriter->WriteValue(TEXT("method"), Key.Method);
+	if (Options.RequestId != 0)
+	{
+		JsonWriter->WriteValue(TEXT("requestId"), Options.RequestId);
+	}
+
+	if (Options.PayloadEncoding == EHubPayloadEncoding::NestedObject)
+	{
+		HubStructCodec::WriteWithCodec(*JsonWriter, Data, TEXT("data"));
+	}
+	else
+	{
+		FString DataString;
+		if (HubStructCodec::WriteWithCodec(Data, DataString) == false)
+		{
+			return false;
+		}
+		JsonWriter->WriteValue(TEXT("data"), DataString);
+	}
+
+	JsonWriter->WriteObjectEnd();
+	return JsonWriter->Close();
+}
@@ -0,0 +1,428 @@
+﻿#include "HubMessageEnvelope.h"
+
+#include "HubDecodeArena.h"
+#include "HubJsonScanner.h"
+
+namespace HubMessageEnvelope
+{
+	// Value names are collected once, names in frames are compared in place without FString per message
+	template <typename TEnum>
+	const TArray<TPair<FString, int64>>& GetEnumNames()
+	{
+		static const TArray<TPair<FString, int64>> Names = []()
+		{
+			TArray<TPair<FString, int64>> Result;
+			const UEnum* Enum = StaticEnum<TEnum>();
+			for (int32 Index = 0; Index < Enum->NumEnums(); ++Index)
+			{
+				Result.Emplace(Enum->GetNameStringByIndex(Index), Enum->GetValueByIndex(Index));
+			}
+			return Result;
+		}();
+		return Names;
+	}
+
+	template <typename CharType, typename TEnum>
+	bool TryFindEnumValue(const TStringView<CharType> Name, TEnum& OutValue)
+	{
+		for (const TPair<FString, int64>& Entry : GetEnumNames<TEnum>())
+		{
+			if (HubJson::IsKey(Name, *Entry.Key))
+			{
+				OutValue = static_cast<TEnum>(Entry.Value);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	template <typename CharType, typename TEnum>
+	bool TryReadEnum(THubJsonScanner<CharType>& Scanner, TEnum& OutValue)
+	{
+		if (Scanner.Peek() == '"')
+		{
+			TStringView<CharType> Name;
+			bool bHasEscapes = false;
+			return Scanner.ReadString(Name, bHasEscapes) && TryFindEnumValue(Name, OutValue);
+		}
+
+		int64 Value = 0;
+		if (Scanner.ReadInteger(Value) == false)
+		{
+			return false;
+		}
+
+		OutValue = static_cast<TEnum>(Value);
+		return true;
+	}
+
+	template <typename TEnum>
+	bool TryReadEnum(FHubMessagePackReader& Reader, TEnum& OutValue)
+	{
+		if (Reader.IsNextString())
+		{
+			TConstArrayView<uint8> Name;
+			return Reader.ReadRawString(Name) && TryFindEnumValue(FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Name.GetData()), Name.Num()), OutValue);
+		}
+
+		int64 Value = 0;
+		if (Reader.ReadInteger(Value) == false)
+		{
+			return false;
+		}
+
+		OutValue = static_cast<TEnum>(Value);
+		return true;
+	}
+
+	bool IsKey(const TConstArrayView<uint8> Utf8, const FAnsiStringView Name)
+	{
+		return FAnsiStringView(reinterpret_cast<const ANSICHAR*>(Utf8.GetData()), Utf8.Num()).Equals(Name, ESearchCase::IgnoreCase);
+	}
+}
+
+FString FHubMessagePayload::ToString() const
+{
+	if (Utf8Json.IsEmpty() == false)
+	{
+		return HubJson::ToString(Utf8Json);
+	}
+	if (MessagePack.IsEmpty())
+	{
+		return FString(Json);
+	}
+
+	TSharedPtr<FJsonValue> Value;
+	FHubMessagePackReader Reader(MessagePack);
+	if (Reader.ReadJsonValue(Value) == false)
+	{
+		return FString::Printf(TEXT("<%d bytes of broken MessagePack>"), MessagePack.Num());
+	}
+
+	FString Text;
+	const auto JsonWriter = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&Text);
+	FJsonSerializer::Serialize(Value, FString(), JsonWriter);
+	return Text;
+}
+
+template <typename CharType>
+bool FHubMessageEnvelope::TryDecodeText(const TStringView<CharType> Message, FHubDecodeArena& Arena, FHubMessageEnvelope& OutEnvelope)
+{
+	using namespace HubMessageEnvelope;
+	using FView = TStringView<CharType>;
+
+	// utf-8 frame keeps payload in utf-8, only method is converted
+	constexpr bool bUtf8 = std::is_same_v<CharType, UTF8CHAR>;
+
+	THubJsonScanner<CharType> Scanner(Message);
+	if (Scanner.TryConsume('{') == false)
+	{
+		return false;
+	}
+
+	if (Scanner.TryConsume('}'))
+	{
+		return true;
+	}
+
+	do
+	{
+		FView Key;
+		bool bKeyHasEscapes = false;
+		if (Scanner.ReadString(Key, bKeyHasEscapes) == false || Scanner.TryConsume(':') == false)
+		{
+			return false;
+		}
+
+		// keys compared the same way as FJsonObjectConverter does - case insensitive
+		if (HubJson::IsKey(Key, TEXT("type")))
+		{
+			if (TryReadEnum(Scanner, OutEnvelope.Type) == false)
+			{
+				return false;
+			}
+		}
+		else if (HubJson::IsKey(Key, TEXT("controller")))
+		{
+			if (TryReadEnum(Scanner, OutEnvelope.Controller) == false)
+			{
+				return false;
+			}
+		}
+		else if (HubJson::IsKey(Key, TEXT("method")))
+		{
+			FView Method;
+			bool bHasEscapes = false;
+			if (Scanner.ReadString(Method, bHasEscapes) == false)
+			{
+				return false;
+			}
+
+			if (bHasEscapes && HubJson::Unescape(Method, Arena, Method) == false)
+			{
+				return false;
+			}
+
+			if constexpr (bUtf8)
+			{
+				const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Method.GetData()), Method.Len());
+				OutEnvelope.MethodStorage.Reset();
+				OutEnvelope.MethodStorage.Append(Converted.Get(), Converted.Length());
+				OutEnvelope.Method = OutEnvelope.MethodStorage.ToView();
+			}
+			else
+			{
+				OutEnvelope.Method = Method;
+			}
+		}
+		else if (HubJson::IsKey(Key, TEXT("requestId")))
+		{
+			if (Scanner.Peek() == 'n')
+			{
+				FView Null;
+				if (Scanner.SkipValue(Null) == false)
+				{
+					return false;
+				}
+			}
+			else if (Scanner.ReadInteger(OutEnvelope.RequestId) == false)
+			{
+				return false;
+			}
+		}
+		else if (HubJson::IsKey(Key, TEXT("seq")))
+		{
+			if (Scanner.ReadInteger(OutEnvelope.Seq) == false)
+			{
+				return false;
+			}
+		}
+		else if (HubJson::IsKey(Key, TEXT("ack")))
+		{
+			if (Scanner.ReadInteger(OutEnvelope.Ack) == false)
+			{
+				return false;
+			}
+		}
+		else if (HubJson::IsKey(Key, TEXT("data")))
+		{
+			FView Data;
+			if (Scanner.Peek() == '"')
+			{
+				bool bHasEscapes = false;
+				if (Scanner.ReadString(Data, bHasEscapes) == false)
+				{
+					return false;
+				}
+
+				// hub sends data as json string (json inside json)
+				if (bHasEscapes && HubJson::Unescape(Data, Arena, Data) == false)
+				{
+					return false;
+				}
+			}
+			else
+			{
+				if (Scanner.SkipValue(Data) == false)
+				{
+					return false;
+				}
+
+				if (HubJson::IsNull(Data))
+				{
+					Data = FView();
+				}
+			}
+
+			if constexpr (bUtf8)
+			{
+				OutEnvelope.Payload.Utf8Json = Data;
+			}
+			else
+			{
+				OutEnvelope.Payload.Json = Data;
+			}
+		}
+		else
+		{
+			FView Unused;
+			if (Scanner.SkipValue(Unused) == false)
+			{
+				return false;
+			}
+		}
+	}
+	while (Scanner.TryConsume(','));
+
+	return Scanner.TryConsume('}');
+}
+
+template <typename CharType>
+bool FHubMessageEnvelope::ForEachInTextBatch(const TStringView<CharType> Message, const TFunctionRef<void(TStringView<CharType>)> Visitor)
+{
+	THubJsonScanner<CharType> Scanner(Message);
+	if (Scanner.TryConsume('[') == false)
+	{
+		return false;
+	}
+
+	if (Scanner.TryConsume(']'))
+	{
+		return true;
+	}
+
+	do
+	{
+		TStringView<CharType> Element;
+		if (Scanner.SkipValue(Element) == false)
+		{
+			return false;
+		}
+
+		Visitor(Element);
+	}
+	while (Scanner.TryConsume(','));
+
+	return Scanner.TryConsume(']');
+}
+
+bool FHubMessageEnvelope::TryDecode(const FStringView Message, FHubDecodeArena& Arena, FHubMessageEnvelope& OutEnvelope)
+{
+	return TryDecodeText(Message, Arena, OutEnvelope);
+}
+
+bool FHubMessageEnvelope::IsBatch(const FStringView Message)
+{
+	return THubJsonScanner<TCHAR>(Message).Peek() == '[';
+}
+
+bool FHubMessageEnvelope::ForEachInBatch(const FStringView Message, const TFunctionRef<void(FStringView)> Visitor)
+{
+	return ForEachInTextBatch(Message, Visitor);
+}
+
+bool FHubMessageEnvelope::TryDecode(const FUtf8StringView Message, FHubDecodeArena& Arena, FHubMessageEnvelope& OutEnvelope)
+{
+	return TryDecodeText(Message, Arena, OutEnvelope);
+}
+
+bool FHubMessageEnvelope::IsBatch(const FUtf8StringView Message)
+{
+	return THubJsonScanner<UTF8CHAR>(Message).Peek() == '[';
+}
+
+bool FHubMessageEnvelope::ForEachInBatch(const FUtf8StringView Message, const TFunctionRef<void(FUtf8StringView)> Visitor)
+{
+	return ForEachInTextBatch(Message, Visitor);
+}
+
+bool FHubMessageEnvelope::TryDecode(const TConstArrayView<uint8> Message, FHubMessageEnvelope& OutEnvelope)
+{
+	using namespace HubMessageEnvelope;
+
+	FHubMessagePackReader Reader(Message);
+	uint32 NumFields = 0;
+	if (Reader.ReadMapHeader(NumFields) == false)
+	{
+		return false;
+	}
+
+	for (uint32 Index = 0; Index < NumFields; ++Index)
+	{
+		TConstArrayView<uint8> Key;
+		if (Reader.ReadRawString(Key) == false)
+		{
+			return false;
+		}
+
+		bool bRead = true;
+		if (IsKey(Key, "type"))
+		{
+			bRead = TryReadEnum(Reader, OutEnvelope.Type);
+		}
+		else if (IsKey(Key, "controller"))
+		{
+			bRead = TryReadEnum(Reader, OutEnvelope.Controller);
+		}
+		else if (IsKey(Key, "method"))
+		{
+			TConstArrayView<uint8> Method;
+			bRead = Reader.ReadRawString(Method);
+			if (bRead)
+			{
+				const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Method.GetData()), Method.Num());
+				OutEnvelope.MethodStorage.Reset();
+				OutEnvelope.MethodStorage.Append(Converted.Get(), Converted.Length());
+				OutEnvelope.Method = OutEnvelope.MethodStorage.ToView();
+			}
+		}
+		else if (IsKey(Key, "requestId"))
+		{
+			bRead = Reader.TryReadNil() || Reader.ReadInteger(OutEnvelope.RequestId);
+		}
+		else if (IsKey(Key, "seq"))
+		{
+			bRead = Reader.ReadInteger(OutEnvelope.Seq);
+		}
+		else if (IsKey(Key, "ack"))
+		{
+			bRead = Reader.ReadInteger(OutEnvelope.Ack);
+		}
+		else if (IsKey(Key, "data"))
+		{
+			if (Reader.IsNextString())
+			{
+				// string encoded json data, MessagePack strings are utf-8 without escapes, so it is read in place
+				TConstArrayView<uint8> Data;
+				bRead = Reader.ReadRawString(Data);
+				OutEnvelope.Payload.Utf8Json = FUtf8StringView(reinterpret_cast<const UTF8CHAR*>(Data.GetData()), Data.Num());
+			}
+			else if (Reader.TryReadNil() == false)
+			{
+				const int32 DataStart = Reader.GetOffset();
+				bRead = Reader.Skip();
+				OutEnvelope.Payload.MessagePack = Message.Slice(DataStart, Reader.GetOffset() - DataStart);
+			}
+		}
+		else
+		{
+			bRead = Reader.Skip();
+		}
+
+		if (bRead == false)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool FHubMessageEnvelope::IsBatch(const TConstArrayView<uint8> Message)
+{
+	uint32 Num = 0;
+	return FHubMessagePackReader(Message).ReadArrayHeader(Num);
+}
+
+bool FHubMessageEnvelope::ForEachInBatch(const TConstArrayView<uint8> Message, const TFunctionRef<void(TConstArrayView<uint8>)> Visitor)
+{
+	FHubMessagePackReader Reader(Message);
+	uint32 Num = 0;
+	if (Reader.ReadArrayHeader(Num) == false)
+	{
+		return false;
+	}
+
+	for (uint32 Index = 0; Index < Num; ++Index)
+	{
+		const int32 ElementStart = Reader.GetOffset();
+		if (Reader.Skip() == false)
+		{
+			return false;
+		}
+
+		Visitor(Message.Slice(ElementStart, Reader.GetOffset() - ElementStart));
+	}
+
+	return true;
+}
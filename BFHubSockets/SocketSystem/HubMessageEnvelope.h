@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubServicesBaseData.h"
+#include "HubStructCodec.h"
+
+class FHubDecodeArena;
+
+/**
+ * "data" of inbound hub message
+ * Points into the received frame (or into decode arena for string encoded data), nothing is copied
+ * One of views is set: Utf8Json for json frames received from socket, MessagePack for binary frames,
+ * Json for text built in process (fake responses)
+ */
+struct BFHUBSOCKETS_API FHubMessagePayload
+{
+	FStringView Json;
+	TConstArrayView<uint8> MessagePack;
+	FUtf8StringView Utf8Json;
+
+	bool IsEmpty() const { return Json.IsEmpty() && MessagePack.IsEmpty() && Utf8Json.IsEmpty(); }
+	// Bytes of the payload, characters for Json
+	int32 GetSize() const { return Json.Len() + MessagePack.Num() + Utf8Json.Len(); }
+
+	template <typename TStruct>
+	bool ReadStruct(TStruct& OutStruct) const;
+
+	// Json text of the payload for logs and error data
+	FString ToString() const;
+};
+
+/**
+ * Copy of payload for handling after the frame is gone (worker decode, ordered dispatch)
+ */
+struct BFHUBSOCKETS_API FHubOwnedMessagePayload
+{
+	explicit FHubOwnedMessagePayload(const FHubMessagePayload& InPayload)
+		: Json(InPayload.Json)
+		, MessagePack(InPayload.MessagePack)
+		, Utf8Json(InPayload.Utf8Json.GetData(), InPayload.Utf8Json.Len())
+	{
+	}
+
+	FHubMessagePayload GetView() const { return FHubMessagePayload{Json, MessagePack, FUtf8StringView(Utf8Json.GetData(), Utf8Json.Num())}; }
+
+private:
+	FString Json;
+	TArray<uint8> MessagePack;
+	TArray<UTF8CHAR> Utf8Json;
+};
+
+/**
+ * Envelope of inbound hub message: type, controller and method are read in one pass over the frame,
+ * payload kept as a view and parsed only once by the typed handler
+ */
+struct BFHUBSOCKETS_API FHubMessageEnvelope
+{
+	UE_NONCOPYABLE(FHubMessageEnvelope);
+
+	FHubMessageEnvelope() = default;
+
+	EHubMessageType Type = EHubMessageType::RESPONSE;
+	EHubControllerType Controller = {};
+	// Points into the frame, or into arena or envelope storage when method has escapes or frame is not TCHAR text
+	FStringView Method;
+	// Echo of request id for correlated requests, 0 for everything else
+	int64 RequestId = 0;
+	// Number of hub message in resumable session and last client message hub received, 0 outside of session (see FHubSession)
+	int64 Seq = 0;
+	int64 Ack = 0;
+	FHubMessagePayload Payload;
+
+	/** Frame string is not copied, unescaped strings are allocated in the arena
+	 * Envelope views are valid while the frame is alive and the arena is not reset */
+	static bool TryDecode(FStringView Message, FHubDecodeArena& Arena, FHubMessageEnvelope& OutEnvelope);
+
+	// Batch frame is json array of envelopes "[{...},{...}]"
+	static bool IsBatch(FStringView Message);
+	static bool ForEachInBatch(FStringView Message, TFunctionRef<void(FStringView)> Visitor);
+
+	// Json frame as received from socket, payload stays utf-8 and is read by FHubUtf8JsonReader
+	static bool TryDecode(FUtf8StringView Message, FHubDecodeArena& Arena, FHubMessageEnvelope& OutEnvelope);
+	static bool IsBatch(FUtf8StringView Message);
+	static bool ForEachInBatch(FUtf8StringView Message, TFunctionRef<void(FUtf8StringView)> Visitor);
+
+	// MessagePack wire format: map with the same keys, batch is array of maps, strings need no unescaping
+	static bool TryDecode(TConstArrayView<uint8> Message, FHubMessageEnvelope& OutEnvelope);
+	static bool IsBatch(TConstArrayView<uint8> Message);
+	static bool ForEachInBatch(TConstArrayView<uint8> Message, TFunctionRef<void(TConstArrayView<uint8>)> Visitor);
+
+private:
+	template <typename CharType>
+	static bool TryDecodeText(TStringView<CharType> Message, FHubDecodeArena& Arena, FHubMessageEnvelope& OutEnvelope);
+
+	template <typename CharType>
+	static bool ForEachInTextBatch(TStringView<CharType> Message, TFunctionRef<void(TStringView<CharType>)> Visitor);
+
+	// method names are short, inline storage avoids allocation per message
+	TStringBuilder<64> MethodStorage;
+};
+
+template <typename TStruct>
+bool FHubMessagePayload::ReadStruct(TStruct& OutStruct) const
+{
+	if (MessagePack.IsEmpty() == false)
+	{
+		return HubStructCodec::Read(MessagePack, OutStruct);
+	}
+	if (Utf8Json.IsEmpty() == false)
+	{
+		return HubStructCodec::Read(Utf8Json, OutStruct);
+	}
+	return HubStructCodec::Read(Json, OutStruct);
+}
@@ -0,0 +1,979 @@
+﻿#include "HubMessagePack.h"
+
+#include "Dom/JsonValue.h"
+
+namespace HubMessagePack
+{
+	constexpr uint8 Nil = 0xc0;
+	constexpr uint8 False = 0xc2;
+	constexpr uint8 True = 0xc3;
+	constexpr uint8 Bin8 = 0xc4;
+	constexpr uint8 Bin16 = 0xc5;
+	constexpr uint8 Bin32 = 0xc6;
+	constexpr uint8 Ext8 = 0xc7;
+	constexpr uint8 Ext16 = 0xc8;
+	constexpr uint8 Ext32 = 0xc9;
+	constexpr uint8 Float32 = 0xca;
+	constexpr uint8 Float64 = 0xcb;
+	constexpr uint8 UInt8 = 0xcc;
+	constexpr uint8 UInt16 = 0xcd;
+	constexpr uint8 UInt32 = 0xce;
+	constexpr uint8 UInt64 = 0xcf;
+	constexpr uint8 Int8 = 0xd0;
+	constexpr uint8 Int16 = 0xd1;
+	constexpr uint8 Int32 = 0xd2;
+	constexpr uint8 Int64 = 0xd3;
+	constexpr uint8 FixExt1 = 0xd4;
+	constexpr uint8 FixExt16 = 0xd8;
+	constexpr uint8 Str8 = 0xd9;
+	constexpr uint8 Str16 = 0xda;
+	constexpr uint8 Str32 = 0xdb;
+	constexpr uint8 Array16 = 0xdc;
+	constexpr uint8 Array32 = 0xdd;
+	constexpr uint8 Map16 = 0xde;
+	constexpr uint8 Map32 = 0xdf;
+
+	constexpr uint8 FixMap = 0x80;
+	constexpr uint8 FixArray = 0x90;
+	constexpr uint8 FixStr = 0xa0;
+
+	// placeholder header of open container: marker + uint32 size
+	constexpr int32 ContainerHeaderSize = 5;
+
+	// deep nesting in frame from network should not blow the stack
+	constexpr int32 MaxDepth = 64;
+
+	bool IsFixMap(const uint8 Marker) { return (Marker & 0xf0) == FixMap; }
+	bool IsFixArray(const uint8 Marker) { return (Marker & 0xf0) == FixArray; }
+	bool IsFixStr(const uint8 Marker) { return (Marker & 0xe0) == FixStr; }
+	bool IsPositiveFixInt(const uint8 Marker) { return Marker <= 0x7f; }
+	bool IsNegativeFixInt(const uint8 Marker) { return Marker >= 0xe0; }
+}
+
+// FHubMessagePackWriter
+
+FHubMessagePackWriter::FHubMessagePackWriter(TArray<uint8>& InBuffer)
+	: Buffer(InBuffer)
+{
+}
+
+void FHubMessagePackWriter::WriteObjectStart()
+{
+	BeginContainer(true);
+}
+
+void FHubMessagePackWriter::WriteObjectStart(const FStringView Identifier)
+{
+	WriteKey(Identifier);
+	BeginContainer(true);
+}
+
+void FHubMessagePackWriter::WriteObjectEnd()
+{
+	check(Containers.Num() > 0 && Containers.Last().bIsMap);
+	EndContainer();
+}
+
+void FHubMessagePackWriter::WriteArrayStart()
+{
+	BeginContainer(false);
+}
+
+void FHubMessagePackWriter::WriteArrayStart(const FStringView Identifier)
+{
+	WriteKey(Identifier);
+	BeginContainer(false);
+}
+
+void FHubMessagePackWriter::WriteArrayEnd()
+{
+	check(Containers.Num() > 0 && Containers.Last().bIsMap == false);
+	EndContainer();
+}
+
+void FHubMessagePackWriter::WriteValue(const FStringView Identifier, const FStringView Value)
+{
+	WriteKey(Identifier);
+	WriteString(Value);
+}
+
+void FHubMessagePackWriter::WriteValue(const FStringView Identifier, const bool Value)
+{
+	WriteKey(Identifier);
+	WriteBool(Value);
+}
+
+void FHubMessagePackWriter::WriteValue(const FStringView Identifier, const int64 Value)
+{
+	WriteKey(Identifier);
+	WriteInteger(Value);
+}
+
+void FHubMessagePackWriter::WriteValue(const FStringView Identifier, const double Value)
+{
+	WriteKey(Identifier);
+	WriteDouble(Value);
+}
+
+void FHubMessagePackWriter::WriteNull(const FStringView Identifier)
+{
+	WriteKey(Identifier);
+	WriteNil();
+}
+
+void FHubMessagePackWriter::WriteJsonObject(const FStringView Identifier, const TSharedRef<FJsonObject>& Object)
+{
+	WriteKey(Identifier);
+	BeginContainer(true);
+	for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : Object->Values)
+	{
+		WriteKey(Field.Key);
+		WriteJsonValue(Field.Value);
+	}
+	EndContainer();
+}
+
+void FHubMessagePackWriter::WriteJsonValue(const TSharedPtr<FJsonValue>& Value)
+{
+	if (Value.IsValid() == false)
+	{
+		WriteNil();
+		return;
+	}
+
+	switch (Value->Type)
+	{
+	case EJson::String:
+		WriteString(Value->AsString());
+		break;
+	case EJson::Number:
+		{
+			// FJsonObjectConverter writes every number as double, keep integers compact on the wire
+			const double Number = Value->AsNumber();
+			if (FMath::IsFinite(Number) && FMath::Frac(Number) == 0.0 && FMath::Abs(Number) < 9007199254740992.0)
+			{
+				WriteInteger(static_cast<int64>(Number));
+			}
+			else
+			{
+				WriteDouble(Number);
+			}
+		}
+		break;
+	case EJson::Boolean:
+		WriteBool(Value->AsBool());
+		break;
+	case EJson::Array:
+		BeginContainer(false);
+		for (const TSharedPtr<FJsonValue>& Element : Value->AsArray())
+		{
+			WriteJsonValue(Element);
+		}
+		EndContainer();
+		break;
+	case EJson::Object:
+		BeginContainer(true);
+		for (const TPair<FString, TSharedPtr<FJsonValue>>& Field : Value->AsObject()->Values)
+		{
+			WriteKey(Field.Key);
+			WriteJsonValue(Field.Value);
+		}
+		EndContainer();
+		break;
+	default:
+		WriteNil();
+		break;
+	}
+}
+
+void FHubMessagePackWriter::WriteString(const FStringView Value)
+{
+	using namespace HubMessagePack;
+
+	CountElement();
+
+	const FTCHARToUTF8 Utf8(Value.GetData(), Value.Len());
+	const uint32 Length = Utf8.Length();
+
+	if (Length < 32)
+	{
+		WriteByte(FixStr | static_cast<uint8>(Length));
+	}
+	else if (Length <= MAX_uint8)
+	{
+		WriteByte(Str8);
+		WriteBigEndian(Length, 1);
+	}
+	else if (Length <= MAX_uint16)
+	{
+		WriteByte(Str16);
+		WriteBigEndian(Length, 2);
+	}
+	else
+	{
+		WriteByte(Str32);
+		WriteBigEndian(Length, 4);
+	}
+
+	Buffer.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Length);
+}
+
+void FHubMessagePackWriter::WriteBool(const bool Value)
+{
+	CountElement();
+	WriteByte(Value ? HubMessagePack::True : HubMessagePack::False);
+}
+
+void FHubMessagePackWriter::WriteInteger(const int64 Value)
+{
+	using namespace HubMessagePack;
+
+	CountElement();
+
+	if (Value >= 0)
+	{
+		if (Value <= 0x7f)
+		{
+			WriteByte(static_cast<uint8>(Value));
+		}
+		else if (Value <= MAX_uint8)
+		{
+			WriteByte(UInt8);
+			WriteBigEndian(Value, 1);
+		}
+		else if (Value <= MAX_uint16)
+		{
+			WriteByte(UInt16);
+			WriteBigEndian(Value, 2);
+		}
+		else if (Value <= MAX_uint32)
+		{
+			WriteByte(UInt32);
+			WriteBigEndian(Value, 4);
+		}
+		else
+		{
+			WriteByte(UInt64);
+			WriteBigEndian(Value, 8);
+		}
+	}
+	else
+	{
+		if (Value >= -32)
+		{
+			WriteByte(static_cast<uint8>(static_cast<int8>(Value)));
+		}
+		else if (Value >= MIN_int8)
+		{
+			WriteByte(Int8);
+			WriteBigEndian(static_cast<uint64>(Value), 1);
+		}
+		else if (Value >= MIN_int16)
+		{
+			WriteByte(Int16);
+			WriteBigEndian(static_cast<uint64>(Value), 2);
+		}
+		else if (Value >= MIN_int32)
+		{
+			WriteByte(Int32);
+			WriteBigEndian(static_cast<uint64>(Value), 4);
+		}
+		else
+		{
+			WriteByte(Int64);
+			WriteBigEndian(static_cast<uint64>(Value), 8);
+		}
+	}
+}
+
+void FHubMessagePackWriter::WriteDouble(const double Value)
+{
+	CountElement();
+
+	// float32 is enough when value survives round trip
+	const float Single = static_cast<float>(Value);
+	if (static_cast<double>(Single) == Value)
+	{
+		WriteByte(HubMessagePack::Float32);
+		uint32 Bits = 0;
+		FMemory::Memcpy(&Bits, &Single, sizeof(Bits));
+		WriteBigEndian(Bits, 4);
+	}
+	else
+	{
+		WriteByte(HubMessagePack::Float64);
+		uint64 Bits = 0;
+		FMemory::Memcpy(&Bits, &Value, sizeof(Bits));
+		WriteBigEndian(Bits, 8);
+	}
+}
+
+void FHubMessagePackWriter::WriteNil()
+{
+	CountElement();
+	WriteByte(HubMessagePack::Nil);
+}
+
+void FHubMessagePackWriter::WriteRaw(const TConstArrayView<uint8> Encoded)
+{
+	CountElement();
+	Buffer.Append(Encoded.GetData(), Encoded.Num());
+}
+
+bool FHubMessagePackWriter::PrependToMap(const TConstArrayView<uint8> Map, const TConstArrayView<TPair<FStringView, int64>> Fields, TArray<uint8>& OutMap)
+{
+	using namespace HubMessagePack;
+
+	if (Map.IsEmpty())
+	{
+		return false;
+	}
+
+	uint32 Size = 0;
+	int32 HeaderSize = 1;
+	if (IsFixMap(Map[0]))
+	{
+		Size = Map[0] & 0x0f;
+	}
+	else if (Map[0] == Map16 && Map.Num() >= 3)
+	{
+		Size = (uint32(Map[1]) << 8) | Map[2];
+		HeaderSize = 3;
+	}
+	else if (Map[0] == Map32 && Map.Num() >= 5)
+	{
+		Size = (uint32(Map[1]) << 24) | (uint32(Map[2]) << 16) | (uint32(Map[3]) << 8) | Map[4];
+		HeaderSize = 5;
+	}
+	else
+	{
+		return false;
+	}
+
+	OutMap.Reset(Map.Num() + ContainerHeaderSize + Fields.Num() * 16);
+	FHubMessagePackWriter Writer(OutMap);
+	Writer.BeginContainer(true);
+	for (const TPair<FStringView, int64>& Field : Fields)
+	{
+		Writer.WriteValue(Field.Key, Field.Value);
+	}
+
+	// entries of the original map are copied as is and counted by its header
+	Writer.Containers.Last().NumElements += Size * 2;
+	OutMap.Append(Map.GetData() + HeaderSize, Map.Num() - HeaderSize);
+	Writer.EndContainer();
+	return true;
+}
+
+void FHubMessagePackWriter::WriteKey(const FStringView Identifier)
+{
+	check(Containers.Num() > 0 && Containers.Last().bIsMap);
+	WriteString(Identifier);
+}
+
+void FHubMessagePackWriter::BeginContainer(const bool bIsMap)
+{
+	// container is an element of the parent, its own elements counted separately
+	CountElement();
+
+	FContainer& Container = Containers.AddDefaulted_GetRef();
+	Container.HeaderOffset = Buffer.Num();
+	Container.bIsMap = bIsMap;
+	Buffer.AddZeroed(HubMessagePack::ContainerHeaderSize);
+}
+
+void FHubMessagePackWriter::EndContainer()
+{
+	using namespace HubMessagePack;
+
+	const FContainer Container = Containers.Pop();
+	// map elements counted per key and per value
+	const uint32 Size = Container.bIsMap ? Container.NumElements / 2 : Container.NumElements;
+
+	if (Size < 16)
+	{
+		// most messages are small, drop unused size bytes
+		Buffer[Container.HeaderOffset] = (Container.bIsMap ? FixMap : FixArray) | static_cast<uint8>(Size);
+		Buffer.RemoveAt(Container.HeaderOffset + 1, ContainerHeaderSize - 1);
+		return;
+	}
+
+	uint8* Header = Buffer.GetData() + Container.HeaderOffset;
+	Header[0] = Container.bIsMap ? Map32 : Array32;
+	Header[1] = static_cast<uint8>(Size >> 24);
+	Header[2] = static_cast<uint8>(Size >> 16);
+	Header[3] = static_cast<uint8>(Size >> 8);
+	Header[4] = static_cast<uint8>(Size);
+}
+
+void FHubMessagePackWriter::CountElement()
+{
+	if (Containers.Num() > 0)
+	{
+		++Containers.Last().NumElements;
+	}
+}
+
+void FHubMessagePackWriter::WriteBigEndian(const uint64 Value, const int32 NumBytes)
+{
+	for (int32 Index = NumBytes - 1; Index >= 0; --Index)
+	{
+		WriteByte(static_cast<uint8>(Value >> (Index * 8)));
+	}
+}
+
+// FHubMessagePackReader
+
+FHubMessagePackReader::FHubMessagePackReader(const TConstArrayView<uint8> InData)
+	: Data(InData)
+{
+}
+
+bool FHubMessagePackReader::IsField(const TCHAR* Name) const
+{
+	int32 Index = 0;
+	for (; Name[Index] != 0; ++Index)
+	{
+		if (Index >= CurrentKey.Num() || FChar::ToLower(static_cast<TCHAR>(CurrentKey[Index])) != FChar::ToLower(Name[Index]))
+		{
+			return false;
+		}
+	}
+	return Index == CurrentKey.Num();
+}
+
+bool FHubMessagePackReader::Read(FString& OutValue)
+{
+	if (TryReadNil())
+	{
+		return true;
+	}
+
+	TConstArrayView<uint8> Utf8;
+	if (ReadRawString(Utf8) == false)
+	{
+		return false;
+	}
+
+	const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Utf8.GetData()), Utf8.Num());
+	OutValue = FString(Converted.Length(), Converted.Get());
+	return true;
+}
+
+bool FHubMessagePackReader::Read(bool& OutValue)
+{
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	switch (Data[Offset])
+	{
+	case HubMessagePack::True:
+		OutValue = true;
+		break;
+	case HubMessagePack::False:
+		OutValue = false;
+		break;
+	case HubMessagePack::Nil:
+		break;
+	default:
+		return false;
+	}
+
+	++Offset;
+	return true;
+}
+
+bool FHubMessagePackReader::Read(int32& OutValue)
+{
+	double Number = 0.0;
+	if (TryReadNil())
+	{
+		return true;
+	}
+	if (ReadNumber(Number) == false)
+	{
+		return false;
+	}
+	OutValue = static_cast<int32>(Number);
+	return true;
+}
+
+bool FHubMessagePackReader::Read(int64& OutValue)
+{
+	return TryReadNil() || ReadInteger(OutValue);
+}
+
+bool FHubMessagePackReader::Read(float& OutValue)
+{
+	double Number = 0.0;
+	if (TryReadNil())
+	{
+		return true;
+	}
+	if (ReadNumber(Number) == false)
+	{
+		return false;
+	}
+	OutValue = static_cast<float>(Number);
+	return true;
+}
+
+bool FHubMessagePackReader::Read(double& OutValue)
+{
+	return TryReadNil() || ReadNumber(OutValue);
+}
+
+bool FHubMessagePackReader::Skip()
+{
+	return SkipValue(0);
+}
+
+bool FHubMessagePackReader::ReadMapHeader(uint32& OutNum)
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	if (IsFixMap(Marker))
+	{
+		++Offset;
+		OutNum = Marker & 0x0f;
+		return true;
+	}
+
+	uint64 Num = 0;
+	if (Marker == Map16 || Marker == Map32)
+	{
+		++Offset;
+		if (ReadBigEndian(Marker == Map16 ? 2 : 4, Num) == false)
+		{
+			return false;
+		}
+		OutNum = static_cast<uint32>(Num);
+		return true;
+	}
+
+	return false;
+}
+
+bool FHubMessagePackReader::ReadArrayHeader(uint32& OutNum)
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	if (IsFixArray(Marker))
+	{
+		++Offset;
+		OutNum = Marker & 0x0f;
+		return true;
+	}
+
+	uint64 Num = 0;
+	if (Marker == Array16 || Marker == Array32)
+	{
+		++Offset;
+		if (ReadBigEndian(Marker == Array16 ? 2 : 4, Num) == false)
+		{
+			return false;
+		}
+		OutNum = static_cast<uint32>(Num);
+		return true;
+	}
+
+	return false;
+}
+
+bool FHubMessagePackReader::ReadRawString(TConstArrayView<uint8>& OutUtf8)
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	uint64 Length = 0;
+
+	if (IsFixStr(Marker))
+	{
+		++Offset;
+		Length = Marker & 0x1f;
+	}
+	else if (Marker == Str8 || Marker == Str16 || Marker == Str32)
+	{
+		++Offset;
+		if (ReadBigEndian(Marker == Str8 ? 1 : Marker == Str16 ? 2 : 4, Length) == false)
+		{
+			return false;
+		}
+	}
+	else
+	{
+		return false;
+	}
+
+	const uint8* Bytes = nullptr;
+	if (ReadBytes(static_cast<int32>(Length), Bytes) == false)
+	{
+		return false;
+	}
+
+	OutUtf8 = TConstArrayView<uint8>(Bytes, static_cast<int32>(Length));
+	return true;
+}
+
+bool FHubMessagePackReader::ReadNumber(double& OutValue)
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	uint64 Bits = 0;
+
+	if (Marker == Float32)
+	{
+		++Offset;
+		if (ReadBigEndian(4, Bits) == false)
+		{
+			return false;
+		}
+		const uint32 SingleBits = static_cast<uint32>(Bits);
+		float Single = 0.0f;
+		FMemory::Memcpy(&Single, &SingleBits, sizeof(Single));
+		OutValue = Single;
+		return true;
+	}
+
+	if (Marker == Float64)
+	{
+		++Offset;
+		if (ReadBigEndian(8, Bits) == false)
+		{
+			return false;
+		}
+		FMemory::Memcpy(&OutValue, &Bits, sizeof(OutValue));
+		return true;
+	}
+
+	int64 Integer = 0;
+	if (ReadInteger(Integer) == false)
+	{
+		return false;
+	}
+	OutValue = static_cast<double>(Integer);
+	return true;
+}
+
+bool FHubMessagePackReader::ReadInteger(int64& OutValue)
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	if (IsPositiveFixInt(Marker) || IsNegativeFixInt(Marker))
+	{
+		++Offset;
+		OutValue = static_cast<int8>(Marker);
+		return true;
+	}
+
+	int32 NumBytes = 0;
+	bool bSigned = false;
+	switch (Marker)
+	{
+	case UInt8: NumBytes = 1; break;
+	case UInt16: NumBytes = 2; break;
+	case UInt32: NumBytes = 4; break;
+	case UInt64: NumBytes = 8; break;
+	case Int8: NumBytes = 1; bSigned = true; break;
+	case Int16: NumBytes = 2; bSigned = true; break;
+	case Int32: NumBytes = 4; bSigned = true; break;
+	case Int64: NumBytes = 8; bSigned = true; break;
+	case Float32:
+	case Float64:
+		{
+			double Number = 0.0;
+			if (ReadNumber(Number) == false)
+			{
+				return false;
+			}
+			OutValue = static_cast<int64>(Number);
+			return true;
+		}
+	default:
+		return false;
+	}
+
+	++Offset;
+	uint64 Bits = 0;
+	if (ReadBigEndian(NumBytes, Bits) == false)
+	{
+		return false;
+	}
+
+	if (bSigned && NumBytes < 8)
+	{
+		// sign extension
+		const int32 Shift = 64 - NumBytes * 8;
+		OutValue = static_cast<int64>(Bits << Shift) >> Shift;
+	}
+	else
+	{
+		OutValue = static_cast<int64>(Bits);
+	}
+	return true;
+}
+
+bool FHubMessagePackReader::TryReadNil()
+{
+	if (IsAtEnd() == false && Data[Offset] == HubMessagePack::Nil)
+	{
+		++Offset;
+		return true;
+	}
+	return false;
+}
+
+bool FHubMessagePackReader::IsNextString() const
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	return IsFixStr(Marker) || Marker == Str8 || Marker == Str16 || Marker == Str32;
+}
+
+bool FHubMessagePackReader::IsNextMap() const
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Data[Offset];
+	return IsFixMap(Marker) || Marker == Map16 || Marker == Map32;
+}
+
+bool FHubMessagePackReader::ReadJsonValue(TSharedPtr<FJsonValue>& OutValue)
+{
+	return ReadJsonValue(OutValue, 0);
+}
+
+bool FHubMessagePackReader::IsMessagePack(const TConstArrayView<uint8> Frame)
+{
+	using namespace HubMessagePack;
+
+	if (Frame.IsEmpty())
+	{
+		return false;
+	}
+
+	const uint8 Marker = Frame[0];
+	return IsFixMap(Marker) || IsFixArray(Marker) || Marker == Map16 || Marker == Map32 || Marker == Array16 || Marker == Array32;
+}
+
+bool FHubMessagePackReader::ReadBytes(const int32 Num, const uint8*& OutBytes)
+{
+	if (Num < 0 || Num > Data.Num() - Offset)
+	{
+		return false;
+	}
+
+	OutBytes = Data.GetData() + Offset;
+	Offset += Num;
+	return true;
+}
+
+bool FHubMessagePackReader::ReadBigEndian(const int32 NumBytes, uint64& OutValue)
+{
+	const uint8* Bytes = nullptr;
+	if (ReadBytes(NumBytes, Bytes) == false)
+	{
+		return false;
+	}
+
+	OutValue = 0;
+	for (int32 Index = 0; Index < NumBytes; ++Index)
+	{
+		OutValue = (OutValue << 8) | Bytes[Index];
+	}
+	return true;
+}
+
+bool FHubMessagePackReader::SkipValue(const int32 Depth)
+{
+	using namespace HubMessagePack;
+
+	if (IsAtEnd() || Depth > MaxDepth)
+	{
+		return false;
+	}
+
+	uint32 Num = 0;
+	if (ReadMapHeader(Num))
+	{
+		for (uint64 Index = 0; Index < static_cast<uint64>(Num) * 2; ++Index)
+		{
+			if (SkipValue(Depth + 1) == false)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	if (ReadArrayHeader(Num))
+	{
+		for (uint32 Index = 0; Index < Num; ++Index)
+		{
+			if (SkipValue(Depth + 1) == false)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	TConstArrayView<uint8> String;
+	double Number = 0.0;
+	bool bValue = false;
+	if (TryReadNil() || ReadRawString(String) || ReadNumber(Number) || Read(bValue))
+	{
+		return true;
+	}
+
+	// bin and ext are not produced by hub, still skipped to stay in sync with the stream
+	const uint8 Marker = Data[Offset];
+	uint64 Size = 0;
+	int32 SizeBytes = 0;
+	bool bHasType = false;
+
+	if (Marker >= FixExt1 && Marker <= FixExt16)
+	{
+		Size = 1ull << (Marker - FixExt1);
+		bHasType = true;
+	}
+	else if (Marker == Bin8 || Marker == Bin16 || Marker == Bin32)
+	{
+		SizeBytes = Marker == Bin8 ? 1 : Marker == Bin16 ? 2 : 4;
+	}
+	else if (Marker == Ext8 || Marker == Ext16 || Marker == Ext32)
+	{
+		SizeBytes = Marker == Ext8 ? 1 : Marker == Ext16 ? 2 : 4;
+		bHasType = true;
+	}
+	else
+	{
+		return false;
+	}
+
+	++Offset;
+	if (SizeBytes > 0 && ReadBigEndian(SizeBytes, Size) == false)
+	{
+		return false;
+	}
+
+	const uint8* Skipped = nullptr;
+	return Size <= MAX_int32 && ReadBytes(static_cast<int32>(Size) + (bHasType ? 1 : 0), Skipped);
+}
+
+bool FHubMessagePackReader::ReadJsonValue(TSharedPtr<FJsonValue>& OutValue, const int32 Depth)
+{
+	if (Depth > HubMessagePack::MaxDepth)
+	{
+		return false;
+	}
+
+	uint32 Num = 0;
+	if (ReadMapHeader(Num))
+	{
+		const TSharedRef<FJsonObject> Object = MakeShared<FJsonObject>();
+		for (uint32 Index = 0; Index < Num; ++Index)
+		{
+			FString Key;
+			TSharedPtr<FJsonValue> Value;
+			if (Read(Key) == false || ReadJsonValue(Value, Depth + 1) == false)
+			{
+				return false;
+			}
+			Object->SetField(Key, Value);
+		}
+		OutValue = MakeShared<FJsonValueObject>(Object);
+		return true;
+	}
+
+	if (ReadArrayHeader(Num))
+	{
+		TArray<TSharedPtr<FJsonValue>> Elements;
+		// size comes from network, every element takes at least one byte
+		Elements.Reserve(FMath::Min<uint32>(Num, Data.Num() - Offset));
+		for (uint32 Index = 0; Index < Num; ++Index)
+		{
+			if (ReadJsonValue(Elements.AddDefaulted_GetRef(), Depth + 1) == false)
+			{
+				return false;
+			}
+		}
+		OutValue = MakeShared<FJsonValueArray>(Elements);
+		return true;
+	}
+
+	if (TryReadNil())
+	{
+		OutValue = MakeShared<FJsonValueNull>();
+		return true;
+	}
+
+	if (IsNextString())
+	{
+		FString String;
+		if (Read(String) == false)
+		{
+			return false;
+		}
+		OutValue = MakeShared<FJsonValueString>(MoveTemp(String));
+		return true;
+	}
+
+	bool bValue = false;
+	if (Read(bValue))
+	{
+		OutValue = MakeShared<FJsonValueBoolean>(bValue);
+		return true;
+	}
+
+	double Number = 0.0;
+	if (ReadNumber(Number))
+	{
+		OutValue = MakeShared<FJsonValueNumber>(Number);
+		return true;
+	}
+
+	return false;
+}
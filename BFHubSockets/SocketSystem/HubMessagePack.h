@@ -0,0 +1,153 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Dom/JsonObject.h"
+
+/**
+ * MessagePack writer with TJsonWriter-like API, so struct codecs and reflection DOM can be written in both formats
+ * Maps and arrays written with 32 bit size placeholder which is shrunk to fix size header when container closed
+ */
+class BFHUBSOCKETS_API FHubMessagePackWriter
+{
+public:
+	explicit FHubMessagePackWriter(TArray<uint8>& InBuffer);
+
+	void WriteObjectStart();
+	void WriteObjectStart(FStringView Identifier);
+	void WriteObjectEnd();
+
+	void WriteArrayStart();
+	void WriteArrayStart(FStringView Identifier);
+	void WriteArrayEnd();
+
+	void WriteValue(FStringView Identifier, FStringView Value);
+	void WriteValue(FStringView Identifier, const FString& Value) { WriteValue(Identifier, FStringView(Value)); }
+	void WriteValue(FStringView Identifier, const TCHAR* Value) { WriteValue(Identifier, FStringView(Value)); }
+	void WriteValue(FStringView Identifier, bool Value);
+	void WriteValue(FStringView Identifier, int32 Value) { WriteValue(Identifier, static_cast<int64>(Value)); }
+	void WriteValue(FStringView Identifier, int64 Value);
+	void WriteValue(FStringView Identifier, float Value) { WriteValue(Identifier, static_cast<double>(Value)); }
+	void WriteValue(FStringView Identifier, double Value);
+	void WriteNull(FStringView Identifier);
+
+	// Reflection path - struct converted by FJsonObjectConverter
+	void WriteJsonObject(FStringView Identifier, const TSharedRef<FJsonObject>& Object);
+	void WriteJsonValue(const TSharedPtr<FJsonValue>& Value);
+
+	// Array elements and root values
+	void WriteString(FStringView Value);
+	void WriteBool(bool Value);
+	void WriteInteger(int64 Value);
+	void WriteDouble(double Value);
+	void WriteNil();
+
+	// Appends already encoded value
+	void WriteRaw(TConstArrayView<uint8> Encoded);
+
+	bool Close() const { return Containers.IsEmpty(); }
+
+	// Copy of encoded map with integer fields written in front of its own, false if it is not a map
+	static bool PrependToMap(TConstArrayView<uint8> Map, TConstArrayView<TPair<FStringView, int64>> Fields, TArray<uint8>& OutMap);
+
+private:
+	void WriteKey(FStringView Identifier);
+	void BeginContainer(bool bIsMap);
+	void EndContainer();
+	void CountElement();
+
+	void WriteByte(uint8 Value) { Buffer.Add(Value); }
+	void WriteBigEndian(uint64 Value, int32 NumBytes);
+
+	struct FContainer
+	{
+		int32 HeaderOffset = 0;
+		uint32 NumElements = 0;
+		bool bIsMap = false;
+	};
+
+	TArray<uint8>& Buffer;
+	TArray<FContainer, TInlineAllocator<8>> Containers;
+};
+
+/**
+ * MessagePack reader, has the same API for struct codecs as THubCodecReader
+ * Every Read/Skip consumes exactly one value
+ */
+class BFHUBSOCKETS_API FHubMessagePackReader
+{
+public:
+	explicit FHubMessagePackReader(TConstArrayView<uint8> InData);
+
+	template <typename TStruct>
+	bool ReadRoot(TStruct& OutStruct)
+	{
+		return ReadStruct(OutStruct);
+	}
+
+	template <typename FieldVisitor>
+	bool ReadObject(FieldVisitor&& Visitor)
+	{
+		uint32 NumFields = 0;
+		if (ReadMapHeader(NumFields) == false)
+		{
+			return false;
+		}
+
+		for (uint32 Index = 0; Index < NumFields; ++Index)
+		{
+			if (ReadRawString(CurrentKey) == false || Visitor(*this) == false)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	// Field names expected to be ascii
+	bool IsField(const TCHAR* Name) const;
+
+	template <typename TStruct>
+	bool ReadStruct(TStruct& OutStruct);
+
+	bool Read(FString& OutValue);
+	bool Read(bool& OutValue);
+	bool Read(int32& OutValue);
+	bool Read(int64& OutValue);
+	bool Read(float& OutValue);
+	bool Read(double& OutValue);
+
+	bool Skip();
+
+	bool ReadMapHeader(uint32& OutNum);
+	bool ReadArrayHeader(uint32& OutNum);
+	// Utf-8 bytes of string without copying
+	bool ReadRawString(TConstArrayView<uint8>& OutUtf8);
+	bool ReadNumber(double& OutValue);
+	bool ReadInteger(int64& OutValue);
+	bool TryReadNil();
+
+	bool IsNextString() const;
+	bool IsNextMap() const;
+
+	// Reflection path - value converted to json DOM for FJsonObjectConverter
+	bool ReadJsonValue(TSharedPtr<FJsonValue>& OutValue);
+
+	int32 GetOffset() const { return Offset; }
+	bool IsAtEnd() const { return Offset >= Data.Num(); }
+	TConstArrayView<uint8> GetData() const { return Data; }
+
+	// Frame starts with map or array marker, json text never starts with these bytes
+	static bool IsMessagePack(TConstArrayView<uint8> Frame);
+
+private:
+	bool SkipValue(int32 Depth);
+	bool ReadJsonValue(TSharedPtr<FJsonValue>& OutValue, int32 Depth);
+
+	bool ReadBytes(int32 Num, const uint8*& OutBytes);
+	bool ReadBigEndian(int32 NumBytes, uint64& OutValue);
+
+	TConstArrayView<uint8> Data;
+	int32 Offset = 0;
+	TConstArrayView<uint8> CurrentKey;
+};
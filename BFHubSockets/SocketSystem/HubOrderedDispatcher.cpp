@@ -0,0 +1,81 @@
+﻿#include "HubOrderedDispatcher.h"
+
+#include "Async/Async.h"
+
+uint64 FHubOrderedDispatcher::Reserve()
+{
+	check(IsInGameThread());
+
+	return NextSlot++;
+}
+
+void FHubOrderedDispatcher::Complete(const uint64 Slot, TUniqueFunction<void()>&& Work)
+{
+	{
+		FScopeLock Lock(&CompletedLock);
+		CompletedWork.Add(Slot, MoveTemp(Work));
+	}
+
+	if (IsInGameThread())
+	{
+		Flush();
+	}
+	else
+	{
+		ScheduleFlush();
+	}
+}
+
+void FHubOrderedDispatcher::Dispatch(TUniqueFunction<void()>&& Work)
+{
+	check(IsInGameThread());
+
+	if (IsIdle())
+	{
+		Work();
+		return;
+	}
+
+	// nothing to flush - slot in front of it is not completed yet
+	FScopeLock Lock(&CompletedLock);
+	CompletedWork.Add(Reserve(), MoveTemp(Work));
+}
+
+void FHubOrderedDispatcher::Flush()
+{
+	check(IsInGameThread());
+
+	bFlushScheduled = false;
+
+	while (IsIdle() == false)
+	{
+		TUniqueFunction<void()> Work;
+		{
+			FScopeLock Lock(&CompletedLock);
+			if (CompletedWork.RemoveAndCopyValue(NextToRun, Work) == false)
+			{
+				break;
+			}
+		}
+
+		// moved before execution, work can dispatch new messages
+		++NextToRun;
+		Work();
+	}
+}
+
+void FHubOrderedDispatcher::ScheduleFlush()
+{
+	if (bFlushScheduled.exchange(true))
+	{
+		return;
+	}
+
+	AsyncTask(ENamedThreads::GameThread, [WeakThis = AsWeak()]()
+	{
+		if (const TSharedPtr<FHubOrderedDispatcher> This = WeakThis.Pin())
+		{
+			This->Flush();
+		}
+	});
+}
@@ -0,0 +1,39 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include <atomic>
+
+/**
+ * Keeps arrival order for work which is prepared on other threads
+ * Slot reserved on game thread, completed from any thread, executed on game thread strictly in reservation order
+ */
+class BFHUBSOCKETS_API FHubOrderedDispatcher : public TSharedFromThis<FHubOrderedDispatcher>
+{
+public:
+	// Game thread only
+	uint64 Reserve();
+
+	// Thread safe, flush scheduled to game thread
+	void Complete(uint64 Slot, TUniqueFunction<void()>&& Work);
+
+	// Game thread only, runs immediately when nothing waiting in front of it
+	void Dispatch(TUniqueFunction<void()>&& Work);
+
+	// Game thread only
+	bool IsIdle() const { return NextToRun == NextSlot; }
+	int32 GetPendingNum() const { return static_cast<int32>(NextSlot - NextToRun); }
+
+	// Game thread only, runs all completed work until first slot which is not completed yet
+	void Flush();
+
+private:
+	void ScheduleFlush();
+
+	uint64 NextSlot = 0;
+	uint64 NextToRun = 0;
+
+	FCriticalSection CompletedLock;
+	TMap<uint64, TUniqueFunction<void()>> CompletedWork;
+
+	std::atomic<bool> bFlushScheduled = false;
+};
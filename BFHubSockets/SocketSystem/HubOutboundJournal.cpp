@@ -0,0 +1,492 @@
+﻿#include "HubOutboundJournal.h"
+
+#include "HubSocketSystem.h"
+#include "HAL/PlatformFileManager.h"
+#include "Misc/Crc.h"
+#include "Misc/Paths.h"
+#include "Serialization/MemoryReader.h"
+#include "Serialization/MemoryWriter.h"
+
+#include "Logging/StructuredLog.h"
+#undef CHANNEL
+#define CHANNEL(Verbosity, Format, ...) UE_LOGFMT(BFHubSocketSystem, Verbosity, Format, ##__VA_ARGS__)
+#define LOG(Format, ...) CHANNEL(Log, Format, ##__VA_ARGS__)
+#define WARNING(Format, ...) CHANNEL(Warning, Format, ##__VA_ARGS__)
+#define ERROR(Format, ...) CHANNEL(Error, Format, ##__VA_ARGS__)
+#define VERBOSE(Format, ...) CHANNEL(Verbose, Format, ##__VA_ARGS__)
+
+namespace HubOutboundJournal
+{
+	constexpr uint32 Magic = 0x4A484642; // "BFHJ"
+	constexpr uint8 Version = 1;
+
+	// magic, version, wire format
+	constexpr int64 FileHeaderSize = 6;
+
+	enum class ERecordType : uint8
+	{
+		Message = 1,
+		Acknowledge = 2,
+	};
+
+	// type, id, size, crc
+	constexpr int64 MessageHeaderSize = 17;
+	// type, acknowledged id
+	constexpr int64 AcknowledgeSize = 9;
+
+	// smaller files are not worth rewriting
+	constexpr int64 MinCompactBytes = 1024 * 1024;
+
+	// file being written by Compact, and the same file when it is complete
+	const TCHAR* TempSuffix = TEXT(".tmp");
+	const TCHAR* CompactedSuffix = TEXT(".new");
+	// held while journal is open, file itself is closed and renamed during Compact
+	const TCHAR* LockSuffix = TEXT(".lock");
+
+	TArray<uint8> MakeFileHeader(const EHubWireFormat WireFormat)
+	{
+		TArray<uint8> Header;
+		FMemoryWriter Writer(Header);
+		uint32 HeaderMagic = Magic;
+		uint8 HeaderVersion = Version;
+		uint8 Format = static_cast<uint8>(WireFormat);
+		Writer << HeaderMagic << HeaderVersion << Format;
+		return Header;
+	}
+
+	TArray<uint8> MakeMessageHeader(uint64 Id, uint32 Size, uint32 Crc)
+	{
+		TArray<uint8> Header;
+		FMemoryWriter Writer(Header);
+		uint8 Type = static_cast<uint8>(ERecordType::Message);
+		Writer << Type << Id << Size << Crc;
+		return Header;
+	}
+
+	TArray<uint8> MakeAcknowledge(uint64 AckedId)
+	{
+		TArray<uint8> Record;
+		FMemoryWriter Writer(Record);
+		uint8 Type = static_cast<uint8>(ERecordType::Acknowledge);
+		Writer << Type << AckedId;
+		return Record;
+	}
+}
+
+FHubOutboundJournal::~FHubOutboundJournal()
+{
+	Close();
+}
+
+bool FHubOutboundJournal::Open(const FString& InFilename, const EHubWireFormat InWireFormat, const int64 InMaxBytes)
+{
+	Close();
+
+	Filename = InFilename;
+	WireFormat = InWireFormat;
+	MaxBytes = InMaxBytes;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	PlatformFile.CreateDirectoryTree(*FPaths::GetPath(Filename));
+
+	// exclusive write handle: no share mode on Windows, flock on unix platforms
+	LockHandle.Reset(PlatformFile.OpenWrite(*(Filename + HubOutboundJournal::LockSuffix), false, false));
+	if (LockHandle.IsValid() == false)
+	{
+		LOG("Outbound journal {0} is used by other instance", Filename);
+		return false;
+	}
+
+	if (RecoverCompacted() == false)
+	{
+		ERROR("Failed to finish rewrite of outbound journal {0}", Filename);
+		Close();
+		return false;
+	}
+
+	uint64 AckedId = 0;
+	TArray<FRecord> Records;
+	if (PlatformFile.FileExists(*Filename) && Scan(Records, AckedId) == false)
+	{
+		WARNING("Outbound journal {0} is unreadable or has other wire format, it is dropped", Filename);
+		Records.Reset();
+	}
+
+	LastAckedId = AckedId;
+	NextId = FMath::Max(NextId, AckedId + 1);
+	for (const FRecord& Record : Records)
+	{
+		NextId = FMath::Max(NextId, Record.Id + 1);
+		if (Record.Id > AckedId)
+		{
+			Pending.Add(Record);
+			PendingBytes += Record.Size;
+		}
+	}
+
+	if (Pending.IsEmpty() == false)
+	{
+		LOG("Outbound journal has {0} messages ({1} bytes) from previous run", Pending.Num(), PendingBytes);
+	}
+
+	// also cuts record torn by crash
+	if (Compact() == false)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+void FHubOutboundJournal::Close()
+{
+	Flush();
+	WriteHandle.Reset();
+	ReadHandle.Reset();
+	LockHandle.Reset();
+	FileSize = 0;
+
+	Pending.Reset();
+	PendingHead = 0;
+	PendingBytes = 0;
+	AcknowledgedBytes = 0;
+}
+
+bool FHubOutboundJournal::Scan(TArray<FRecord>& OutRecords, uint64& OutAckedId) const
+{
+	using namespace HubOutboundJournal;
+
+	const TUniquePtr<IFileHandle> Handle(FPlatformFileManager::Get().GetPlatformFile().OpenRead(*Filename));
+	if (Handle.IsValid() == false)
+	{
+		return false;
+	}
+
+	const int64 Size = Handle->Size();
+
+	TArray<uint8> Header;
+	Header.SetNumUninitialized(FileHeaderSize);
+	if (Size < FileHeaderSize || Handle->Read(Header.GetData(), FileHeaderSize) == false || Header != MakeFileHeader(WireFormat))
+	{
+		return false;
+	}
+
+	uint64 LastId = 0;
+	TArray<uint8> RecordHeader;
+	RecordHeader.SetNumUninitialized(MessageHeaderSize);
+
+	for (int64 Offset = FileHeaderSize; Offset + AcknowledgeSize <= Size;)
+	{
+		const int64 HeaderSize = FMath::Min(MessageHeaderSize, Size - Offset);
+		if (Handle->Seek(Offset) == false || Handle->Read(RecordHeader.GetData(), HeaderSize) == false)
+		{
+			break;
+		}
+
+		FMemoryReader Reader(RecordHeader);
+		uint8 Type = 0;
+		uint64 Id = 0;
+		Reader << Type << Id;
+
+		if (Type == static_cast<uint8>(ERecordType::Acknowledge))
+		{
+			OutAckedId = FMath::Max(OutAckedId, Id);
+			Offset += AcknowledgeSize;
+			continue;
+		}
+
+		if (Type != static_cast<uint8>(ERecordType::Message) || HeaderSize < MessageHeaderSize)
+		{
+			break;
+		}
+
+		FRecord Record;
+		Record.Id = Id;
+		Reader << Record.Size << Record.Crc;
+		Record.Offset = Offset + MessageHeaderSize;
+
+		// torn tail of the file
+		if (Record.Offset + Record.Size > Size)
+		{
+			break;
+		}
+
+		// ids only grow, anything else is garbage
+		if (Id > LastId)
+		{
+			OutRecords.Add(Record);
+			LastId = Id;
+		}
+		Offset = Record.Offset + Record.Size;
+	}
+
+	return true;
+}
+
+bool FHubOutboundJournal::Compact()
+{
+	using namespace HubOutboundJournal;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString TempFilename = Filename + TempSuffix;
+	const FString CompactedFilename = Filename + CompactedSuffix;
+
+	// rewrite reads the file through other handle
+	Flush();
+
+	// old file, handles and records are untouched until new file is complete
+	TArray<FRecord> Compacted;
+	if (WriteCompacted(TempFilename, Compacted) == false)
+	{
+		PlatformFile.DeleteFile(*TempFilename);
+		return false;
+	}
+
+	// rename marks new file as complete, from here crash is finished by RecoverCompacted
+	if (PlatformFile.MoveFile(*CompactedFilename, *TempFilename) == false)
+	{
+		PlatformFile.DeleteFile(*TempFilename);
+		return false;
+	}
+
+	// open file can't be replaced on some platforms
+	WriteHandle.Reset();
+	ReadHandle.Reset();
+
+	if (PlatformFile.FileExists(*Filename) && PlatformFile.DeleteFile(*Filename) == false)
+	{
+		// old file is still in place and records point into it
+		PlatformFile.DeleteFile(*CompactedFilename);
+		if (OpenHandles() == false)
+		{
+			Close();
+		}
+		return false;
+	}
+
+	if (PlatformFile.MoveFile(*Filename, *CompactedFilename) == false)
+	{
+		// records are safe in compacted file, next Open takes it
+		ERROR("Failed to replace outbound journal {0}, it is closed until next start", Filename);
+		Close();
+		return false;
+	}
+
+	Pending = MoveTemp(Compacted);
+	PendingHead = 0;
+	AcknowledgedBytes = 0;
+
+	if (OpenHandles() == false)
+	{
+		Close();
+		return false;
+	}
+	return true;
+}
+
+bool FHubOutboundJournal::WriteCompacted(const FString& TargetFilename, TArray<FRecord>& OutRecords) const
+{
+	using namespace HubOutboundJournal;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	// write handle may be open, reading is shared with it
+	const TUniquePtr<IFileHandle> Source(PlatformFile.OpenRead(*Filename, true));
+	const TUniquePtr<IFileHandle> Target(PlatformFile.OpenWrite(*TargetFilename));
+	if ((Source.IsValid() == false && Num() > 0) || Target.IsValid() == false)
+	{
+		return false;
+	}
+
+	TArray<uint8> Header = MakeFileHeader(WireFormat);
+	if (Target->Write(Header.GetData(), Header.Num()) == false)
+	{
+		return false;
+	}
+	int64 Offset = Header.Num();
+
+	if (LastAckedId > 0)
+	{
+		const TArray<uint8> Ack = MakeAcknowledge(LastAckedId);
+		if (Target->Write(Ack.GetData(), Ack.Num()) == false)
+		{
+			return false;
+		}
+		Offset += Ack.Num();
+	}
+
+	TArray<uint8> Message;
+	for (int32 Index = PendingHead; Index < Pending.Num(); ++Index)
+	{
+		// record which can't be copied is not skipped, whole rewrite is abandoned
+		FRecord Record = Pending[Index];
+		Message.SetNumUninitialized(Record.Size);
+		if (Source->Seek(Record.Offset) == false || Source->Read(Message.GetData(), Record.Size) == false)
+		{
+			return false;
+		}
+
+		Header = MakeMessageHeader(Record.Id, Record.Size, Record.Crc);
+		if (Target->Write(Header.GetData(), Header.Num()) == false || Target->Write(Message.GetData(), Message.Num()) == false)
+		{
+			return false;
+		}
+
+		Record.Offset = Offset + Header.Num();
+		Offset = Record.Offset + Record.Size;
+		OutRecords.Add(Record);
+	}
+
+	return Target->Flush();
+}
+
+bool FHubOutboundJournal::RecoverCompacted() const
+{
+	using namespace HubOutboundJournal;
+
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+	const FString TempFilename = Filename + TempSuffix;
+	const FString CompactedFilename = Filename + CompactedSuffix;
+
+	// temp file may be written partially
+	PlatformFile.DeleteFile(*TempFilename);
+
+	// compacted file is complete, it has every record old file has not acknowledged
+	if (PlatformFile.FileExists(*CompactedFilename))
+	{
+		WARNING("Outbound journal {0} was being rewritten, rewrite is finished", Filename);
+
+		if (PlatformFile.FileExists(*Filename) && PlatformFile.DeleteFile(*Filename) == false)
+		{
+			return false;
+		}
+		return PlatformFile.MoveFile(*Filename, *CompactedFilename);
+	}
+	return true;
+}
+
+bool FHubOutboundJournal::OpenHandles()
+{
+	IPlatformFile& PlatformFile = FPlatformFileManager::Get().GetPlatformFile();
+
+	WriteHandle.Reset(PlatformFile.OpenWrite(*Filename, true, true));
+	ReadHandle.Reset(PlatformFile.OpenRead(*Filename, true));
+	if (WriteHandle.IsValid() == false || ReadHandle.IsValid() == false)
+	{
+		WriteHandle.Reset();
+		ReadHandle.Reset();
+		return false;
+	}
+
+	FileSize = WriteHandle->Size();
+	return true;
+}
+
+bool FHubOutboundJournal::Append(const TArray<uint8>& Message)
+{
+	if (IsOpen() == false || (MaxBytes > 0 && PendingBytes + Message.Num() > MaxBytes))
+	{
+		return false;
+	}
+
+	FRecord Record;
+	Record.Id = NextId++;
+	Record.Size = Message.Num();
+	Record.Crc = FCrc::MemCrc32(Message.GetData(), Message.Num());
+
+	const TArray<uint8> Header = HubOutboundJournal::MakeMessageHeader(Record.Id, Record.Size, Record.Crc);
+	if (WriteHandle->Write(Header.GetData(), Header.Num()) == false || WriteHandle->Write(Message.GetData(), Message.Num()) == false)
+	{
+		return false;
+	}
+
+	bFlushPending = true;
+
+	Record.Offset = FileSize + Header.Num();
+	FileSize = Record.Offset + Record.Size;
+
+	Pending.Add(Record);
+	PendingBytes += Record.Size;
+	return true;
+}
+
+EHubJournalReadResult FHubOutboundJournal::Read(const int32 Index, TArray<uint8>& OutMessage)
+{
+	if (ReadHandle.IsValid() == false || Index >= Num())
+	{
+		return EHubJournalReadResult::Failed;
+	}
+
+	// records appended during this tick must be visible to read handle
+	Flush();
+
+	const FRecord& Record = Pending[PendingHead + Index];
+	OutMessage.SetNumUninitialized(Record.Size);
+
+	if (ReadHandle->Seek(Record.Offset) == false || ReadHandle->Read(OutMessage.GetData(), Record.Size) == false)
+	{
+		return EHubJournalReadResult::Failed;
+	}
+	return FCrc::MemCrc32(OutMessage.GetData(), OutMessage.Num()) == Record.Crc ? EHubJournalReadResult::Success : EHubJournalReadResult::Damaged;
+}
+
+int32 FHubOutboundJournal::Acknowledge(const uint64 UpToId)
+{
+	int32 Count = 0;
+	while (Count < Num() && Pending[PendingHead + Count].Id <= UpToId)
+	{
+		++Count;
+	}
+	if (Count == 0)
+	{
+		return 0;
+	}
+
+	for (int32 Index = PendingHead; Index < PendingHead + Count; ++Index)
+	{
+		PendingBytes -= Pending[Index].Size;
+		AcknowledgedBytes += HubOutboundJournal::MessageHeaderSize + Pending[Index].Size;
+	}
+	PendingHead += Count;
+
+	LastAckedId = Pending[PendingHead - 1].Id;
+	WriteAck(LastAckedId);
+
+	// drained journal is not rewritten every time, acknowledge records are small
+	if (AcknowledgedBytes >= HubOutboundJournal::MinCompactBytes && AcknowledgedBytes * 2 >= FileSize)
+	{
+		if (Compact() == false)
+		{
+			ERROR("Failed to compact outbound journal {0}", Filename);
+		}
+	}
+	return Count;
+}
+
+bool FHubOutboundJournal::WriteAck(const uint64 AckedId)
+{
+	const TArray<uint8> Record = HubOutboundJournal::MakeAcknowledge(AckedId);
+
+	if (WriteHandle.IsValid() == false || WriteHandle->Write(Record.GetData(), Record.Num()) == false)
+	{
+		return false;
+	}
+
+	bFlushPending = true;
+	FileSize += Record.Num();
+	return true;
+}
+
+void FHubOutboundJournal::Flush()
+{
+	if (bFlushPending == false || WriteHandle.IsValid() == false)
+	{
+		return;
+	}
+
+	bFlushPending = false;
+	if (WriteHandle->Flush() == false)
+	{
+		ERROR("Failed to flush outbound journal {0}", Filename);
+	}
+}
@@ -0,0 +1,130 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubStructCodec.h"
+#include "SocketSettings.h"
+#include "HubOutboundJournal.generated.h"
+
+class IFileHandle;
+
+// Pushed by hub when it stored replayed journal messages, every record up to Jid is acknowledged
+USTRUCT()
+struct FHubJournalAckData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	int64 Jid = 0;
+};
+
+template <>
+struct THubStructCodec<FHubJournalAckData>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FHubJournalAckData& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("jid")))
+			{
+				return Field.Read(Out.Jid);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FHubJournalAckData& In)
+	{
+		Writer.WriteValue(TEXT("jid"), In.Jid);
+	}
+};
+
+enum class EHubJournalReadResult : uint8
+{
+	Success,
+	// Record does not match its checksum, it will never be readable
+	Damaged,
+	// File can't be read now, record is kept
+	Failed,
+};
+
+/**
+ * Append-only file of outbound messages which did not fit into in-memory queue, survives process restart
+ * Messages are replayed in append order after authorization and acknowledged only when hub confirms them (FHubJournalAckData),
+ * messages lost with connection or process are replayed again (at-least-once)
+ * Records have growing ids which are never reused by the file, even after rewrite, replayed message carries its id as "jid"
+ * so hub can drop a message it already has; acknowledge is written as id of the last confirmed record
+ * File is rewritten without acknowledged records when it is opened and when at least MinCompactBytes and half of it are acknowledged,
+ * new file replaces old one only when it is complete, interrupted rewrite is finished or dropped on next Open
+ * Requests with id are never journaled, answer to them would reach unrelated request of the next run
+ * Writes are flushed once per tick, crash of the process loses messages spilled during the last frame
+ */
+class BFHUBSOCKETS_API FHubOutboundJournal
+{
+public:
+	~FHubOutboundJournal();
+
+	/** Loads records left by previous run, records of other wire format are dropped
+	 * False when file is locked by other journal, of this or other process */
+	bool Open(const FString& InFilename, EHubWireFormat InWireFormat, int64 InMaxBytes);
+	void Close();
+	bool IsOpen() const { return WriteHandle.IsValid(); }
+
+	// False when journal is full or file can't be written; written to disk by next Flush
+	bool Append(const TArray<uint8>& Message);
+	// Called once per tick, so bursts of spilled messages cost one flush
+	void Flush();
+
+	// Index counts from the oldest not acknowledged message
+	EHubJournalReadResult Read(int32 Index, TArray<uint8>& OutMessage);
+	uint64 GetId(int32 Index) const { return Pending[PendingHead + Index].Id; }
+	// Removes messages up to the id confirmed by hub, damaged ones in front of it too; returns number of removed messages
+	int32 Acknowledge(uint64 UpToId);
+
+	bool IsEmpty() const { return Num() == 0; }
+	int32 Num() const { return Pending.Num() - PendingHead; }
+	int64 GetPendingBytes() const { return PendingBytes; }
+
+private:
+	struct FRecord
+	{
+		uint64 Id = 0;
+		// offset of message bytes in file
+		int64 Offset = 0;
+		uint32 Size = 0;
+		uint32 Crc = 0;
+	};
+
+	bool Scan(TArray<FRecord>& OutRecords, uint64& OutAckedId) const;
+	// Rewrites file with pending records only, state is kept when it fails before old file is replaced
+	bool Compact();
+	bool WriteCompacted(const FString& TargetFilename, TArray<FRecord>& OutRecords) const;
+	// Finishes or drops rewrite interrupted by crash
+	bool RecoverCompacted() const;
+	bool OpenHandles();
+	bool WriteAck(uint64 AckedId);
+
+	FString Filename;
+	EHubWireFormat WireFormat = EHubWireFormat::Json;
+	int64 MaxBytes = 0;
+
+	TUniquePtr<IFileHandle> WriteHandle;
+	TUniquePtr<IFileHandle> ReadHandle;
+	// keeps other socket systems and processes away from the file
+	TUniquePtr<IFileHandle> LockHandle;
+	int64 FileSize = 0;
+	// records written since last flush
+	bool bFlushPending = false;
+
+	// acknowledged records before head are removed lazily
+	TArray<FRecord> Pending;
+	int32 PendingHead = 0;
+	int64 PendingBytes = 0;
+	int64 AcknowledgedBytes = 0;
+	uint64 NextId = 1;
+	// written at the start of rewritten file, so ids keep growing when every record is acknowledged
+	uint64 LastAckedId = 0;
+};
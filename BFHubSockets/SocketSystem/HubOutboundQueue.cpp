@@ -0,0 +1,216 @@
+﻿#include "HubOutboundQueue.h"
+
+#include "Algo/BinarySearch.h"
+
+FHubOutboundQueue::FEntry* FHubOutboundQueue::FLane::Find(const uint64 Sequence)
+{
+	// entries appended with growing sequence, so lane is sorted
+	const TArrayView<FEntry> Pending = MakeArrayView(Entries).RightChop(Head);
+	const int32 Index = Algo::BinarySearchBy(Pending, Sequence, &FEntry::Sequence);
+	return Index != INDEX_NONE ? &Pending[Index] : nullptr;
+}
+
+int32 FHubOutboundQueue::GetLaneIndex(const bool bRequiredAuth, const EHubOutboundPriority Priority)
+{
+	return static_cast<int32>(Priority) * 2 + (bRequiredAuth ? 1 : 0);
+}
+
+EHubQueuePushResult FHubOutboundQueue::Push(const FHubServiceAction& Key, const int32 ActionId, const FHubActionPolicy& Policy, TArray<uint8>&& Message, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	const int32 LaneIndex = GetLaneIndex(Key.RequiredAuth, Policy.Priority);
+
+	TOptional<FCollapseKey> CollapseKey;
+	if (Policy.DropPolicy == EHubDropPolicy::CollapseLatest && ActionId != INDEX_NONE && CoalescingKey.IsSet())
+	{
+		CollapseKey = FCollapseKey{ActionId, CoalescingKey.GetValue()};
+	}
+
+	if (CollapseKey.IsSet())
+	{
+		if (const FCollapsedEntry* Collapsed = CollapsedActions.Find(CollapseKey.GetValue()))
+		{
+			FLane& Lane = Lanes[Collapsed->LaneIndex];
+			if (FEntry* Entry = Lane.Find(Collapsed->Sequence))
+			{
+				// queue can grow over the cap by difference of two messages of one action, it is not worth dropping others
+				const int64 SizeDelta = Message.Num() - Entry->Message.Message.Num();
+				Lane.Bytes += SizeDelta;
+				Bytes += SizeDelta;
+				if (Entry->Message.RequestId != 0)
+				{
+					DroppedRequests.Add(Entry->Message.RequestId);
+				}
+				// entry keeps its place in order, but dwell is measured for the data it carries now
+				Entry->Message.Key = Key;
+				Entry->Message.Message = MoveTemp(Message);
+				Entry->Message.EnqueueTime = FPlatformTime::Seconds();
+				Entry->Message.RequestId = RequestId;
+				++CollapsedCount;
+				return EHubQueuePushResult::Collapsed;
+			}
+		}
+	}
+
+	if (MaxBytes > 0 && Bytes + Message.Num() > MaxBytes)
+	{
+		if (Policy.DropPolicy == EHubDropPolicy::Reject || MakeRoom(Message.Num(), Policy.Priority) == false)
+		{
+			++RejectedCount;
+			return EHubQueuePushResult::Rejected;
+		}
+	}
+
+	FLane& Lane = Lanes[LaneIndex];
+	FEntry& Entry = Lane.Entries.AddDefaulted_GetRef();
+	Entry.Sequence = NextSequence++;
+	Entry.CollapseKey = CollapseKey;
+	Entry.Message.Key = Key;
+	Entry.Message.Message = MoveTemp(Message);
+	Entry.Message.ActionId = ActionId;
+	Entry.Message.EnqueueTime = FPlatformTime::Seconds();
+	Entry.Message.RequestId = RequestId;
+
+	Lane.Bytes += Entry.Message.Message.Num();
+	Bytes += Entry.Message.Message.Num();
+	++NumMessages;
+
+	if (CollapseKey.IsSet())
+	{
+		CollapsedActions.Add(CollapseKey.GetValue(), FCollapsedEntry{LaneIndex, Entry.Sequence});
+	}
+
+	return EHubQueuePushResult::Queued;
+}
+
+bool FHubOutboundQueue::MakeRoom(const int64 Size, const EHubOutboundPriority Priority)
+{
+	const int32 FirstLane = GetLaneIndex(false, Priority);
+
+	// check first, nothing dropped if message doesn't fit anyway
+	int64 DroppableBytes = 0;
+	for (int32 LaneIndex = FirstLane; LaneIndex < NumLanes; ++LaneIndex)
+	{
+		DroppableBytes += Lanes[LaneIndex].Bytes;
+	}
+	if (Bytes - DroppableBytes + Size > MaxBytes)
+	{
+		return false;
+	}
+
+	// lowest priority first, the older of auth and non auth lanes within priority
+	for (int32 Pair = NumLanes - 2; Pair >= FirstLane && Bytes + Size > MaxBytes; Pair -= 2)
+	{
+		while (Bytes + Size > MaxBytes && (Lanes[Pair].IsEmpty() == false || Lanes[Pair + 1].IsEmpty() == false))
+		{
+			const bool bAuthLane = Lanes[Pair].IsEmpty() || (Lanes[Pair + 1].IsEmpty() == false && Lanes[Pair + 1].Front().Sequence < Lanes[Pair].Front().Sequence);
+			const FEntry Dropped = PopFront(Pair + (bAuthLane ? 1 : 0));
+			if (Dropped.Message.RequestId != 0)
+			{
+				DroppedRequests.Add(Dropped.Message.RequestId);
+			}
+			++DroppedCount;
+		}
+	}
+
+	return true;
+}
+
+bool FHubOutboundQueue::Pop(const bool bAuthorized, FHubQueuedMessage& OutMessage, const EHubOutboundPriority Until)
+{
+	const int32 EndPair = FMath::Min(GetLaneIndex(false, Until), NumLanes);
+	for (int32 Pair = 0; Pair < EndPair; Pair += 2)
+	{
+		const FLane& NonAuthLane = Lanes[Pair];
+		const FLane& AuthLane = Lanes[Pair + 1];
+		const bool bAuthReady = bAuthorized && AuthLane.IsEmpty() == false;
+
+		if (NonAuthLane.IsEmpty() && bAuthReady == false)
+		{
+			continue;
+		}
+
+		const bool bAuthLane = bAuthReady && (NonAuthLane.IsEmpty() || AuthLane.Front().Sequence < NonAuthLane.Front().Sequence);
+		OutMessage = MoveTemp(PopFront(Pair + (bAuthLane ? 1 : 0)).Message);
+		return true;
+	}
+
+	return false;
+}
+
+bool FHubOutboundQueue::PopOverflow(FHubQueuedMessage& OutMessage, EHubOutboundPriority& OutPriority)
+{
+	for (int32 Pair = NumLanes - 2; Pair >= 0; Pair -= 2)
+	{
+		const FLane& AuthLane = Lanes[Pair + 1];
+		if (AuthLane.IsEmpty() || AuthLane.Front().Message.RequestId != 0)
+		{
+			continue;
+		}
+
+		OutPriority = static_cast<EHubOutboundPriority>(Pair / 2);
+		OutMessage = MoveTemp(PopFront(Pair + 1).Message);
+		return true;
+	}
+	return false;
+}
+
+FHubOutboundQueue::FEntry FHubOutboundQueue::PopFront(const int32 LaneIndex)
+{
+	FLane& Lane = Lanes[LaneIndex];
+	FEntry Entry = MoveTemp(Lane.Entries[Lane.Head++]);
+
+	Lane.Bytes -= Entry.Message.Message.Num();
+	Bytes -= Entry.Message.Message.Num();
+	--NumMessages;
+
+	if (Entry.CollapseKey.IsSet())
+	{
+		const FCollapsedEntry* Collapsed = CollapsedActions.Find(Entry.CollapseKey.GetValue());
+		if (Collapsed && Collapsed->Sequence == Entry.Sequence)
+		{
+			CollapsedActions.Remove(Entry.CollapseKey.GetValue());
+		}
+	}
+
+	if (Lane.IsEmpty())
+	{
+		Lane.Entries.Reset();
+		Lane.Head = 0;
+	}
+	else if (Lane.Head > 64 && Lane.Head * 2 > Lane.Entries.Num())
+	{
+		Lane.Entries.RemoveAt(0, Lane.Head);
+		Lane.Head = 0;
+	}
+
+	return Entry;
+}
+
+bool FHubOutboundQueue::HasPending(const bool bRequiredAuth, const EHubOutboundPriority Priority) const
+{
+	return Lanes[GetLaneIndex(bRequiredAuth, Priority)].IsEmpty() == false;
+}
+
+bool FHubOutboundQueue::HasSendable(const bool bAuthorized) const
+{
+	for (int32 LaneIndex = 0; LaneIndex < NumLanes; ++LaneIndex)
+	{
+		const bool bAuthLane = LaneIndex % 2 == 1;
+		if (Lanes[LaneIndex].IsEmpty() == false && (bAuthorized || bAuthLane == false))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void FHubOutboundQueue::Reset()
+{
+	for (FLane& Lane : Lanes)
+	{
+		Lane = FLane();
+	}
+	CollapsedActions.Reset();
+	Bytes = 0;
+	NumMessages = 0;
+}
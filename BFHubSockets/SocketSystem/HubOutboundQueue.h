@@ -0,0 +1,125 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubActionPolicy.h"
+#include "HubServicesBaseData.h"
+
+enum class EHubQueuePushResult : uint8
+{
+	Queued,
+	// Replaced queued message of the same action, see EHubDropPolicy::CollapseLatest
+	Collapsed,
+	// Queue is full and nothing can be dropped for the message
+	Rejected,
+};
+
+struct FHubQueuedMessage
+{
+	FHubServiceAction Key;
+	TArray<uint8> Message;
+	int32 ActionId = INDEX_NONE;
+	// for queue dwell metric
+	double EnqueueTime = 0.0;
+	// id of request waiting for response, see FHubPendingRequests; 0 - not a request
+	int64 RequestId = 0;
+};
+
+/**
+ * Messages waiting for connection or authorization, bounded by size in bytes
+ * Every priority class keeps own order, Pop returns the most important message first
+ * Messages which require authorization are not returned until connection is authorized
+ */
+class BFHUBSOCKETS_API FHubOutboundQueue
+{
+public:
+	// 0 - not limited
+	void SetMaxBytes(int64 InMaxBytes) { MaxBytes = InMaxBytes; }
+
+	/** Message replaces queued message with the same action and CoalescingKey (sub key)
+	 * CoalescingKey is unset for messages which must not be replaced (requests waiting for response) */
+	EHubQueuePushResult Push(const FHubServiceAction& Key, int32 ActionId, const FHubActionPolicy& Policy, TArray<uint8>&& Message, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId = 0);
+
+	// Only classes more important than Until are popped
+	bool Pop(bool bAuthorized, FHubQueuedMessage& OutMessage, EHubOutboundPriority Until = EHubOutboundPriority::Num);
+
+	/** Oldest message of the least important class which requires authorization, to be moved to the journal
+	 * Requests are never taken, their ids are valid only in this run */
+	bool PopOverflow(FHubQueuedMessage& OutMessage, EHubOutboundPriority& OutPriority);
+
+	// New message of this class must go behind queued ones to keep order
+	bool HasPending(bool bRequiredAuth, EHubOutboundPriority Priority) const;
+	bool HasSendable(bool bAuthorized) const;
+
+	void Reset();
+
+	// Requests dropped by Push to make room or replaced by newer message since last call, owner completes them as failed
+	TArray<int64> TakeDroppedRequests() { return MoveTemp(DroppedRequests); }
+
+	bool IsEmpty() const { return NumMessages == 0; }
+	int32 Num() const { return NumMessages; }
+	int64 GetBytes() const { return Bytes; }
+	float GetFillRatio() const { return MaxBytes > 0 ? static_cast<float>(static_cast<double>(Bytes) / MaxBytes) : 0.0f; }
+
+	int32 GetDroppedCount() const { return DroppedCount; }
+	int32 GetCollapsedCount() const { return CollapsedCount; }
+	int32 GetRejectedCount() const { return RejectedCount; }
+
+private:
+	struct FCollapseKey
+	{
+		int32 ActionId = INDEX_NONE;
+		FHubCoalescingKey SubKey;
+
+		bool operator==(const FCollapseKey& Other) const { return ActionId == Other.ActionId && SubKey == Other.SubKey; }
+		friend uint32 GetTypeHash(const FCollapseKey& Key) { return HashCombineFast(GetTypeHash(Key.ActionId), GetTypeHash(Key.SubKey)); }
+	};
+
+	struct FEntry
+	{
+		uint64 Sequence = 0;
+		TOptional<FCollapseKey> CollapseKey;
+		FHubQueuedMessage Message;
+	};
+
+	// FIFO of one priority class, popped entries compacted lazily
+	struct FLane
+	{
+		TArray<FEntry> Entries;
+		int32 Head = 0;
+		int64 Bytes = 0;
+
+		bool IsEmpty() const { return Head == Entries.Num(); }
+		const FEntry& Front() const { return Entries[Head]; }
+		FEntry* Find(uint64 Sequence);
+	};
+
+	struct FCollapsedEntry
+	{
+		int32 LaneIndex = 0;
+		uint64 Sequence = 0;
+	};
+
+	static int32 GetLaneIndex(bool bRequiredAuth, EHubOutboundPriority Priority);
+
+	// Frees space for new message by dropping oldest messages of the same or lower priority, false if not enough can be freed
+	bool MakeRoom(int64 Size, EHubOutboundPriority Priority);
+	FEntry PopFront(int32 LaneIndex);
+
+	// non auth and auth lane for every priority
+	static constexpr int32 NumLanes = 2 * static_cast<int32>(EHubOutboundPriority::Num);
+	FLane Lanes[NumLanes];
+
+	// latest queued message of every action and sub key with CollapseLatest policy
+	TMap<FCollapseKey, FCollapsedEntry> CollapsedActions;
+
+	TArray<int64> DroppedRequests;
+
+	uint64 NextSequence = 0;
+	int64 MaxBytes = 0;
+	int64 Bytes = 0;
+	int32 NumMessages = 0;
+
+	int32 DroppedCount = 0;
+	int32 CollapsedCount = 0;
+	int32 RejectedCount = 0;
+};
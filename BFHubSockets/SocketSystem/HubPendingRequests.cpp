@@ -0,0 +1,46 @@
+﻿#include "HubPendingRequests.h"
+
+#include "HubSocketTrace.h"
+
+int64 FHubPendingRequests::Add(const float TimeoutSeconds, FCompletion&& Completion)
+{
+	const int64 RequestId = ++LastRequestId;
+
+	FRequest& Request = Requests.Add(RequestId);
+	Request.Completion = MoveTemp(Completion);
+	Request.TimeoutTimer = Timers.ScheduleIn(TimeoutSeconds, [this, RequestId]()
+	{
+		Complete(RequestId, EHubRequestStatus::Timeout, nullptr);
+	});
+
+	return RequestId;
+}
+
+bool FHubPendingRequests::Complete(const int64 RequestId, const EHubRequestStatus Status, const FHubMessagePayload* Payload)
+{
+	FRequest Request;
+	if (Requests.RemoveAndCopyValue(RequestId, Request) == false)
+	{
+		return false;
+	}
+	Timers.Cancel(Request.TimeoutTimer);
+
+	const FString TraceScopeName = HubSocketTrace::GetRequestScopeName(RequestId, TEXT("completed"));
+	BFHUB_TRACE_SCOPE_TEXT(*TraceScopeName);
+	HubSocketTrace::RequestCompleted(RequestId, static_cast<uint8>(Status));
+
+	// removed before the call, completion may start next request
+	Request.Completion(Status, Payload);
+	return true;
+}
+
+void FHubPendingRequests::CancelAll()
+{
+	TArray<int64> RequestIds;
+	Requests.GetKeys(RequestIds);
+
+	for (const int64 RequestId : RequestIds)
+	{
+		Complete(RequestId, EHubRequestStatus::Cancelled, nullptr);
+	}
+}
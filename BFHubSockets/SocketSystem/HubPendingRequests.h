@@ -0,0 +1,70 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubServicesBaseData.h"
+#include "HubTimerWheel.h"
+#include "HubPendingRequests.generated.h"
+
+struct FHubMessagePayload;
+
+UENUM(BlueprintType)
+enum class EHubRequestStatus : uint8
+{
+	// Response received and decoded
+	Success,
+	// Hub answered with error or response data can't be decoded, see Error
+	Error,
+	// No answer during request timeout
+	Timeout,
+	// Request can't be serialized or outbound queue is full
+	SendFailed,
+	// Socket system shut down before answer
+	Cancelled,
+};
+
+template <typename TResponse>
+struct THubRequestResult
+{
+	EHubRequestStatus Status = EHubRequestStatus::Cancelled;
+	TResponse Data;
+	FHubErrorData Error;
+
+	bool IsSuccess() const { return Status == EHubRequestStatus::Success; }
+};
+
+/**
+ * Requests waiting for response with the same request id
+ * Every request is completed exactly once: by response, error, timeout or cancel
+ * Timeouts are timers of socket system timer wheel, cancelled when request is completed otherwise
+ */
+class BFHUBSOCKETS_API FHubPendingRequests
+{
+public:
+	explicit FHubPendingRequests(FHubTimerWheel& InTimers) : Timers(InTimers) {}
+
+	// Payload is null for timeout, send failure and cancel
+	using FCompletion = TUniqueFunction<void(EHubRequestStatus Status, const FHubMessagePayload* Payload)>;
+
+	// Returns id to be sent with request, never 0
+	int64 Add(float TimeoutSeconds, FCompletion&& Completion);
+
+	bool Contains(const int64 RequestId) const { return Requests.Contains(RequestId); }
+
+	// False if request is unknown - already completed or response is not correlated
+	bool Complete(int64 RequestId, EHubRequestStatus Status, const FHubMessagePayload* Payload);
+
+	void CancelAll();
+
+	int32 Num() const { return Requests.Num(); }
+
+private:
+	struct FRequest
+	{
+		FHubTimerHandle TimeoutTimer;
+		FCompletion Completion;
+	};
+
+	FHubTimerWheel& Timers;
+	TMap<int64, FRequest> Requests;
+	int64 LastRequestId = 0;
+};
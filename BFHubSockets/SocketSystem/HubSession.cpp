@@ -0,0 +1,102 @@
+﻿#include "HubSession.h"
+
+#include "HubBufferPool.h"
+#include "HubWireSerializer.h"
+
+FHubSession::~FHubSession()
+{
+	Reset();
+}
+
+void FHubSession::Start(const FString& InToken)
+{
+	Reset();
+	Token = InToken;
+}
+
+void FHubSession::Reset()
+{
+	FHubBufferPool::Get().Release(MakeArrayView(Messages).RightChop(Head));
+	Messages.Reset();
+
+	Token.Reset();
+	NextSeq = 1;
+	LastInboundSeq = 0;
+	Head = 0;
+	FirstSeq = 1;
+	Bytes = 0;
+}
+
+TConstArrayView<TArray<uint8>> FHubSession::Stamp(const TConstArrayView<TArray<uint8>> InMessages, const IHubWireSerializer& Serializer)
+{
+	// acknowledged slots are removed once they are half of array, views handed out before are not valid anymore
+	if (Head > 0 && Head * 2 >= Messages.Num())
+	{
+		Messages.RemoveAt(0, Head);
+		Head = 0;
+	}
+
+	const int32 First = Messages.Num();
+	for (const TArray<uint8>& Message : InMessages)
+	{
+		TArray<uint8>& Stamped = Messages.Add_GetRef(FHubBufferPool::Get().Acquire());
+		if (ensureMsgf(Serializer.StampSequence(Message, NextSeq, LastInboundSeq, Stamped), TEXT("Hub message can't be numbered")) == false)
+		{
+			Stamped = Message;
+		}
+		Bytes += Stamped.Num();
+		++NextSeq;
+	}
+
+	// new messages are kept even when they alone are bigger than the limit, they are being sent now
+	while (MaxBytes > 0 && Bytes > MaxBytes && Head < First)
+	{
+		DropOldest();
+	}
+
+	return MakeArrayView(Messages).RightChop(First);
+}
+
+void FHubSession::Acknowledge(const int64 Seq)
+{
+	while (Head < Messages.Num() && FirstSeq <= Seq)
+	{
+		DropOldest();
+	}
+}
+
+bool FHubSession::Resume(const int64 AckSeq, TConstArrayView<TArray<uint8>>& OutReplay)
+{
+	// messages between them were dropped by size limit before hub got them
+	if (AckSeq + 1 < FirstSeq)
+	{
+		return false;
+	}
+
+	Acknowledge(AckSeq);
+	OutReplay = MakeArrayView(Messages).RightChop(Head);
+	return true;
+}
+
+bool FHubSession::AcceptInbound(const int64 Seq)
+{
+	if (Seq == 0)
+	{
+		return true;
+	}
+	if (Seq <= LastInboundSeq)
+	{
+		return false;
+	}
+
+	LastInboundSeq = Seq;
+	return true;
+}
+
+void FHubSession::DropOldest()
+{
+	Bytes -= Messages[Head].Num();
+	FHubBufferPool::Get().Release(MoveTemp(Messages[Head]));
+	++Head;
+	++FirstSeq;
+}
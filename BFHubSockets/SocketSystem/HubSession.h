@@ -0,0 +1,217 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubStructCodec.h"
+#include "HubSession.generated.h"
+
+class IHubWireSerializer;
+
+// Pushed by hub after authorization when session can be resumed
+USTRUCT()
+struct FHubSessionData
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Token;
+};
+
+USTRUCT()
+struct FHubSessionResumeRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Token;
+
+	// Last hub message client received, hub replays newer ones
+	UPROPERTY()
+	int64 Seq = 0;
+};
+
+USTRUCT()
+struct FHubSessionResumeResponse
+{
+	GENERATED_BODY()
+
+	// Last client message hub received, client replays newer ones
+	UPROPERTY()
+	int64 Ack = 0;
+};
+
+// Sent on bulk lane after it is established, hub attaches the lane connection to authorized session of control connection
+USTRUCT()
+struct FHubLaneAttachRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY()
+	FString Token;
+
+	UPROPERTY()
+	int32 Lane = 0;
+};
+
+template <>
+struct THubStructCodec<FHubSessionData>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FHubSessionData& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("token")))
+			{
+				return Field.Read(Out.Token);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FHubSessionData& In)
+	{
+		Writer.WriteValue(TEXT("token"), In.Token);
+	}
+};
+
+template <>
+struct THubStructCodec<FHubSessionResumeRequest>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FHubSessionResumeRequest& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("token")))
+			{
+				return Field.Read(Out.Token);
+			}
+			if (Field.IsField(TEXT("seq")))
+			{
+				return Field.Read(Out.Seq);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FHubSessionResumeRequest& In)
+	{
+		Writer.WriteValue(TEXT("token"), In.Token);
+		Writer.WriteValue(TEXT("seq"), In.Seq);
+	}
+};
+
+template <>
+struct THubStructCodec<FHubSessionResumeResponse>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FHubSessionResumeResponse& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("ack")))
+			{
+				return Field.Read(Out.Ack);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FHubSessionResumeResponse& In)
+	{
+		Writer.WriteValue(TEXT("ack"), In.Ack);
+	}
+};
+
+template <>
+struct THubStructCodec<FHubLaneAttachRequest>
+{
+	static constexpr bool bEnabled = true;
+
+	template <typename ReaderType>
+	static bool Read(ReaderType& Reader, FHubLaneAttachRequest& Out)
+	{
+		return Reader.ReadObject([&Out](ReaderType& Field)
+		{
+			if (Field.IsField(TEXT("token")))
+			{
+				return Field.Read(Out.Token);
+			}
+			if (Field.IsField(TEXT("lane")))
+			{
+				return Field.Read(Out.Lane);
+			}
+			return Field.Skip();
+		});
+	}
+
+	template <typename WriterType>
+	static void Write(WriterType& Writer, const FHubLaneAttachRequest& In)
+	{
+		Writer.WriteValue(TEXT("token"), In.Token);
+		Writer.WriteValue(TEXT("lane"), In.Lane);
+	}
+};
+
+/**
+ * Resumable hub session: hub issues token after authorization, then messages of both sides carry sequence numbers
+ * After reconnect client sends token and last received number instead of credentials,
+ * hub answers with last client message it received, both sides replay only what the other one missed
+ * Sent messages are kept already stamped until hub acknowledges them, limited by size in bytes
+ */
+class BFHUBSOCKETS_API FHubSession
+{
+public:
+	~FHubSession();
+
+	// Previous session is forgotten
+	void Start(const FString& InToken);
+	void Reset();
+
+	bool IsActive() const { return Token.IsEmpty() == false; }
+	const FString& GetToken() const { return Token; }
+
+	// 0 - not limited
+	void SetMaxBytes(int64 InMaxBytes) { MaxBytes = InMaxBytes; }
+
+	/** Numbers messages with "seq" and acknowledges received hub messages with "ack", stamped copies are kept for replay
+	 * Returned view is valid until next Stamp, Acknowledge or Resume */
+	TConstArrayView<TArray<uint8>> Stamp(TConstArrayView<TArray<uint8>> Messages, const IHubWireSerializer& Serializer);
+
+	// Kept messages up to Seq are dropped, hub has them
+	void Acknowledge(int64 Seq);
+
+	/** Messages hub did not receive before reconnect, view is valid until next Stamp, Acknowledge or Resume
+	 * False when some of them were dropped by size limit, session can't be resumed without loss then */
+	bool Resume(int64 AckSeq, TConstArrayView<TArray<uint8>>& OutReplay);
+
+	// False for hub message which was already handled (replayed twice), 0 - message is not numbered
+	bool AcceptInbound(int64 Seq);
+	int64 GetLastInboundSeq() const { return LastInboundSeq; }
+
+	int32 NumUnacknowledged() const { return Messages.Num() - Head; }
+
+private:
+	void DropOldest();
+
+	FString Token;
+
+	int64 NextSeq = 1;
+	int64 LastInboundSeq = 0;
+
+	// Sent messages from Head, FirstSeq is number of Messages[Head] (NextSeq when there is none)
+	TArray<TArray<uint8>> Messages;
+	int32 Head = 0;
+	int64 FirstSeq = 1;
+	int64 Bytes = 0;
+	int64 MaxBytes = 0;
+};
@@ -0,0 +1,299 @@
+﻿#include "CoreMinimal.h"
+#include "HAL/IConsoleManager.h"
+#include "HubSocketSystem.h"
+#include "HubStructCodec.h"
+#include "HubActionRegistry.h"
+#include "HubBufferPool.h"
+#include "HubDecodeArena.h"
+#include "HubMessageEncoder.h"
+#include "HubMessageEnvelope.h"
+#include "HubWireSerializer.h"
+#include "BFHubSockets/Services/BFHubService_Ping.h"
+#include "BFHubSockets/Services/GameServerAPI/BFHubService_ServerInit.h"
+#include "HelpersPlugin/Helpers/EnumHelpers.h"
+
+#include "Logging/StructuredLog.h"
+
+#if !UE_BUILD_SHIPPING
+
+/**
+ * Developer benchmarks of socket system hot paths, results printed to log
+ */
+namespace HubSocketBenchmarks
+{
+	int32 ParseIntArg(const TArray<FString>& Args, const TCHAR* Name, const int32 DefaultValue)
+	{
+		int32 Value = DefaultValue;
+		for (const FString& Arg : Args)
+		{
+			FParse::Value(*Arg, Name, Value);
+		}
+		return Value;
+	}
+
+	// Returns average nanoseconds per iteration
+	template <typename FunctionType>
+	double Measure(const int32 Iterations, FunctionType&& Function)
+	{
+		int32 Failures = 0;
+		const double StartTime = FPlatformTime::Seconds();
+		for (int32 Index = 0; Index < Iterations; ++Index)
+		{
+			Failures += Function() ? 0 : 1;
+		}
+		const double ElapsedTime = FPlatformTime::Seconds() - StartTime;
+
+		ensureMsgf(Failures == 0, TEXT("Benchmark iteration failed %d times"), Failures);
+		return ElapsedTime * 1e9 / FMath::Max(Iterations, 1);
+	}
+
+	template <typename TStruct>
+	void RunCodecBenchmark(const TCHAR* Name, const TStruct& Sample, const int32 Iterations)
+	{
+		FString Json;
+		HubStructCodec::WriteWithReflection(Sample, Json);
+
+		const double ReflectionRead = Measure(Iterations, [&Json]
+		{
+			TStruct Out;
+			return HubStructCodec::ReadWithReflection(Json, Out);
+		});
+		const double CodecRead = Measure(Iterations, [&Json]
+		{
+			TStruct Out;
+			return HubStructCodec::ReadWithCodec(Json, Out);
+		});
+		const double ReflectionWrite = Measure(Iterations, [&Sample]
+		{
+			FString Out;
+			return HubStructCodec::WriteWithReflection(Sample, Out);
+		});
+		const double CodecWrite = Measure(Iterations, [&Sample]
+		{
+			FString Out;
+			return HubStructCodec::WriteWithCodec(Sample, Out);
+		});
+
+		UE_LOGFMT(BFHubSocketSystem, Display, "Codec benchmark {0} ({1} iterations): read reflection {2} ns, codec {3} ns (x{4}); write reflection {5} ns, codec {6} ns (x{7})",
+			Name, Iterations,
+			ReflectionRead, CodecRead, ReflectionRead / FMath::Max(CodecRead, 1.0),
+			ReflectionWrite, CodecWrite, ReflectionWrite / FMath::Max(CodecWrite, 1.0));
+	}
+
+	void RunCodecBenchmarks(const TArray<FString>& Args)
+	{
+		const int32 Iterations = ParseIntArg(Args, TEXT("Iterations="), 100000);
+
+		RunCodecBenchmark(TEXT("Ping"), FBFHubResponseData_Ping{1234567890123, 1234567890456}, Iterations);
+		RunCodecBenchmark(TEXT("ServerInit"), FBFHubRequestData_ServerInit{TEXT("server-name-01"), TEXT("password"), TEXT("1.0.12345"), TEXT("eu-west")}, Iterations);
+	}
+
+	// Full message round trip: encode, decode envelope, read payload struct
+	template <typename TStruct>
+	void RunWireFormatBenchmark(const TCHAR* Name, const TStruct& Sample, const EHubWireFormat WireFormat, const int32 Iterations)
+	{
+		FHubServiceAction Key;
+		Key.Fill("ping", EHubControllerType::AUTH);
+		const IHubWireSerializer& Serializer = IHubWireSerializer::Get(WireFormat);
+
+		FHubEncodeOptions Options;
+		Options.WireFormat = WireFormat;
+		Options.PayloadEncoding = EHubPayloadEncoding::NestedObject;
+
+		TArray<uint8> Message;
+		FHubMessageEncoder::Encode(Key, Sample, Options, Message);
+
+		const double Write = Measure(Iterations, [&Key, &Sample, &Options]
+		{
+			TArray<uint8> Out;
+			return FHubMessageEncoder::Encode(Key, Sample, Options, Out);
+		});
+		FHubDecodeArena Arena;
+		const double Read = Measure(Iterations, [&Serializer, &Message, &Arena]
+		{
+			bool bRead = false;
+			Serializer.DecodeFrame(Message, Arena, [&bRead](const FHubMessageEnvelope& Envelope)
+			{
+				TStruct Out;
+				bRead = Envelope.Payload.ReadStruct(Out);
+			});
+			Arena.Reset();
+			return bRead;
+		});
+
+		UE_LOGFMT(BFHubSocketSystem, Display, "Wire format benchmark {0} {1} ({2} iterations): {3} bytes, write {4} ns, read {5} ns",
+			Name, EnumValueToString(WireFormat), Iterations, Message.Num(), Write, Read);
+	}
+
+	void RunWireFormatBenchmarks(const TArray<FString>& Args)
+	{
+		const int32 Iterations = ParseIntArg(Args, TEXT("Iterations="), 100000);
+
+		for (const EHubWireFormat WireFormat : {EHubWireFormat::Json, EHubWireFormat::MessagePack})
+		{
+			RunWireFormatBenchmark(TEXT("Ping"), FBFHubResponseData_Ping{1234567890123, 1234567890456}, WireFormat, Iterations);
+			RunWireFormatBenchmark(TEXT("ServerInit"), FBFHubRequestData_ServerInit{TEXT("server-name-01"), TEXT("password"), TEXT("1.0.12345"), TEXT("eu-west")}, WireFormat, Iterations);
+		}
+	}
+
+	// Json message from struct to bytes handed to socket
+	template <typename TStruct>
+	void RunOutboundBufferBenchmark(const TCHAR* Name, const TStruct& Sample, const int32 Iterations)
+	{
+		FHubServiceAction Key;
+		Key.Fill("ping", EHubControllerType::AUTH);
+		const FHubEncodeOptions Options;
+
+		const double TextPath = Measure(Iterations, [&Key, &Sample, &Options]
+		{
+			// previous path: TCHAR json string transcoded to utf-8 copy
+			FString Json;
+			if (FHubMessageEncoder::EncodeJson(Key, Sample, Options, Json) == false)
+			{
+				return false;
+			}
+			const FTCHARToUTF8 Utf8(*Json, Json.Len());
+			TArray<uint8> Out;
+			Out.Append(reinterpret_cast<const uint8*>(Utf8.Get()), Utf8.Length());
+			return true;
+		});
+		const double PooledPath = Measure(Iterations, [&Key, &Sample, &Options]
+		{
+			TArray<uint8> Out = FHubBufferPool::Get().Acquire();
+			const bool bEncoded = FHubMessageEncoder::Encode(Key, Sample, Options, Out);
+			FHubBufferPool::Get().Release(MoveTemp(Out));
+			return bEncoded;
+		});
+
+		UE_LOGFMT(BFHubSocketSystem, Display, "Outbound buffer benchmark {0} ({1} iterations): FString and transcode {2} ns, utf-8 into pooled buffer {3} ns (x{4})",
+			Name, Iterations, TextPath, PooledPath, TextPath / FMath::Max(PooledPath, 1.0));
+	}
+
+	void RunOutboundBufferBenchmarks(const TArray<FString>& Args)
+	{
+		const int32 Iterations = ParseIntArg(Args, TEXT("Iterations="), 100000);
+
+		RunOutboundBufferBenchmark(TEXT("Ping"), FBFHubResponseData_Ping{1234567890123, 1234567890456}, Iterations);
+		RunOutboundBufferBenchmark(TEXT("ServerInit"), FBFHubRequestData_ServerInit{TEXT("server-name-01"), TEXT("password"), TEXT("1.0.12345"), TEXT("eu-west")}, Iterations);
+	}
+
+	// Json frame from socket bytes to payload struct, string encoded data as hub sends it
+	template <typename TStruct>
+	void RunInboundFrameBenchmark(const TCHAR* Name, const TStruct& Sample, const int32 Iterations)
+	{
+		FHubServiceAction Key;
+		Key.Fill("ping", EHubControllerType::AUTH);
+		const FHubEncodeOptions Options;
+		const IHubWireSerializer& Serializer = IHubWireSerializer::Get(EHubWireFormat::Json);
+
+		TArray<uint8> Frame;
+		FHubMessageEncoder::Encode(Key, Sample, Options, Frame);
+
+		FHubDecodeArena Arena;
+		const double TextPath = Measure(Iterations, [&Frame, &Arena]
+		{
+			// previous path: frame converted to FString by OnMessage, then decoded as TCHAR text
+			const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Frame.GetData()), Frame.Num());
+			const FString Text(Converted.Length(), Converted.Get());
+
+			FHubMessageEnvelope Envelope;
+			TStruct Out;
+			const bool bRead = FHubMessageEnvelope::TryDecode(FStringView(Text), Arena, Envelope) && Envelope.Payload.ReadStruct(Out);
+			Arena.Reset();
+			return bRead;
+		});
+
+		const uint64 ArenaAllocations = FHubDecodeArena::GetAllocationCount();
+		const uint64 ArenaHeapBlocks = FHubDecodeArena::GetHeapBlockCount();
+		const double Utf8Path = Measure(Iterations, [&Serializer, &Frame, &Arena]
+		{
+			bool bRead = false;
+			Serializer.DecodeFrame(Frame, Arena, [&bRead](const FHubMessageEnvelope& Envelope)
+			{
+				TStruct Out;
+				bRead = Envelope.Payload.ReadStruct(Out);
+			});
+			Arena.Reset();
+			return bRead;
+		});
+
+		// every scratch allocation of envelope was a heap allocation before the arena
+		UE_LOGFMT(BFHubSocketSystem, Display, "Inbound frame benchmark {0} ({1} iterations): FString {2} ns, raw utf-8 {3} ns (x{4}); arena allocations {5}, heap blocks {6}",
+			Name, Iterations, TextPath, Utf8Path, TextPath / FMath::Max(Utf8Path, 1.0),
+			FHubDecodeArena::GetAllocationCount() - ArenaAllocations, FHubDecodeArena::GetHeapBlockCount() - ArenaHeapBlocks);
+	}
+
+	void RunInboundFrameBenchmarks(const TArray<FString>& Args)
+	{
+		const int32 Iterations = ParseIntArg(Args, TEXT("Iterations="), 100000);
+
+		RunInboundFrameBenchmark(TEXT("Ping"), FBFHubResponseData_Ping{1234567890123, 1234567890456}, Iterations);
+		RunInboundFrameBenchmark(TEXT("ServerInit"), FBFHubRequestData_ServerInit{TEXT("server-name-01"), TEXT("password"), TEXT("1.0.12345"), TEXT("eu-west")}, Iterations);
+	}
+
+	// Inbound action lookup: envelope method view against bound actions
+	void RunActionLookupBenchmark(const TArray<FString>& Args)
+	{
+		const int32 Iterations = ParseIntArg(Args, TEXT("Iterations="), 1000000);
+		const int32 NumActions = FMath::Max(1, ParseIntArg(Args, TEXT("Actions="), 300));
+
+		FHubActionRegistry Registry;
+		TMap<FHubServiceAction, int32> ActionMap;
+		TArray<FString> Frames;
+
+		for (int32 Index = 0; Index < NumActions; ++Index)
+		{
+			FHubServiceAction Action;
+			Action.Fill(FString::Printf(TEXT("someController.someMethod%d"), Index), EHubControllerType::AUTH);
+			ActionMap.Add(Action, Registry.FindOrAdd(Action));
+			// method as it comes in the frame, lookup works with view into it
+			Frames.Add(Action.Method);
+		}
+
+		int32 FrameIndex = 0;
+		const double MapLookup = Measure(Iterations, [&ActionMap, &Frames, &FrameIndex]
+		{
+			// previous path: method copied into FHubServiceAction, then hashed and compared as FString
+			FHubServiceAction Action;
+			Action.Fill(Frames[FrameIndex++ % Frames.Num()], EHubControllerType::AUTH);
+			return ActionMap.Find(Action) != nullptr;
+		});
+
+		FrameIndex = 0;
+		const double RegistryLookup = Measure(Iterations, [&Registry, &Frames, &FrameIndex]
+		{
+			const FStringView Method = Frames[FrameIndex++ % Frames.Num()];
+			return Registry.Find(EHubControllerType::AUTH, Method) != FHubActionRegistry::InvalidId;
+		});
+
+		UE_LOGFMT(BFHubSocketSystem, Display, "Action lookup benchmark ({0} actions, {1} iterations): map {2} ns, registry {3} ns (x{4})",
+			NumActions, Iterations, MapLookup, RegistryLookup, MapLookup / FMath::Max(RegistryLookup, 1.0));
+	}
+
+	static FAutoConsoleCommand CodecBenchmarkCommand(
+		TEXT("BFHub.Bench.Codec"),
+		TEXT("Compare generated struct codecs with FJsonObjectConverter. Args: Iterations=N"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunCodecBenchmarks));
+
+	static FAutoConsoleCommand WireFormatBenchmarkCommand(
+		TEXT("BFHub.Bench.WireFormat"),
+		TEXT("Compare size and encode/decode time of json and MessagePack messages. Args: Iterations=N"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunWireFormatBenchmarks));
+
+	static FAutoConsoleCommand OutboundBufferBenchmarkCommand(
+		TEXT("BFHub.Bench.OutboundBuffer"),
+		TEXT("Compare json encoding through FString with direct utf-8 encoding into pooled buffer. Args: Iterations=N"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunOutboundBufferBenchmarks));
+
+	static FAutoConsoleCommand InboundFrameBenchmarkCommand(
+		TEXT("BFHub.Bench.InboundFrame"),
+		TEXT("Compare decoding json frame converted to FString with decoding raw utf-8 frame. Args: Iterations=N"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunInboundFrameBenchmarks));
+
+	static FAutoConsoleCommand ActionLookupBenchmarkCommand(
+		TEXT("BFHub.Bench.ActionLookup"),
+		TEXT("Compare action registry with TMap lookup of inbound messages. Args: Actions=N Iterations=N"),
+		FConsoleCommandWithArgsDelegate::CreateStatic(&RunActionLookupBenchmark));
+}
+
+#endif
@@ -3,8 +3,12 @@
 #include "HubSocketSystem.h"
 
 #include "BFHubSettings.h"
+#include "HubBufferPool.h"
+#include "HubFrameCompression.h"
+#include "HubLoopbackWebSocket.h"
 #include "IWebSocket.h"
 #include "MessageHandle.h"
+#include "Misc/Paths.h"
 #include "WebSocketsModule.h"
 #include "BFHttpModule/HttpClient/NetLog.h"
 #include "BFHubSockets/Services/BFHubService_Ping.h"
@@ -22,10 +26,48 @@ DEFINE_LOG_CATEGORY(BFHubSocketSystem);
 #define ERROR(Format, ...) CHANNEL(Error, Format, ##__VA_ARGS__)
 #define VERBOSE(Format, ...) CHANNEL(Verbose, Format, ##__VA_ARGS__)
 
+FHubSocketFactory UHubSocketSystem::SocketFactory;
+
 void UHubSocketSystem::Initialize(FSubsystemCollectionBase& Collection)
 {
 	Super::Initialize(Collection);
 
+	InboundDispatcher = MakeShared<FHubOrderedDispatcher>();
+	OutboundDispatcher = MakeShared<FHubOrderedDispatcher>();
+	WireSerializer = &IHubWireSerializer::Get(GetDefault<USocketSettings>()->WireFormat);
+	OutboundQueue.SetMaxBytes(GetDefault<USocketSettings>()->OutboundQueueMaxBytes);
+	OpenOutboundJournal();
+	if (OutboundJournal.IsOpen())
+	{
+		JournalAckAction.Fill("journal.ack", EHubControllerType::AUTH);
+		Bind<FHubJournalAckData>(JournalAckAction).AddUObject(this, &UHubSocketSystem::OnJournalAcknowledged);
+	}
+	Session.SetMaxBytes(GetDefault<USocketSettings>()->SessionReplayMaxBytes);
+
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	Liveness.Configure(Settings->LivenessMinIntervalSeconds, Settings->LivenessMaxIntervalSeconds, Settings->LivenessMissedBeats);
+
+	if (Settings->bSessionResumeEnabled)
+	{
+		SessionAction.Fill("session", EHubControllerType::AUTH);
+		SessionAction.RequiredAuth = false;
+		ResumeAction.Fill("resume", EHubControllerType::AUTH);
+		ResumeAction.RequiredAuth = false;
+		LaneAttachAction.Fill("lane.attach", EHubControllerType::AUTH);
+		LaneAttachAction.RequiredAuth = false;
+
+		// resume is the first message after reconnect, nothing should wait in front of it
+		FHubActionPolicy ResumePolicy;
+		ResumePolicy.bBypassBatching = true;
+		ResumePolicy.Priority = EHubOutboundPriority::Critical;
+		SetActionPolicy(ResumeAction, ResumePolicy);
+
+		Bind<FHubSessionData>(SessionAction).AddUObject(this, &UHubSocketSystem::OnSessionStarted);
+	}
+
+	LastMetricsLogTime = FPlatformTime::Seconds();
+	TickerHandle = FTSTicker::GetCoreTicker().AddTicker(FTickerDelegate::CreateUObject(this, &UHubSocketSystem::Tick));
+
 	CreateServicesLocator();
 	Services->RegisterService<UBFHubService_Ping>();
 
@@ -51,11 +93,18 @@ void UHubSocketSystem::Initialize(FSubsystemCollectionBase& Collection)
 
 void UHubSocketSystem::Deinitialize()
 {
+	FTSTicker::GetCoreTicker().RemoveTicker(TickerHandle);
+
+	PendingRequests.CancelAll();
+	OutboundJournal.Close();
+
 	if (Services)
 	{
 		Services->StopServices();
 	}
 
+	BulkLanes.Reset();
+
 	if (Socket.IsValid())
 	{
 		Socket->Close();
@@ -81,6 +130,9 @@ void UHubSocketSystem::StartConnection(const FString& Url)
 
 	LOG("Set new url: {0}", Url);
 
+	// session belongs to the hub it was issued by
+	Session.Reset();
+
 	ConnectionURL = Url;
 	CreateSocket();
 	Connect();
@@ -135,7 +187,20 @@ void UHubSocketSystem::CreateSocket()
 		return;
 	}
 
-	Socket = FWebSocketsModule::Get().CreateWebSocket(ConnectionURL, TEXT("wss"));
+	// previous socket (other url or dead connection) must not report into the new one
+	if (Socket.IsValid())
+	{
+		Socket->OnConnected().RemoveAll(this);
+		Socket->OnClosed().RemoveAll(this);
+		Socket->OnConnectionError().RemoveAll(this);
+		Socket->OnRawMessage().RemoveAll(this);
+		Socket->Close();
+	}
+
+	WireSerializer = &IHubWireSerializer::Get(GetDefault<USocketSettings>()->WireFormat);
+	LOG("Using {0} wire format", EnumValueToString(WireSerializer->GetFormat()));
+
+	Socket = SocketFactory ? SocketFactory(ConnectionURL, WireSerializer->GetSubprotocol()) : CreateDefaultSocket(ConnectionURL, WireSerializer->GetSubprotocol());
 
 	if (Socket.IsValid() == false)
 	{
@@ -148,13 +213,143 @@ void UHubSocketSystem::CreateSocket()
 	Socket->OnClosed().AddUObject(this, &UHubSocketSystem::OnClosed);
 	Socket->OnConnectionError().AddUObject(this, &UHubSocketSystem::OnConnectionError);
 
-	// Messaging
-	Socket->OnMessageSent().AddUObject(this, &UHubSocketSystem::OnMessageSent);
-	Socket->OnMessage().AddUObject(this, &UHubSocketSystem::OnMessage);
+	// Messaging, text frames are received as raw utf-8 too, OnMessage would convert every frame to FString
+	Socket->OnRawMessage().AddUObject(this, &UHubSocketSystem::OnRawMessage);
+
+	CreateBulkLanes();
 
 	SetConnectionState(EBFSocketConnectionState::Created);
 }
 
+void UHubSocketSystem::CreateBulkLanes()
+{
+	// batched messages of old lanes go back to queue
+	FlushOutboundBatch();
+	BulkLanes.Reset();
+
+	const int32 BulkLaneCount = GetDefault<USocketSettings>()->BulkLaneCount;
+	for (int32 Lane = 1; Lane <= BulkLaneCount; ++Lane)
+	{
+		const TSharedPtr<IWebSocket> LaneSocket = SocketFactory ? SocketFactory(ConnectionURL, WireSerializer->GetSubprotocol()) : CreateDefaultSocket(ConnectionURL, WireSerializer->GetSubprotocol());
+		if (LaneSocket.IsValid() == false)
+		{
+			ERROR("Failed to create WebSocket of lane {0}, its actions use control connection", Lane);
+			break;
+		}
+
+		// inbound frames of any lane handled as frames of control connection
+		BulkLanes.Add(MakeUnique<FHubConnectionLane>(Lane, LaneSocket.ToSharedRef(),
+			FHubConnectionLane::FOnFrame::CreateUObject(this, &UHubSocketSystem::HandleRawFrame),
+			FHubConnectionLane::FOnEstablished::CreateUObject(this, &UHubSocketSystem::AuthorizeLane)));
+	}
+}
+
+void UHubSocketSystem::StartBulkLanes()
+{
+	for (const TUniquePtr<FHubConnectionLane>& Lane : BulkLanes)
+	{
+		Lane->Start();
+	}
+}
+
+void UHubSocketSystem::StopBulkLanes()
+{
+	for (const TUniquePtr<FHubConnectionLane>& Lane : BulkLanes)
+	{
+		Lane->Stop();
+	}
+}
+
+int32 UHubSocketSystem::GetSendLane(const FHubServiceAction& Key, const FHubActionPolicy& Policy) const
+{
+	const int32 Lane = Policy.Lane;
+	if (BulkLanes.IsValidIndex(Lane - 1) == false || BulkLanes[Lane - 1]->IsReady() == false)
+	{
+		return 0;
+	}
+
+	// lane connection never sent credentials, hub accepts authorized actions there only after attach
+	if (Key.RequiredAuth && BulkLanes[Lane - 1]->IsAuthorized() == false)
+	{
+		return 0;
+	}
+	return Lane;
+}
+
+void UHubSocketSystem::AuthorizeBulkLanes()
+{
+	for (const TUniquePtr<FHubConnectionLane>& Lane : BulkLanes)
+	{
+		AuthorizeLane(*Lane);
+	}
+}
+
+void UHubSocketSystem::AuthorizeLane(FHubConnectionLane& Lane)
+{
+	// lane established before authorization is attached by OnAuthorized or OnSessionStarted
+	if (Lane.IsReady() == false || Lane.IsAuthorized() || Session.IsActive() == false || ConnectionState != EBFSocketConnectionState::Authorized)
+	{
+		return;
+	}
+
+	const int32 LaneIndex = Lane.GetIndex();
+	const uint32 Generation = Lane.GetGeneration();
+
+	FHubEncodeOptions Options = MakeEncodeOptions();
+	Options.RequestId = PendingRequests.Add(GetDefault<USocketSettings>()->RequestTimeoutSeconds,
+		[WeakThis = TWeakObjectPtr<UHubSocketSystem>(this), LaneIndex, Generation, LanePtr = &Lane](const EHubRequestStatus Status, const FHubMessagePayload*)
+		{
+			UHubSocketSystem* This = WeakThis.Get();
+			// lane was recreated or reconnected, new connection sends own attach
+			if (This == nullptr || This->BulkLanes.IsValidIndex(LaneIndex - 1) == false
+				|| This->BulkLanes[LaneIndex - 1].Get() != LanePtr || LanePtr->GetGeneration() != Generation || LanePtr->IsReady() == false)
+			{
+				return;
+			}
+
+			if (Status == EHubRequestStatus::Success)
+			{
+				LOG("Lane {0} attached to hub session, it carries authorized actions", LaneIndex);
+				LanePtr->SetAuthorized(true);
+			}
+			else
+			{
+				WARNING("Lane {0} is not attached to hub session ({1}), its authorized actions use control connection", LaneIndex, EnumValueToString(Status));
+			}
+		});
+
+	TArray<uint8> Message = FHubBufferPool::Get().Acquire();
+	if (FHubMessageEncoder::Encode(LaneAttachAction, FHubLaneAttachRequest{Session.GetToken(), LaneIndex}, Options, Message) == false)
+	{
+		ERROR("Failed to setup attach message of lane {0}", LaneIndex);
+		PendingRequests.Complete(Options.RequestId, EHubRequestStatus::SendFailed, nullptr);
+	}
+	else
+	{
+		// sent on the lane itself, hub attaches the connection it came from
+		SendFrame(Message, LaneIndex);
+	}
+	FHubBufferPool::Get().Release(MoveTemp(Message));
+}
+
+void UHubSocketSystem::SetSocketFactory(FHubSocketFactory Factory)
+{
+	SocketFactory = MoveTemp(Factory);
+}
+
+TSharedPtr<IWebSocket> UHubSocketSystem::CreateDefaultSocket(const FString& Url, const FString& Protocol)
+{
+#if !UE_BUILD_SHIPPING
+	// offline hub with simulated network, conditions are given in url
+	if (Url.StartsWith(FHubLoopbackWebSocket::UrlScheme))
+	{
+		return MakeShared<FHubLoopbackWebSocket>(FHubLoopbackOptions::FromUrl(Url));
+	}
+#endif
+
+	return FWebSocketsModule::Get().CreateWebSocket(Url, Protocol);
+}
+
 void UHubSocketSystem::Connect()
 {
 	if (Socket.IsValid())
@@ -171,6 +366,7 @@ void UHubSocketSystem::Connect()
 void UHubSocketSystem::SetConnectionState(EBFSocketConnectionState State)
 {
 	LOG("Change connection state: {0}", EnumValueToString(State));
+	HubSocketTrace::ConnectionStateChanged(static_cast<uint8>(State), *EnumValueToString(State));
 
 	ConnectionState = State;
 	OnConnectionStateChanged.Broadcast(ConnectionState);
@@ -178,59 +374,501 @@ void UHubSocketSystem::SetConnectionState(EBFSocketConnectionState State)
 	TrySendQueuedMessages();
 }
 
-bool UHubSocketSystem::TrySend(const FString& InRawString) const
+bool UHubSocketSystem::Tick(float DeltaTime)
 {
-	if (IsConnected())
+	// request timeouts, reconnect, batching windows and service timers
+	Timers.Advance(FPlatformTime::Seconds());
+
+	const float MetricsLogInterval = GetDefault<USocketSettings>()->MetricsLogIntervalSeconds;
+	if (MetricsLogInterval > 0.0f && FPlatformTime::Seconds() - LastMetricsLogTime >= MetricsLogInterval)
+	{
+		LastMetricsLogTime = FPlatformTime::Seconds();
+		LogActionMetrics();
+	}
+
+	TrySendQueuedMessages();
+	// messages spilled during the frame and acknowledge of replayed ones
+	OutboundJournal.Flush();
+	TickLiveness(FPlatformTime::Seconds());
+
+	HubSocketTrace::FQueueDepths Depths;
+	Depths.QueueMessages = OutboundQueue.Num();
+	Depths.QueueBytes = OutboundQueue.GetBytes();
+	Depths.JournalMessages = OutboundJournal.Num();
+	Depths.BatchMessages = OutboundBatch.Num();
+	Depths.PendingRequests = PendingRequests.Num();
+	for (const TUniquePtr<FHubConnectionLane>& Lane : BulkLanes)
+	{
+		Depths.BatchMessages += Lane->OutboundBatch.Num();
+	}
+	HubSocketTrace::QueueDepths(Depths);
+
+	const double Now = FPlatformTime::Seconds();
+	for (const TUniquePtr<FHubConnectionLane>& Lane : BulkLanes)
+	{
+		Lane->Tick(Now);
+	}
+
+	return true;
+}
+
+bool UHubSocketSystem::TrySend(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	if (IsConnected() == false)
 	{
-		Socket->Send(InRawString);
+		return false;
+	}
+
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	const FHubActionPolicy& Policy = GetActionPolicy(Key);
+	const int32 Lane = GetSendLane(Key, Policy);
+	if (Settings->bBatchingEnabled && Policy.bBypassBatching == false)
+	{
+		FHubOutboundBatch& Batch = GetOutboundBatch(Lane);
+		Batch.Add(Key, MoveTemp(InMessage), CoalescingKey, RequestId);
+		if (Batch.Num() >= Settings->MaxBatchMessages)
+		{
+			FlushOutboundBatch(Lane);
+		}
+		else
+		{
+			ScheduleBatchFlush(Lane);
+		}
 		return true;
 	}
 
-	return false;
+	// keep order with messages which are waiting in batch, order is kept per connection
+	FlushOutboundBatch(Lane);
+	SendMessages(MakeArrayView(&InMessage, 1), Lane);
+	FHubBufferPool::Get().Release(MoveTemp(InMessage));
+	return true;
 }
 
-void UHubSocketSystem::TrySendQueuedMessages()
+void UHubSocketSystem::SendMessages(const TConstArrayView<TArray<uint8>> InMessages, const int32 Lane)
+{
+	// bulk lanes are not part of session, their messages are not replayed
+	if (Lane == 0 && IsSessionSequencing())
+	{
+		SendBatchFrame(Session.Stamp(InMessages, *WireSerializer), Lane);
+		return;
+	}
+
+	SendBatchFrame(InMessages, Lane);
+}
+
+void UHubSocketSystem::SendBatchFrame(const TConstArrayView<TArray<uint8>> InMessages, const int32 Lane)
+{
+	if (InMessages.Num() == 1)
+	{
+		SendFrame(InMessages[0], Lane);
+		return;
+	}
+
+	TArray<uint8> Frame = FHubBufferPool::Get().Acquire();
+	WireSerializer->MakeBatchFrame(InMessages, Frame);
+	SendFrame(Frame, Lane);
+	FHubBufferPool::Get().Release(MoveTemp(Frame));
+}
+
+void UHubSocketSystem::SendFrame(const TArray<uint8>& InFrame, const int32 Lane)
+{
+	BFHUB_TRACE_SCOPE(BFHub_SendFrame);
+
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	if (Settings->bCompressionEnabled && InFrame.Num() >= Settings->CompressionThresholdBytes)
+	{
+		TArray<uint8> CompressedFrame = FHubBufferPool::Get().Acquire();
+		const bool bCompressed = FHubFrameCompression::Compress(InFrame, CompressedFrame);
+		if (bCompressed)
+		{
+			SendToSocket(CompressedFrame, true, Lane);
+			OnFrameSent(InFrame);
+		}
+		FHubBufferPool::Get().Release(MoveTemp(CompressedFrame));
+
+		if (bCompressed)
+		{
+			return;
+		}
+
+		WARNING("Failed to compress frame, sending it as is");
+	}
+
+	// json goes as text frame through the same raw overload, it is utf-8 already, socket copies it once into own send buffer
+	SendToSocket(InFrame, WireSerializer->IsBinary(), Lane);
+	OnFrameSent(InFrame);
+}
+
+void UHubSocketSystem::SendToSocket(const TArray<uint8>& InFrame, const bool bBinary, const int32 Lane)
 {
+	if (Lane > 0)
+	{
+		BulkLanes[Lane - 1]->Send(InFrame, bBinary);
+	}
+	else
+	{
+		Socket->Send(InFrame.GetData(), InFrame.Num(), bBinary);
+		Liveness.OnSent(FPlatformTime::Seconds());
+	}
+}
+
+void UHubSocketSystem::FlushOutboundBatch()
+{
+	for (int32 Lane = 0; Lane <= BulkLanes.Num(); ++Lane)
+	{
+		FlushOutboundBatch(Lane);
+	}
+}
+
+void UHubSocketSystem::FlushOutboundBatch(const int32 Lane)
+{
+	FHubOutboundBatch& Batch = GetOutboundBatch(Lane);
+	Timers.Cancel(Batch.FlushTimer);
+	if (Batch.IsEmpty())
+	{
+		return;
+	}
+
 	if (IsConnected())
 	{
-		if (ConnectionState == EBFSocketConnectionState::Authorized)
+		// lane could be lost after messages were batched, control connection takes them then
+		const bool bLaneReady = Lane == 0 || BulkLanes[Lane - 1]->IsReady();
+		SendMessages(Batch.Messages, bLaneReady ? Lane : 0);
+		FHubBufferPool::Get().Release(Batch.Messages);
+	}
+	else
+	{
+		for (int32 Index = 0; Index < Batch.Num(); ++Index)
 		{
-			if (QueuedMessages.IsEmpty() == false)
-			{
-				LOG("Send queued messages after authorization");
-				DequeueMessages(QueuedMessages);
-			}
+			EnqueueMessage(Batch.Keys[Index], MoveTemp(Batch.Messages[Index]), Batch.CoalescingKeys[Index], Batch.RequestIds[Index]);
 		}
-		else if (ConnectionState == EBFSocketConnectionState::Established)
+	}
+
+	Batch.Reset();
+}
+
+FHubOutboundBatch& UHubSocketSystem::GetOutboundBatch(const int32 Lane)
+{
+	return Lane > 0 ? BulkLanes[Lane - 1]->OutboundBatch : OutboundBatch;
+}
+
+void UHubSocketSystem::ScheduleBatchFlush(const int32 Lane)
+{
+	FHubOutboundBatch& Batch = GetOutboundBatch(Lane);
+	if (Timers.IsScheduled(Batch.FlushTimer))
+	{
+		return;
+	}
+
+	Batch.FlushTimer = Timers.Schedule(Batch.GetFirstMessageTime() + GetDefault<USocketSettings>()->BatchWindowSeconds, [this, Lane]()
+	{
+		// lanes could be recreated since, their batches are flushed then
+		if (Lane <= BulkLanes.Num())
 		{
-			if (QueuedNonAuthMessages.IsEmpty() == false)
+			FlushOutboundBatch(Lane);
+		}
+	});
+}
+
+FHubEncodeOptions UHubSocketSystem::MakeEncodeOptions() const
+{
+	FHubEncodeOptions Options;
+	Options.WireFormat = WireSerializer->GetFormat();
+	Options.PayloadEncoding = GetDefault<USocketSettings>()->PayloadEncoding;
+	return Options;
+}
+
+EHubSendResult UHubSocketSystem::SendInOrder(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	if (OutboundDispatcher->IsIdle())
+	{
+		return SendMessage(Key, MoveTemp(InMessage), CoalescingKey, RequestId);
+	}
+
+	// async messages in front of this one still serializing, result is known only after them
+	DispatchSendMessage(Key, MoveTemp(InMessage), CoalescingKey, RequestId);
+	return EHubSendResult::Queued;
+}
+
+EHubSendResult UHubSocketSystem::SendMessage(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	if (Key.RequiredAuth && ConnectionState != EBFSocketConnectionState::Authorized)
+	{
+		return EnqueueMessage(Key, MoveTemp(InMessage), CoalescingKey, RequestId);
+	}
+	// queue is still draining after reconnect, message goes behind queued ones of its class
+	if (OutboundQueue.HasPending(Key.RequiredAuth, GetActionPolicy(Key).Priority) || (Key.RequiredAuth && JournalInFlight < OutboundJournal.Num()))
+	{
+		return EnqueueMessage(Key, MoveTemp(InMessage), CoalescingKey, RequestId);
+	}
+	// message is moved only when it is accepted
+	if (TrySend(Key, MoveTemp(InMessage), CoalescingKey, RequestId) == false)
+	{
+		return EnqueueMessage(Key, MoveTemp(InMessage), CoalescingKey, RequestId);
+	}
+
+	return EHubSendResult::Sent;
+}
+
+void UHubSocketSystem::DispatchSendMessage(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	OutboundDispatcher->Dispatch([this, Key, CoalescingKey, RequestId, Message = MoveTemp(InMessage)]() mutable
+	{
+		SendMessage(Key, MoveTemp(Message), CoalescingKey, RequestId);
+	});
+}
+
+void UHubSocketSystem::TrySendQueuedMessages()
+{
+	if (IsConnected() == false)
+	{
+		return;
+	}
+
+	const bool bAuthorized = ConnectionState == EBFSocketConnectionState::Authorized;
+	const bool bJournalSendable = bAuthorized && JournalInFlight < OutboundJournal.Num();
+	if (OutboundQueue.HasSendable(bAuthorized) == false && bJournalSendable == false)
+	{
+		return;
+	}
+
+	BFHUB_TRACE_SCOPE(BFHub_SendQueued);
+
+	FlushOutboundBatch();
+
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	const int32 MessagesPerFrame = Settings->bBatchingEnabled ? Settings->MaxBatchMessages : 1;
+	int32 MessagesBudget = Settings->QueueDrainMessagesPerTick > 0 ? Settings->QueueDrainMessagesPerTick : MAX_int32;
+	int64 BytesBudget = Settings->QueueDrainBytesPerTick > 0 ? Settings->QueueDrainBytesPerTick : MAX_int64;
+
+	TArray<TArray<uint8>> FrameMessages;
+	int32 NumSent = 0;
+	const auto DrainQueue = [&](const EHubOutboundPriority Until)
+	{
+		for (FHubQueuedMessage Queued; MessagesBudget > 0 && BytesBudget > 0 && OutboundQueue.Pop(bAuthorized, Queued, Until);)
+		{
+			--MessagesBudget;
+			BytesBudget -= Queued.Message.Num();
+			++NumSent;
+
+			if (ActionMetrics.IsValidIndex(Queued.ActionId))
+			{
+				const double DwellSeconds = FPlatformTime::Seconds() - Queued.EnqueueTime;
+				ActionMetrics[Queued.ActionId]->RecordTime(EHubActionMetric::QueueDwell, static_cast<uint64>(DwellSeconds * 1e9));
+			}
+
+			// bulk messages drain through own connection and do not delay control frames
+			const int32 Lane = ActionPolicies.IsValidIndex(Queued.ActionId) ? GetSendLane(Queued.Key, ActionPolicies[Queued.ActionId]) : 0;
+			if (Lane > 0)
+			{
+				FHubOutboundBatch& Batch = GetOutboundBatch(Lane);
+				Batch.Add(Queued.Key, MoveTemp(Queued.Message), NullOpt, Queued.RequestId);
+				if (Batch.Num() >= MessagesPerFrame)
+				{
+					FlushOutboundBatch(Lane);
+				}
+				continue;
+			}
+
+			FrameMessages.Add(MoveTemp(Queued.Message));
+			if (FrameMessages.Num() >= MessagesPerFrame)
 			{
-				LOG("Send queued non auth messages after connection established");
-				DequeueMessages(QueuedNonAuthMessages);
+				SendMessages(FrameMessages);
+				FHubBufferPool::Get().Release(FrameMessages);
+				FrameMessages.Reset();
 			}
 		}
+	};
+
+	// journal has overflow of classes from JournalPriority down, it is older than messages of these classes in the queue
+	DrainQueue(bJournalSendable ? JournalPriority : EHubOutboundPriority::Num);
+
+	// records stay in journal until hub confirms them, sent ones are skipped while connection lasts
+	for (; bJournalSendable && MessagesBudget > 0 && BytesBudget > 0 && JournalInFlight < OutboundJournal.Num(); ++JournalInFlight)
+	{
+		TArray<uint8> Message = FHubBufferPool::Get().Acquire();
+		const EHubJournalReadResult ReadResult = OutboundJournal.Read(JournalInFlight, Message);
+		if (ReadResult == EHubJournalReadResult::Failed)
+		{
+			// records are kept, replay continues on next tick
+			ERROR("Outbound journal can't be read, replay paused with {0} messages left", OutboundJournal.Num() - JournalInFlight);
+			FHubBufferPool::Get().Release(MoveTemp(Message));
+			break;
+		}
+		if (ReadResult == EHubJournalReadResult::Damaged)
+		{
+			ERROR("Damaged message in outbound journal skipped");
+			FHubBufferPool::Get().Release(MoveTemp(Message));
+			continue;
+		}
+
+		--MessagesBudget;
+		BytesBudget -= Message.Num();
+		++NumSent;
+
+		// message may reach hub twice: sent before crash or disconnect and not acknowledged
+		TArray<uint8>& Stamped = FrameMessages.Add_GetRef(FHubBufferPool::Get().Acquire());
+		if (WireSerializer->StampJournalId(Message, static_cast<int64>(OutboundJournal.GetId(JournalInFlight)), Stamped) == false)
+		{
+			WARNING("Journaled message can't be stamped with its id, it is sent as is");
+			Stamped = MoveTemp(Message);
+		}
+		FHubBufferPool::Get().Release(MoveTemp(Message));
+
+		if (FrameMessages.Num() >= MessagesPerFrame)
+		{
+			SendMessages(FrameMessages);
+			FHubBufferPool::Get().Release(FrameMessages);
+			FrameMessages.Reset();
+		}
+	}
+
+	// messages queued behind the journal wait until it is replayed
+	if (JournalInFlight == OutboundJournal.Num())
+	{
+		DrainQueue(EHubOutboundPriority::Num);
+	}
+
+	if (FrameMessages.IsEmpty() == false)
+	{
+		SendMessages(FrameMessages);
+		FHubBufferPool::Get().Release(FrameMessages);
+	}
+	for (int32 Lane = 1; Lane <= BulkLanes.Num(); ++Lane)
+	{
+		FlushOutboundBatch(Lane);
+	}
+
+	LOG("Sent {0} queued messages ({1}), left in queue: {2}, in journal: {3}",
+		NumSent, bAuthorized ? TEXT("authorized") : TEXT("non auth"), OutboundQueue.Num(), OutboundJournal.Num());
+	UpdateBackpressure();
+}
+
+EHubSendResult UHubSocketSystem::EnqueueMessage(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, const int64 RequestId)
+{
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+
+	// every message enters the queue, so priority and collapse apply to it; only the overflow goes to the journal
+	SpillOutboundOverflow(InMessage.Num());
+
+	const int32 ActionId = ActionRegistry.Find(Key);
+	const FHubActionPolicy& Policy = GetActionPolicy(Key);
+
+	const EHubQueuePushResult Result = OutboundQueue.Push(Key, ActionId, Policy, MoveTemp(InMessage), CoalescingKey, RequestId);
+	UpdateBackpressure();
+
+	// older requests dropped for this message would otherwise wait for their timeout
+	for (const int64 DroppedRequestId : OutboundQueue.TakeDroppedRequests())
+	{
+		WARNING("Queued request {0} dropped from full outbound queue", DroppedRequestId);
+		PendingRequests.Complete(DroppedRequestId, EHubRequestStatus::SendFailed, nullptr);
+	}
+
+	if (Result == EHubQueuePushResult::Rejected)
+	{
+		ERROR("Outbound queue is full ({0} bytes), message dropped - key: {1}", OutboundQueue.GetBytes(), Key.ToString());
+		if (RequestId != 0)
+		{
+			// result of in-order send does not reach Request, which checks Dropped only for immediate send
+			PendingRequests.Complete(RequestId, EHubRequestStatus::SendFailed, nullptr);
+		}
+		return EHubSendResult::Dropped;
 	}
+	if (Result == EHubQueuePushResult::Collapsed)
+	{
+		VERBOSE("Queued message replaced by newer one - key: {0}", Key.ToString());
+		return EHubSendResult::Queued;
+	}
+
+	if (IsConnected() == false || (Key.RequiredAuth && ConnectionState != EBFSocketConnectionState::Authorized))
+	{
+		WARNING("Can't send message, socket is not connected! Current message request queued - key: {0}. ", Key.ToString());
+	}
+	return EHubSendResult::Queued;
 }
 
-void UHubSocketSystem::DequeueMessages(TQueue<FString>& Queue) const
+void UHubSocketSystem::OnJournalAcknowledged(const FHubJournalAckData& Data)
 {
-	for (FString Message; Queue.Dequeue(Message);)
+	const int32 NumAcknowledged = OutboundJournal.Acknowledge(static_cast<uint64>(FMath::Max<int64>(Data.Jid, 0)));
+	JournalInFlight = FMath::Max(JournalInFlight - NumAcknowledged, 0);
+	if (OutboundJournal.IsEmpty())
 	{
-		Socket->Send(Message);
+		JournalPriority = EHubOutboundPriority::Num;
 	}
+
+	VERBOSE("Hub confirmed journaled messages up to {0}, left in journal: {1}", Data.Jid, OutboundJournal.Num());
 }
 
-void UHubSocketSystem::EnqueueMessage(const FHubServiceAction& Key, const FString& InRawMessage)
+void UHubSocketSystem::SpillOutboundOverflow(const int64 IncomingBytes)
 {
-	WARNING("Can't send message, socket is not connected! Current message request queued - key: {0}. ", Key.ToString());
+	if (OutboundJournal.IsOpen() == false)
+	{
+		return;
+	}
 
-	if (Key.RequiredAuth == false)
+	const int64 SpillBytes = GetDefault<USocketSettings>()->OutboundJournalSpillBytes;
+	FHubQueuedMessage Overflow;
+	EHubOutboundPriority Priority = EHubOutboundPriority::Num;
+	while (OutboundQueue.GetBytes() + IncomingBytes > SpillBytes && OutboundQueue.PopOverflow(Overflow, Priority))
 	{
-		QueuedNonAuthMessages.Enqueue(InRawMessage);
+		if (OutboundJournal.Append(Overflow.Message))
+		{
+			VERBOSE("Message spilled to outbound journal - key: {0}", Overflow.Key.ToString());
+			JournalPriority = FMath::Min(JournalPriority, Priority);
+		}
+		else
+		{
+			ERROR("Outbound journal is full ({0} bytes), message dropped - key: {1}", OutboundJournal.GetPendingBytes(), Overflow.Key.ToString());
+		}
+		FHubBufferPool::Get().Release(MoveTemp(Overflow.Message));
 	}
-	else
+}
+
+void UHubSocketSystem::OpenOutboundJournal()
+{
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	if (Settings->bOutboundJournalEnabled == false)
+	{
+		return;
+	}
+
+	// every socket system (PIE instances, server and client from one project) has own file, locked while it is open,
+	// first free slot is taken, so restarted process finds file of previous run
+	const FString Directory = FPaths::ProjectSavedDir() / TEXT("HubSockets");
+	const FString BaseName = FPaths::GetBaseFilename(Settings->OutboundJournalFile);
+	const FString Extension = FPaths::GetExtension(Settings->OutboundJournalFile, true);
+	const TCHAR* Role = GetGameInstance()->IsDedicatedServerInstance() ? TEXT("Server") : TEXT("Client");
+
+	for (int32 Slot = 0; Slot < MaxOutboundJournalSlots; ++Slot)
+	{
+		const FString Filename = Directory / FString::Printf(TEXT("%s-%s-%d%s"), *BaseName, Role, Slot, *Extension);
+		if (OutboundJournal.Open(Filename, WireSerializer->GetFormat(), Settings->OutboundJournalMaxBytes))
+		{
+			// priority of messages left by previous run is unknown, they go before every queued message
+			JournalPriority = OutboundJournal.IsEmpty() ? EHubOutboundPriority::Num : EHubOutboundPriority::Critical;
+			LOG("Using outbound journal {0}", Filename);
+			return;
+		}
+	}
+
+	ERROR("Failed to open outbound journal {0} in {1}, queued messages are kept in memory only", Settings->OutboundJournalFile, Directory);
+}
+
+void UHubSocketSystem::UpdateBackpressure()
+{
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	const float FillRatio = OutboundQueue.GetFillRatio();
+
+	const bool bActive = bOutboundBackpressure
+		? FillRatio > Settings->BackpressureLowWatermark
+		: FillRatio >= Settings->BackpressureHighWatermark && OutboundQueue.IsEmpty() == false;
+
+	if (bActive != bOutboundBackpressure)
 	{
-		QueuedMessages.Enqueue(InRawMessage);
+		bOutboundBackpressure = bActive;
+		WARNING("Outbound backpressure {0}: {1} queued messages, {2} bytes, dropped {3}",
+			bActive ? TEXT("on") : TEXT("off"), OutboundQueue.Num(), OutboundQueue.GetBytes(), OutboundQueue.GetDroppedCount());
+		OutboundBackpressureDelegate.Broadcast(bActive);
 	}
 }
 
@@ -245,16 +883,100 @@ bool UHubSocketSystem::IsConnected() const
 
 FCallbackErrorHandle::FOnError& UHubSocketSystem::BindError(const FHubServiceAction& Key)
 {
-	ensureMsgf(Handlers.Contains(Key), TEXT("Bind error handle allow only after bind message handle! %s"), *Key.Method);
+	const int32 ActionId = ActionRegistry.Find(Key);
+	checkf(ActionId != FHubActionRegistry::InvalidId && Handlers[ActionId].IsValid(), TEXT("Bind error handle allow only after bind message handle! %s"), *Key.Method);
 
-	return StaticCastSharedPtr<FCallbackErrorHandle>(Handlers.FindChecked(Key))->ErrorHandler;
+	return StaticCastSharedPtr<FCallbackErrorHandle>(Handlers[ActionId])->ErrorHandler;
 }
 
 void UHubSocketSystem::Unbind(const FHubServiceAction& Key)
 {
-	if (Handlers.Contains(Key))
+	const int32 ActionId = ActionRegistry.Find(Key);
+	if (ActionId != FHubActionRegistry::InvalidId && Handlers[ActionId].IsValid())
 	{
-		Handlers[Key]->Clear();
+		Handlers[ActionId]->Clear();
+	}
+}
+
+void UHubSocketSystem::SetActionPolicy(const FHubServiceAction& Key, const FHubActionPolicy& Policy)
+{
+	ActionPolicies[RegisterAction(Key)] = Policy;
+}
+
+const FHubActionPolicy& UHubSocketSystem::GetActionPolicy(const FHubServiceAction& Key) const
+{
+	static const FHubActionPolicy DefaultPolicy;
+
+	const int32 ActionId = ActionRegistry.Find(Key);
+	return ActionId != FHubActionRegistry::InvalidId ? ActionPolicies[ActionId] : DefaultPolicy;
+}
+
+int32 UHubSocketSystem::RegisterAction(const FHubServiceAction& Key)
+{
+	const int32 ActionId = ActionRegistry.FindOrAdd(Key);
+	if (ActionId >= Handlers.Num())
+	{
+		Handlers.SetNum(ActionRegistry.Num());
+		ActionPolicies.SetNum(ActionRegistry.Num());
+		while (ActionMetrics.Num() < ActionRegistry.Num())
+		{
+			ActionMetrics.Add(MakeShared<FHubActionMetrics>());
+		}
+	}
+	return ActionId;
+}
+
+void UHubSocketSystem::LogActionMetrics() const
+{
+	// game thread cost of the action: decode (when not on worker) and handlers
+	const auto GetCost = [](const FHubActionMetrics& Metrics)
+	{
+		return Metrics.GetHistogram(EHubActionMetric::Decode).GetTotal() + Metrics.GetHistogram(EHubActionMetric::Handler).GetTotal();
+	};
+
+	TArray<int32> ActionIds;
+	for (int32 ActionId = 0; ActionId < ActionMetrics.Num(); ++ActionId)
+	{
+		if (ActionMetrics[ActionId]->GetMessagesIn() > 0 || ActionMetrics[ActionId]->GetMessagesOut() > 0)
+		{
+			ActionIds.Add(ActionId);
+		}
+	}
+	ActionIds.Sort([this, &GetCost](const int32 Left, const int32 Right) { return GetCost(*ActionMetrics[Left]) > GetCost(*ActionMetrics[Right]); });
+
+	UE_LOGFMT(BFHubSocketSystem, Display, "Hub action metrics: {ActionCount} active actions, recording {Enabled}",
+		("ActionCount", ActionIds.Num()), ("Enabled", FHubActionMetrics::IsEnabled()));
+
+	const auto Micros = [](const FHubHistogram& Histogram, const double Fraction) { return Histogram.GetPercentile(Fraction) / 1000; };
+	for (const int32 ActionId : ActionIds)
+	{
+		const FHubActionMetrics& Metrics = *ActionMetrics[ActionId];
+		const FHubHistogram& Encode = Metrics.GetHistogram(EHubActionMetric::Encode);
+		const FHubHistogram& Decode = Metrics.GetHistogram(EHubActionMetric::Decode);
+		const FHubHistogram& Handler = Metrics.GetHistogram(EHubActionMetric::Handler);
+		const FHubHistogram& QueueDwell = Metrics.GetHistogram(EHubActionMetric::QueueDwell);
+
+		UE_LOGFMT(BFHubSocketSystem, Display,
+			"Hub action {Action}: in {MessagesIn} ({BytesIn} B), out {MessagesOut} ({BytesOut} B), "
+			"encode p50 {EncodeP50Us} p99 {EncodeP99Us} us, decode p50 {DecodeP50Us} p99 {DecodeP99Us} us, "
+			"handler p50 {HandlerP50Us} p99 {HandlerP99Us} max {HandlerMaxUs} us, game thread total {CostMs} ms, "
+			"queue dwell p50 {QueueDwellP50Us} p99 {QueueDwellP99Us} us",
+			("Action", ActionRegistry.GetAction(ActionId).ToString()),
+			("MessagesIn", Metrics.GetMessagesIn()), ("BytesIn", Metrics.GetBytesIn()),
+			("MessagesOut", Metrics.GetMessagesOut()), ("BytesOut", Metrics.GetBytesOut()),
+			("EncodeP50Us", Micros(Encode, 0.5)), ("EncodeP99Us", Micros(Encode, 0.99)),
+			("DecodeP50Us", Micros(Decode, 0.5)), ("DecodeP99Us", Micros(Decode, 0.99)),
+			("HandlerP50Us", Micros(Handler, 0.5)), ("HandlerP99Us", Micros(Handler, 0.99)), ("HandlerMaxUs", Handler.GetMax() / 1000),
+			("CostMs", GetCost(Metrics) / 1000000.0),
+			("QueueDwellP50Us", Micros(QueueDwell, 0.5)), ("QueueDwellP99Us", Micros(QueueDwell, 0.99)));
+	}
+}
+
+void UHubSocketSystem::ResetActionMetrics()
+{
+	for (const TSharedPtr<FHubActionMetrics>& Metrics : ActionMetrics)
+	{
+		Metrics->Reset();
 	}
 }
 
@@ -265,11 +987,11 @@ void UHubSocketSystem::StartReconnectTimer()
 		return;
 	}
 
-	if (GetWorld() && !GetWorld()->GetTimerManager().IsTimerActive(ReconnectTimerHandle))
+	if (Timers.IsScheduled(ReconnectTimer) == false)
 	{
 		WARNING("Start reconnecting timer in {0} seconds", CurrentReconnectTimeInterval);
 
-		GetWorld()->GetTimerManager().SetTimer(ReconnectTimerHandle, this, &UHubSocketSystem::Connect, CurrentReconnectTimeInterval, true);
+		ScheduleReconnect(CurrentReconnectTimeInterval);
 
 		SetConnectionState(EBFSocketConnectionState::WaitingForReconnect);
 
@@ -281,15 +1003,27 @@ void UHubSocketSystem::StartReconnectTimer()
 	}
 }
 
-void UHubSocketSystem::StopReconnectTimer()
+void UHubSocketSystem::ScheduleReconnect(const float Interval)
 {
-	if (GetWorld() && GetWorld()->GetTimerManager().IsTimerActive(ReconnectTimerHandle))
+	ReconnectTimer = Timers.ScheduleIn(Interval, [this, Interval]()
 	{
-		GetWorld()->GetTimerManager().ClearTimer(ReconnectTimerHandle);
+		// next attempt is scheduled first, connect can succeed right away and stop it
+		ScheduleReconnect(Interval);
+		Connect();
+	});
+}
 
+void UHubSocketSystem::StopReconnectTimer()
+{
+	if (Timers.Cancel(ReconnectTimer))
+	{
 		CurrentReconnectTimeInterval = GetDefault<USocketSettings>()->ReconnectTimeStartInterval;
 
-		Services->ReauthorizeServices();
+		// resumed session skips credentials, see ResumeSession
+		if (Session.IsActive() == false)
+		{
+			Services->ReauthorizeServices();
+		}
 
 		LOG("Stop reconnecting timer");
 	}
@@ -305,7 +1039,7 @@ void UHubSocketSystem::OnConnected()
 
 	/** after connect we waiting first message from hub
 	 * for identify connection as enstablised
-	 * see OnMessage */
+	 * see HandleFrame */
 }
 
 void UHubSocketSystem::OnClosed(int32 StatusCode, const FString& Reason, bool bWasClean)
@@ -326,6 +1060,19 @@ void UHubSocketSystem::OnClosed(int32 StatusCode, const FString& Reason, bool bW
 
 void UHubSocketSystem::StopCommunication()
 {
+	// socket is already disconnected here, batched messages go back to queue
+	FlushOutboundBatch();
+
+	// lanes share authorization of control connection, they are opened again when it is established
+	StopBulkLanes();
+	Liveness.Stop();
+
+	// tail of the frame will never come
+	RawMessageBuffer.Reset();
+
+	// hub may not have journaled messages it did not confirm, they are replayed after next authorization
+	JournalInFlight = 0;
+
 	SetConnectionState(EBFSocketConnectionState::Closed);
 
 	Services->StopServices();
@@ -340,38 +1087,130 @@ void UHubSocketSystem::OnConnectionError(const FString& ErrorString)
 	StartReconnectTimer();
 }
 
-void UHubSocketSystem::OnMessageSent(const FString& MessageString)
+void UHubSocketSystem::OnFrameSent(const TConstArrayView<uint8> Frame)
 {
-	NetLog::LogMessage(ELogVerbosity::Verbose, "Message Sent: {0}", MessageString);
+	// frames are sent as raw bytes, conversion for the log is paid only when it is visible
+	if (UE_LOG_ACTIVE(BFHubSocketSystem, Verbose))
+	{
+		NetLog::LogMessage(ELogVerbosity::Verbose, "Message Sent: {0}", WireSerializer->ToDebugString(Frame));
+	}
 	MessageSentDelegate.Broadcast();
 }
 
-void UHubSocketSystem::OnMessage(const FString& MessageString)
+bool UHubSocketSystem::TryEstablishConnection()
 {
-	if (ConnectionState == EBFSocketConnectionState::Connected)
+	if (ConnectionState != EBFSocketConnectionState::Connected)
 	{
-		LOG("First message received - connection established");
+		return false;
+	}
+
+	LOG("First message received - connection established");
+
+	SetConnectionState(EBFSocketConnectionState::Established);
+
+	Services->StartServices();
+	StartBulkLanes();
+
+	if (GetDefault<USocketSettings>()->bLivenessCheckEnabled)
+	{
+		Liveness.Start(FPlatformTime::Seconds());
+	}
+
+	if (Session.IsActive())
+	{
+		ResumeSession();
+	}
+	return true;
+}
+
+bool UHubSocketSystem::CanReceiveMessages() const
+{
+	return ConnectionState == EBFSocketConnectionState::Established || ConnectionState == EBFSocketConnectionState::Authorized;
+}
 
-		SetConnectionState(EBFSocketConnectionState::Established);
+void UHubSocketSystem::HandleFrame(const TConstArrayView<uint8> Frame)
+{
+	SCOPE_CYCLE_COUNTER(STAT_BFHub_HandleFrame);
+	BFHUB_TRACE_SCOPE(BFHub_HandleFrame);
 
-		Services->StartServices();
+	if (TryEstablishConnection())
+	{
 		return;
 	}
 
-	if (ConnectionState == EBFSocketConnectionState::Established || ConnectionState == EBFSocketConnectionState::Authorized)
+	// decompressed frame may be json even on MessagePack connection
+	const IHubWireSerializer& Serializer = IHubWireSerializer::GetForFrame(Frame);
+
+	if (CanReceiveMessages())
 	{
-		NetLog::LogMessage(ELogVerbosity::Verbose, "Message Received: {0}", MessageString);
+		if (UE_LOG_ACTIVE(BFHubSocketSystem, Verbose))
+		{
+			NetLog::LogMessage(ELogVerbosity::Verbose, "Message Received: {0}", Serializer.ToDebugString(Frame));
+		}
 
-		FHubResponseMessageHeader Header;
-		if (TryConvertMessageToHeader(MessageString, Header))
+		if (Serializer.DecodeFrame(Frame, DecodeArena, [this](const FHubMessageEnvelope& Envelope) { HandleMessageData(Envelope); }) == false)
 		{
-			HandleMessageData(Header);
+			ERROR("Failed to parse {0} frame: {1}", EnumValueToString(Serializer.GetFormat()), Serializer.ToDebugString(Frame));
 		}
+
+		// handlers copied payloads they keep (FHubOwnedMessagePayload)
+		DecodeArena.Reset();
+	}
+	else
+	{
+		WARNING("Skip handle frame of {0} bytes, connection state: {1}", Frame.Num(), EnumValueToString(ConnectionState));
+	}
+}
+
+void UHubSocketSystem::OnRawMessage(const void* Data, const SIZE_T Size, const SIZE_T BytesRemaining)
+{
+	// every fragment counts, big frame being received proves connection is alive
+	Liveness.OnReceived(FPlatformTime::Seconds());
+
+	// whole frame in one fragment is handled straight from socket buffer
+	if (RawMessageBuffer.IsEmpty() && BytesRemaining == 0)
+	{
+		HandleRawFrame(TConstArrayView<uint8>(static_cast<const uint8*>(Data), static_cast<int32>(Size)));
+		return;
+	}
+
+	if (RawMessageBuffer.Max() == 0)
+	{
+		RawMessageBuffer = FHubBufferPool::Get().Acquire();
+	}
+	RawMessageBuffer.Append(static_cast<const uint8*>(Data), Size);
+
+	if (BytesRemaining > 0)
+	{
+		return;
+	}
+
+	// taken out of the member, next frame starts from empty buffer whatever pool does with this one
+	TArray<uint8> Frame = MoveTemp(RawMessageBuffer);
+	HandleRawFrame(Frame);
+	FHubBufferPool::Get().Release(MoveTemp(Frame));
+}
+
+void UHubSocketSystem::HandleRawFrame(const TConstArrayView<uint8> Frame)
+{
+	if (FHubFrameCompression::IsCompressedFrame(Frame.GetData(), Frame.Num()) == false)
+	{
+		HandleFrame(Frame);
+		return;
+	}
+
+	BFHUB_TRACE_SCOPE(BFHub_DecompressFrame);
+
+	TArray<uint8> Decompressed = FHubBufferPool::Get().Acquire();
+	if (FHubFrameCompression::Decompress(Frame.GetData(), Frame.Num(), Decompressed))
+	{
+		HandleFrame(Decompressed);
 	}
 	else
 	{
-		WARNING("Skip handle message: {0}, connection state: {1}", MessageString, EnumValueToString(ConnectionState));
+		ERROR("Failed to decompress frame of {0} bytes", Frame.Num());
 	}
+	FHubBufferPool::Get().Release(MoveTemp(Decompressed));
 }
 
 void UHubSocketSystem::OnAuthorized()
@@ -379,10 +1218,119 @@ void UHubSocketSystem::OnAuthorized()
 	LOG("Authorized on hub completed!");
 
 	SetConnectionState(EBFSocketConnectionState::Authorized);
+	AuthorizeBulkLanes();
 
 	Services->StartAuthorizedServices();
 }
 
+void UHubSocketSystem::TickLiveness(const double Now)
+{
+	if (Liveness.IsActive() == false)
+	{
+		return;
+	}
+
+	UBFHubService_Ping* PingService = Services->GetService<UBFHubService_Ping>();
+	if (PingService == nullptr)
+	{
+		return;
+	}
+
+	// slow connection gets longer wait than fast one
+	const double BeatTimeout = PingService->GetRequestTimeout(GetDefault<USocketSettings>()->LivenessBeatTimeoutSeconds);
+
+	switch (Liveness.Tick(Now, BeatTimeout))
+	{
+	case FHubLiveness::EAction::SendBeat:
+		VERBOSE("No messages from hub for {0} seconds, sending heartbeat", Liveness.GetSilence(Now));
+		PingService->SendPing();
+		break;
+	case FHubLiveness::EAction::Dead:
+		ERROR("No messages from hub for {0} seconds, connection is dead", Liveness.GetSilence(Now));
+		OnConnectionDead();
+		break;
+	default:
+		break;
+	}
+}
+
+void UHubSocketSystem::OnConnectionDead()
+{
+	StopCommunication();
+
+	// half-open socket may never report close, new one is created for reconnect
+	CreateSocket();
+	StartReconnectTimer();
+}
+
+bool UHubSocketSystem::IsSessionSequencing() const
+{
+	return Session.IsActive() && ConnectionState == EBFSocketConnectionState::Authorized;
+}
+
+void UHubSocketSystem::OnSessionStarted(const FHubSessionData& Data)
+{
+	if (Data.Token.IsEmpty())
+	{
+		WARNING("Hub session issued with empty token");
+		return;
+	}
+
+	LOG("Hub session started, reconnect will resume it");
+	Session.Start(Data.Token);
+	AuthorizeBulkLanes();
+}
+
+void UHubSocketSystem::ResumeSession()
+{
+	LOG("Resuming hub session, last received message: {0}", Session.GetLastInboundSeq());
+
+	Request<FHubSessionResumeResponse>(ResumeAction, FHubSessionResumeRequest{Session.GetToken(), Session.GetLastInboundSeq()})
+		.Next([WeakThis = TWeakObjectPtr<UHubSocketSystem>(this)](const THubRequestResult<FHubSessionResumeResponse>& Result)
+		{
+			if (UHubSocketSystem* This = WeakThis.Get())
+			{
+				This->OnSessionResumed(Result);
+			}
+		});
+}
+
+void UHubSocketSystem::OnSessionResumed(const THubRequestResult<FHubSessionResumeResponse>& Result)
+{
+	// connection is lost again, next reconnect resumes
+	if (ConnectionState != EBFSocketConnectionState::Established || Session.IsActive() == false)
+	{
+		return;
+	}
+
+	TConstArrayView<TArray<uint8>> Replay;
+	if (Result.IsSuccess() == false || Session.Resume(Result.Data.Ack, Replay) == false)
+	{
+		WARNING("Hub session can't be resumed ({0}), authorizing again", Result.IsSuccess() ? TEXT("missed messages are not kept") : *EnumValueToString(Result.Status));
+
+		Session.Reset();
+		Services->ReauthorizeServices();
+		return;
+	}
+
+	LOG("Hub session resumed, replaying {0} messages", Replay.Num());
+
+	// replayed messages keep their numbers, they go before queued ones
+	const USocketSettings* Settings = GetDefault<USocketSettings>();
+	const int32 MessagesPerFrame = Settings->bBatchingEnabled ? Settings->MaxBatchMessages : 1;
+	for (int32 Index = 0; Index < Replay.Num(); Index += MessagesPerFrame)
+	{
+		SendBatchFrame(Replay.Slice(Index, FMath::Min(MessagesPerFrame, Replay.Num() - Index)), 0);
+	}
+
+	OnAuthorized();
+}
+
+bool UHubSocketSystem::IsVerboseLogActive()
+{
+	return UE_LOG_ACTIVE(BFHubSocketSystem, Verbose);
+}
+
 void UHubSocketSystem::LogVerbose(const FString& Message)
 {
 	VERBOSE("{0}", Message);
@@ -398,52 +1346,124 @@ void UHubSocketSystem::LogError(const FString& Message)
 	ERROR("{0}", Message);
 }
 
-bool UHubSocketSystem::TryConvertMessageToHeader(const FString& MessageString, FHubResponseMessageHeader& Header) const
+void UHubSocketSystem::HandleMessageData(const FHubMessageEnvelope& Envelope)
 {
-	TSharedPtr<FJsonObject> JsonObject;
-	const TSharedRef<TJsonReader<>> JsonReader = TJsonReaderFactory<>::Create(MessageString);
+	BFHUB_TRACE_SCOPE(BFHub_HandleMessageData);
 
-	if (!FJsonSerializer::Deserialize(JsonReader, JsonObject) || !JsonObject.IsValid())
+	if (Session.IsActive())
 	{
-		ERROR("Failed to parse message: {0}, this is not json!", MessageString);
-		return false;
+		Session.Acknowledge(Envelope.Ack);
+		if (Session.AcceptInbound(Envelope.Seq) == false)
+		{
+			VERBOSE("Skip replayed message {0} with method \"{1}\"", Envelope.Seq, Envelope.Method);
+			return;
+		}
 	}
 
-	if (!FJsonObjectConverter::JsonObjectToUStruct(JsonObject.ToSharedRef(), FHubResponseMessageHeader::StaticStruct(), &Header))
+	if (Envelope.RequestId != 0 && PendingRequests.Contains(Envelope.RequestId))
 	{
-		ERROR("Header structures not match for message: {0}", MessageString);
-		return false;
+		if (InboundDispatcher->IsIdle())
+		{
+			CompletePendingRequest(Envelope.RequestId, Envelope.Type, Envelope.Payload);
+			return;
+		}
+
+		InboundDispatcher->Dispatch([this, RequestId = Envelope.RequestId, Type = Envelope.Type, Payload = FHubOwnedMessagePayload(Envelope.Payload)]()
+		{
+			CompletePendingRequest(RequestId, Type, Payload.GetView());
+		});
+		return;
 	}
 
-	return true;
+	const int32 ActionId = ActionRegistry.Find(Envelope.Controller, Envelope.Method);
+	const TSharedPtr<FBaseMessageHandle> Handler = ActionId != FHubActionRegistry::InvalidId ? Handlers[ActionId] : TSharedPtr<FBaseMessageHandle>();
+	if (Handler.IsValid() == false)
+	{
+		ERROR("Not found handler for: {0}", FString(Envelope.Method));
+		return;
+	}
+
+	const FHubServiceAction& Action = ActionRegistry.GetAction(ActionId);
+	ActionMetrics[ActionId]->RecordIn(Envelope.Payload.GetSize());
+	BFHUB_TRACE_SCOPE_TEXT(*Action.Method);
+
+	if (Envelope.Type != EHubMessageType::ERROR && Handler->DecodeThread == EHubDecodeThread::Worker)
+	{
+		DecodeMessageDataOnWorker(Handler, Action.Method, Envelope.Payload);
+		return;
+	}
+
+	if (InboundDispatcher->IsIdle())
+	{
+		DispatchMessageData(*Handler, Envelope.Type, Action.Method, Envelope.Payload);
+		return;
+	}
+
+	// messages in front of this one still decoding on worker, payload copied to keep arrival order
+	InboundDispatcher->Dispatch([this, Handler, Type = Envelope.Type, Method = Action.Method, Payload = FHubOwnedMessagePayload(Envelope.Payload)]()
+	{
+		DispatchMessageData(*Handler, Type, Method, Payload.GetView());
+	});
+}
+
+void UHubSocketSystem::DecodeMessageDataOnWorker(const TSharedPtr<FBaseMessageHandle>& Handler, const FString& Method, const FHubMessagePayload& Payload)
+{
+	const uint64 Slot = InboundDispatcher->Reserve();
+
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [Handler, Slot, Method, WeakDispatcher = TWeakPtr<FHubOrderedDispatcher>(InboundDispatcher), Payload = FHubOwnedMessagePayload(Payload)]()
+	{
+		BFHUB_TRACE_SCOPE(BFHub_DecodeOnWorker);
+
+		TUniquePtr<FHubDecodedMessage> Message = Handler->DecodeMessage(Payload.GetView());
+		if (Message.IsValid() == false)
+		{
+			// slot is still completed, messages behind this one must not wait for it
+			ERROR("Failed to decode message for {0} with data: {1}", Method, Payload.GetView().ToString());
+		}
+
+		if (const TSharedPtr<FHubOrderedDispatcher> Dispatcher = WeakDispatcher.Pin())
+		{
+			Dispatcher->Complete(Slot, [Handler, Message = MoveTemp(Message)]()
+			{
+				if (Message.IsValid())
+				{
+					Handler->DispatchMessage(*Message);
+				}
+			});
+		}
+	});
 }
 
-void UHubSocketSystem::HandleMessageData(const FHubResponseMessageHeader& Header)
+void UHubSocketSystem::CompletePendingRequest(const int64 RequestId, const EHubMessageType Type, const FHubMessagePayload& Payload)
 {
-	if (Handlers.Contains(Header) == false)
+	const EHubRequestStatus Status = Type == EHubMessageType::ERROR ? EHubRequestStatus::Error : EHubRequestStatus::Success;
+	if (PendingRequests.Complete(RequestId, Status, &Payload) == false)
 	{
-		ERROR("Not found handler for: {0}", Header.Method);
-		return;
+		// timed out while waiting in inbound order
+		WARNING("Response for request {0} came too late", RequestId);
 	}
+}
 
-	if (Header.Type == EHubMessageType::ERROR)
+void UHubSocketSystem::DispatchMessageData(FBaseMessageHandle& Handler, const EHubMessageType Type, const FString& Method, const FHubMessagePayload& Payload)
+{
+	if (Type == EHubMessageType::ERROR)
 	{
 		FHubErrorData ErrorData;
-		ErrorData.RawData = Header.Data;
-		if (FJsonObjectConverter::JsonObjectStringToUStruct(Header.Data, &ErrorData))
+		ErrorData.RawData = Payload.ToString();
+		if (Payload.ReadStruct(ErrorData))
 		{
-			ERROR("Got error message for {0} with code: {1}, message: {2}", Header.Method, EnumValueToString(ErrorData.Code), ErrorData.ErrorMessage);
+			ERROR("Got error message for {0} with code: {1}, message: {2}", Method, EnumValueToString(ErrorData.Code), ErrorData.ErrorMessage);
 
-			Handlers[Header]->HandleError(ErrorData);
+			Handler.HandleError(ErrorData);
 		}
 		else
 		{
-			ERROR("Got error message for {0} with wrong data: {1}", Header.Method, Header.Data);
+			ERROR("Got error message for {0} with wrong data: {1}", Method, ErrorData.RawData);
 		}
 	}
-	else
+	else if (Handler.HandleMessage(Payload) == false)
 	{
-		Handlers[Header]->HandleMessage(Header.Data);
+		ERROR("Failed to decode message for {0} with data: {1}", Method, Payload.ToString());
 	}
 }
 
@@ -4,18 +4,43 @@
 
 #include "CoreMinimal.h"
 #include "JsonObjectConverter.h"
+#include "Containers/Ticker.h"
+#include "HubActionMetrics.h"
+#include "HubActionPolicy.h"
+#include "HubActionRegistry.h"
+#include "HubBufferPool.h"
+#include "HubConnectionLane.h"
+#include "HubDecodeArena.h"
+#include "HubLiveness.h"
+#include "HubMessageBatch.h"
+#include "HubMessageEncoder.h"
+#include "HubMessageEnvelope.h"
+#include "HubOrderedDispatcher.h"
+#include "HubOutboundJournal.h"
+#include "HubOutboundQueue.h"
+#include "HubPendingRequests.h"
+#include "HubSession.h"
+#include "HubSocketTrace.h"
+#include "HubTimerWheel.h"
+#include "HubWireSerializer.h"
 #include "MessageHandle.h"
 #include "ServiceLocator.h"
 #include "HubServicesBaseData.h"
 #include "SocketSettings.h"
 #include "HelpersPlugin/Helpers/GetHelpers.h"
+#include "Async/Future.h"
+#include "Tasks/Task.h"
 #include "HubSocketSystem.generated.h"
 
 class IWebSocket;
 
+// Creates transport of socket system for url and websocket subprotocol
+using FHubSocketFactory = TFunction<TSharedPtr<IWebSocket>(const FString& Url, const FString& Protocol)>;
+
 DECLARE_LOG_CATEGORY_EXTERN(BFHubSocketSystem, Log, All);
 
 DECLARE_MULTICAST_DELEGATE(FMessageSentDelegate);
+DECLARE_MULTICAST_DELEGATE_OneParam(FOutboundBackpressureDelegate, bool /*bActive*/);
 
 UENUM(BlueprintType)
 enum class EBFSocketConnectionState : uint8
@@ -30,6 +55,19 @@ enum class EBFSocketConnectionState : uint8
 	WaitingForReconnect,
 };
 
+UENUM(BlueprintType)
+enum class EHubSendResult : uint8
+{
+	// Handed to the socket
+	Sent,
+	// Socket not ready, will be sent after connection/authorization
+	Queued,
+	// Message can't be serialized
+	Failed,
+	// Outbound queue is full and drop policy of the action rejected message
+	Dropped,
+};
+
 /**
  * Socket system send and receive messages to hub server, delegate data structs to services and handle connection
  */
@@ -52,16 +90,40 @@ public:
 	void StartConnectionSettingsUrl();
 	void StartConnection(const FString& Url);
 
+	/** Transport of sockets created after the call, shared by socket systems of the process; empty factory restores default
+	 * Default creates network websocket, or FHubLoopbackWebSocket for loopback:// url in non shipping builds */
+	static void SetSocketFactory(FHubSocketFactory Factory);
+
+	template <typename T>
+	EHubSendResult Send(const FHubServiceAction& Key, const T& InStructure);
+
+	/** Struct moved to worker thread and serialized there, message order with other sends is preserved
+	 * Future resolved on game thread when message sent, queued or failed */
 	template <typename T>
-	void Send(const FHubServiceAction& Key, const T& InStructure);
+	TFuture<EHubSendResult> SendAsync(const FHubServiceAction& Key, T&& InStructure);
+
+	/** Request with id, the future is resolved on game thread by response or error with the same id, or by timeout
+	 * Correlated answers are not broadcast to action handlers, several requests of one action can be in flight
+	 * TimeoutSeconds <= 0 uses USocketSettings::RequestTimeoutSeconds */
+	template <typename TResponse, typename TRequest>
+	TFuture<THubRequestResult<TResponse>> Request(const FHubServiceAction& Key, const TRequest& InStructure, float TimeoutSeconds = 0.0f);
 
+	/** DecodeThread::Worker moves payload decoding off the game thread for this action, broadcast stays on game thread
+	 * Once requested by any binding, it stays enabled for the action */
 	template <typename TStruct>
-	typename FCallbackMessageHandle<TStruct>::FOnCallback& Bind(const FHubServiceAction& Key);
+	typename FCallbackMessageHandle<TStruct>::FOnCallback& Bind(const FHubServiceAction& Key, EHubDecodeThread DecodeThread = EHubDecodeThread::GameThread);
 
 	FCallbackErrorHandle::FOnError& BindError(const FHubServiceAction& Key);
 
 	void Unbind(const FHubServiceAction& Key);
 
+	void SetActionPolicy(const FHubServiceAction& Key, const FHubActionPolicy& Policy);
+	const FHubActionPolicy& GetActionPolicy(const FHubServiceAction& Key) const;
+
+	// Message counts, bytes and timings of every action, most expensive on game thread first (BFHub.Metrics)
+	void LogActionMetrics() const;
+	void ResetActionMetrics();
+
 	// Register or Get service by type
 	template <typename T>
 	static T* GetService(const UObject* WorldContextObject);
@@ -72,6 +134,9 @@ public:
 	// Deprecated! use GetService for registration and getting services
 	UServiceLocator* GetServicesLocator();
 
+	// Timers of socket system and its services, fired from socket system tick on game thread, do not need world
+	FHubTimerWheel& GetTimers() { return Timers; }
+
 
 	DECLARE_DYNAMIC_MULTICAST_DELEGATE_OneParam(FOnConnectionStateChanged, EBFSocketConnectionState, State);
 
@@ -85,6 +150,10 @@ public:
 	}
 
 private:
+	// Drive send and receive path against loopback socket, see HubLoopbackBenchmark.cpp and HubSocketSystemTests.cpp
+	friend class FHubLoopbackBenchmark;
+	friend class FHubSocketSystemTestHarness;
+
 	TSharedPtr<IWebSocket> Socket;
 	FString ConnectionURL;
 
@@ -95,20 +164,105 @@ private:
 
 	UPROPERTY()
 	UServiceLocator* Services;
-	TMap<FHubServiceAction, TSharedPtr<FBaseMessageHandle>> Handlers;
+
+	// handlers, policies and metrics indexed by action id
+	FHubActionRegistry ActionRegistry;
+	TArray<TSharedPtr<FBaseMessageHandle>> Handlers;
+	TArray<FHubActionPolicy> ActionPolicies;
+	TArray<TSharedPtr<FHubActionMetrics>> ActionMetrics;
+	int32 RegisterAction(const FHubServiceAction& Key);
+	// Sent actions are registered too, to have metrics
+	const TSharedPtr<FHubActionMetrics>& GetActionMetrics(const FHubServiceAction& Key) { return ActionMetrics[RegisterAction(Key)]; }
+	double LastMetricsLogTime = 0.0;
+
+	// keeps arrival order of inbound messages when some of them decoded on worker threads
+	TSharedPtr<FHubOrderedDispatcher> InboundDispatcher;
+
+	// send queue, keeps order of outbound messages when some of them serialized on worker threads
+	TSharedPtr<FHubOrderedDispatcher> OutboundDispatcher;
+
+	FHubOutboundBatch OutboundBatch;
+	// Batches of all lanes
+	void FlushOutboundBatch();
+	void FlushOutboundBatch(int32 Lane);
+	FHubOutboundBatch& GetOutboundBatch(int32 Lane);
+	// Flush of the lane batch at the end of batching window, when its first message is added
+	void ScheduleBatchFlush(int32 Lane);
+
+	// Bulk connections, lane N is BulkLanes[N - 1]
+	TArray<TUniquePtr<FHubConnectionLane>> BulkLanes;
+	void CreateBulkLanes();
+	void StartBulkLanes();
+	void StopBulkLanes();
+	// Lane of the policy if it is ready and authorized for actions with RequiredAuth, control connection (0) otherwise
+	int32 GetSendLane(const FHubServiceAction& Key, const FHubActionPolicy& Policy) const;
+	FHubServiceAction LaneAttachAction;
+	// Attaches established lanes to the session once control connection is authorized and session has token
+	void AuthorizeBulkLanes();
+	void AuthorizeLane(FHubConnectionLane& Lane);
+
+	// declared before users of it, they cancel timers on destruction
+	FHubTimerWheel Timers;
+
+	FHubPendingRequests PendingRequests{Timers};
+	void CompletePendingRequest(int64 RequestId, EHubMessageType Type, const FHubMessagePayload& Payload);
+
+	// Resumable session, active only when enabled in settings and hub issued token
+	FHubSession Session;
+	FHubServiceAction SessionAction;
+	FHubServiceAction ResumeAction;
+	// Messages of control connection are numbered while session is authorized
+	bool IsSessionSequencing() const;
+	void OnSessionStarted(const FHubSessionData& Data);
+	void ResumeSession();
+	void OnSessionResumed(const THubRequestResult<FHubSessionResumeResponse>& Result);
+
+	FTSTicker::FDelegateHandle TickerHandle;
+	bool Tick(float DeltaTime);
+
+	// Heartbeats of silent control connection, dead one is replaced by reconnect
+	FHubLiveness Liveness;
+	void TickLiveness(double Now);
+	void OnConnectionDead();
+
+	// chosen from settings when socket is created, connection keeps it until reconnect
+	const IHubWireSerializer* WireSerializer = nullptr;
 
 	// will be increase if reconnect fail
 	float CurrentReconnectTimeInterval = GetDefault<USocketSettings>()->ReconnectTimeStartInterval;
-	FTimerHandle ReconnectTimerHandle;
+	FHubTimerHandle ReconnectTimer;
+	// Repeats with the same interval until connected or stopped
+	void ScheduleReconnect(float Interval);
 
-	void EnqueueMessage(const FHubServiceAction& Key, const FString& InRawMessage);
-	TQueue<FString> QueuedNonAuthMessages;
-	TQueue<FString> QueuedMessages;
+	// Requests (RequestId set) are never spilled to journal: request ids start from 1 in every run, so answer to a request replayed
+	// by the next run would complete unrelated request of that run
+	EHubSendResult EnqueueMessage(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId = 0);
+
+	// Set only for actions with CollapseLatest policy, sub key is taken from request struct if policy has it
+	template <typename T>
+	TOptional<FHubCoalescingKey> GetCoalescingKey(const FHubServiceAction& Key, const T& InStructure) const;
+	FHubOutboundQueue OutboundQueue;
+	// spill of OutboundQueue, optional
+	FHubOutboundJournal OutboundJournal;
+	// most important class which has messages in the journal, Num - none
+	EHubOutboundPriority JournalPriority = EHubOutboundPriority::Num;
+	// oldest journal records sent on this connection and not confirmed by hub yet
+	int32 JournalInFlight = 0;
+	FHubServiceAction JournalAckAction;
+	void OnJournalAcknowledged(const FHubJournalAckData& Data);
+	void OpenOutboundJournal();
+	// Moves the least important messages from the queue to the journal until IncomingBytes fit under OutboundJournalSpillBytes
+	void SpillOutboundOverflow(int64 IncomingBytes);
+	static constexpr int32 MaxOutboundJournalSlots = 16;
+	// Sends queued messages within per tick budget, rest is sent on next ticks
 	void TrySendQueuedMessages();
-	void DequeueMessages(TQueue<FString>& Queue) const;
 	bool IsConnected() const;
 
+	bool bOutboundBackpressure = false;
+	void UpdateBackpressure();
+
 	FMessageSentDelegate MessageSentDelegate;
+	FOutboundBackpressureDelegate OutboundBackpressureDelegate;
 
 public:
 	void SubscribeToMessageSentEvent(const FMessageSentDelegate::FDelegate& Delegate)
@@ -116,18 +270,50 @@ public:
 		MessageSentDelegate.Add(Delegate);
 	}
 
+	// Broadcast when outbound queue passes high watermark (true) and when it falls below low watermark (false)
+	FDelegateHandle SubscribeToOutboundBackpressure(const FOutboundBackpressureDelegate::FDelegate& Delegate)
+	{
+		return OutboundBackpressureDelegate.Add(Delegate);
+	}
+
+	void UnsubscribeFromOutboundBackpressure(const FDelegateHandle& Handle)
+	{
+		OutboundBackpressureDelegate.Remove(Handle);
+	}
+
+	// Services should skip optional traffic (telemetry) while queue is under pressure
+	bool IsOutboundBackpressured() const { return bOutboundBackpressure; }
+
 private:
 	void CreateServicesLocator();
 	void CreateSocket();
+	static TSharedPtr<IWebSocket> CreateDefaultSocket(const FString& Url, const FString& Protocol);
+	static FHubSocketFactory SocketFactory;
 	void Connect();
 	void StartReconnectTimer();
 	void StopReconnectTimer();
 	void StopCommunication();
 
-	bool TrySend(const FString& InRawString) const;
-
-	bool TryConvertMessageToHeader(const FString& MessageString, FHubResponseMessageHeader& Header) const;
-	void HandleMessageData(const FHubResponseMessageHeader& Header);
+	// Message buffers are owned by send path and go back to FHubBufferPool after they are handed to socket
+	bool TrySend(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId = 0);
+	// Single message sent as is, several combined into batch frame; numbered by session first
+	void SendMessages(TConstArrayView<TArray<uint8>> InMessages, int32 Lane = 0);
+	void SendBatchFrame(TConstArrayView<TArray<uint8>> InMessages, int32 Lane);
+	void SendFrame(const TArray<uint8>& InFrame, int32 Lane = 0);
+	void SendToSocket(const TArray<uint8>& InFrame, bool bBinary, int32 Lane);
+	FHubEncodeOptions MakeEncodeOptions() const;
+	// Keeps order with async messages which are still serializing
+	EHubSendResult SendInOrder(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId = 0);
+	EHubSendResult SendMessage(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId = 0);
+	void DispatchSendMessage(const FHubServiceAction& Key, TArray<uint8>&& InMessage, const TOptional<FHubCoalescingKey>& CoalescingKey, int64 RequestId);
+
+	// First message from hub only marks connection as established
+	bool TryEstablishConnection();
+	bool CanReceiveMessages() const;
+	void HandleFrame(TConstArrayView<uint8> Frame);
+	void HandleMessageData(const FHubMessageEnvelope& Envelope);
+	void DecodeMessageDataOnWorker(const TSharedPtr<FBaseMessageHandle>& Handler, const FString& Method, const FHubMessagePayload& Payload);
+	void DispatchMessageData(FBaseMessageHandle& Handler, EHubMessageType Type, const FString& Method, const FHubMessagePayload& Payload);
 
 	UFUNCTION()
 	void OnConnected();
@@ -138,15 +324,20 @@ private:
 	UFUNCTION()
 	void OnConnectionError(const FString& ErrorString);
 
-	UFUNCTION()
-	void OnMessageSent(const FString& MessageString);
+	void OnFrameSent(TConstArrayView<uint8> Frame);
 
-	UFUNCTION()
-	void OnMessage(const FString& MessageString);
+	// Every frame (json text, MessagePack, compressed) comes here as bytes, fragments are reassembled in pooled buffer
+	void OnRawMessage(const void* Data, SIZE_T Size, SIZE_T BytesRemaining);
+	void HandleRawFrame(TConstArrayView<uint8> Frame);
+	TArray<uint8> RawMessageBuffer;
+	// Scratch of envelopes of the frame being handled, reset after every frame
+	FHubDecodeArena DecodeArena;
 
 	UFUNCTION()
 	void OnAuthorized();
 
+	// Verbose messages of header templates are formatted only when they are visible
+	static bool IsVerboseLogActive();
 	void LogVerbose(const FString& Message);
 	void LogWarning(const FString& Message);
 	void LogError(const FString& Message);
@@ -170,28 +361,31 @@ T* UHubSocketSystem::GetService()
 }
 
 template <typename T>
-void UHubSocketSystem::Send(const FHubServiceAction& Key, const T& Data)
+EHubSendResult UHubSocketSystem::Send(const FHubServiceAction& Key, const T& Data)
 {
-	// Workaround for linker error because we cant use LogCategory which defined in cpp from main game module 
-	LogVerbose(FString::Printf(TEXT("Sending request with method \"%s\""), *Key.Method));
+	BFHUB_TRACE_SCOPE(BFHub_Send);
+	BFHUB_TRACE_SCOPE_TEXT(*Key.Method);
 
-	FHubRequestMessageHeader Message;
-	//we can't send controller as enum name like "EVENT" because hub expect int value
-	Message.Controller = static_cast<int32>(Key.Controller);
-	Message.Method = Key.Method;
-
-	if (FJsonObjectConverter::UStructToJsonObjectString(Data, Message.Data, 0, 0, 0, nullptr, false) == false)
+	// Workaround for linker error because we cant use LogCategory which defined in cpp from main game module 
+	if (IsVerboseLogActive())
 	{
-		LogError(FString::Printf(TEXT("Failed to setup data for method \"%s\""), *Key.Method));
-		return;
+		LogVerbose(FString::Printf(TEXT("Sending request with method \"%s\""), *Key.Method));
 	}
 
-	FString StringToSend;
-	if (FJsonObjectConverter::UStructToJsonObjectString(Message, StringToSend, 0, 0, 0, nullptr, false) == false)
+	FHubActionMetrics& Metrics = *GetActionMetrics(Key);
+	TArray<uint8> MessageToSend = FHubBufferPool::Get().Acquire();
+	bool bEncoded = false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BFHub_Encode);
+		FHubMetricScope EncodeScope(&Metrics, EHubActionMetric::Encode);
+		bEncoded = FHubMessageEncoder::Encode(Key, Data, MakeEncodeOptions(), MessageToSend);
+	}
+	if (bEncoded == false)
 	{
-		LogError(FString::Printf(TEXT("Failed to setup header for method \"%s\""), *Key.Method));
-		return;
+		LogError(FString::Printf(TEXT("Failed to setup message for method \"%s\""), *Key.Method));
+		return EHubSendResult::Failed;
 	}
+	Metrics.RecordOut(MessageToSend.Num());
 
 #if WITH_EDITOR
 	if (GetDefault<USocketSettings>()->bUseFakeResponse)
@@ -199,43 +393,212 @@ void UHubSocketSystem::Send(const FHubServiceAction& Key, const T& Data)
 		const FString FakeDataString = GetFakeResponseData<T>(Key);
 		if (FakeDataString.IsEmpty() == false)
 		{
-			FHubResponseMessageHeader ResponseHeader{
-				EHubMessageType::RESPONSE,
-				Key.Controller,
-				Key.Method,
-				FakeDataString
-			};
-
-			if (TryConvertMessageToHeader(FakeDataString, ResponseHeader))
+			FHubMessageEnvelope ResponseEnvelope;
+			ResponseEnvelope.Type = EHubMessageType::RESPONSE;
+			ResponseEnvelope.Controller = Key.Controller;
+			ResponseEnvelope.Method = Key.Method;
+			ResponseEnvelope.Payload.Json = FakeDataString;
+
+			LogWarning(FString::Printf(TEXT("Fake response for method \"%s\""), *Key.Method));
+			HandleMessageData(ResponseEnvelope);
+			FHubBufferPool::Get().Release(MoveTemp(MessageToSend));
+
+			return EHubSendResult::Sent;
+		}
+	}
+#endif
+
+	return SendInOrder(Key, MoveTemp(MessageToSend), GetCoalescingKey(Key, Data));
+}
+
+template <typename T>
+TFuture<EHubSendResult> UHubSocketSystem::SendAsync(const FHubServiceAction& Key, T&& InStructure)
+{
+	using FStructType = std::decay_t<T>;
+
+	const TSharedRef<TPromise<EHubSendResult>> Promise = MakeShared<TPromise<EHubSendResult>>();
+	TFuture<EHubSendResult> Future = Promise->GetFuture();
+
+#if WITH_EDITOR
+	if (GetDefault<USocketSettings>()->bUseFakeResponse)
+	{
+		Promise->SetValue(Send(Key, InStructure));
+		return Future;
+	}
+#endif
+
+	BFHUB_TRACE_SCOPE(BFHub_SendAsync);
+
+	if (IsVerboseLogActive())
+	{
+		LogVerbose(FString::Printf(TEXT("Sending async request with method \"%s\""), *Key.Method));
+	}
+
+	const uint64 Slot = OutboundDispatcher->Reserve();
+	const FHubEncodeOptions Options = MakeEncodeOptions();
+	const TOptional<FHubCoalescingKey> CoalescingKey = GetCoalescingKey(Key, InStructure);
+
+	UE::Tasks::Launch(UE_SOURCE_LOCATION, [WeakThis = TWeakObjectPtr<UHubSocketSystem>(this), WeakDispatcher = TWeakPtr<FHubOrderedDispatcher>(OutboundDispatcher),
+		Slot, Key, Options, CoalescingKey, Promise, Metrics = GetActionMetrics(Key), Data = FStructType(Forward<T>(InStructure))]()
+	{
+		BFHUB_TRACE_SCOPE(BFHub_EncodeAsync);
+		BFHUB_TRACE_SCOPE_TEXT(*Key.Method);
+
+		TArray<uint8> MessageToSend = FHubBufferPool::Get().Acquire();
+		bool bEncoded = false;
+		{
+			SCOPE_CYCLE_COUNTER(STAT_BFHub_Encode);
+			FHubMetricScope EncodeScope(Metrics.Get(), EHubActionMetric::Encode);
+			bEncoded = FHubMessageEncoder::Encode(Key, Data, Options, MessageToSend);
+		}
+		if (bEncoded)
+		{
+			Metrics->RecordOut(MessageToSend.Num());
+		}
+
+		const TSharedPtr<FHubOrderedDispatcher> Dispatcher = WeakDispatcher.Pin();
+		if (Dispatcher.IsValid() == false)
+		{
+			Promise->SetValue(EHubSendResult::Failed);
+			return;
+		}
+
+		Dispatcher->Complete(Slot, [WeakThis, Key, CoalescingKey, bEncoded, Promise, MessageToSend = MoveTemp(MessageToSend)]() mutable
+		{
+			UHubSocketSystem* This = WeakThis.Get();
+			if (This == nullptr)
 			{
-				LogWarning(FString::Printf(TEXT("Fake response for method \"%s\""), *Key.Method));
-				HandleMessageData(ResponseHeader);
+				Promise->SetValue(EHubSendResult::Failed);
+				return;
 			}
 
-			return;
+			if (bEncoded == false)
+			{
+				This->LogError(FString::Printf(TEXT("Failed to setup message for method \"%s\""), *Key.Method));
+				Promise->SetValue(EHubSendResult::Failed);
+				return;
+			}
+
+			Promise->SetValue(This->SendMessage(Key, MoveTemp(MessageToSend), CoalescingKey));
+		});
+	});
+
+	return Future;
+}
+
+template <typename TResponse, typename TRequest>
+TFuture<THubRequestResult<TResponse>> UHubSocketSystem::Request(const FHubServiceAction& Key, const TRequest& InStructure, const float TimeoutSeconds)
+{
+	BFHUB_TRACE_SCOPE(BFHub_Request);
+
+	const TSharedRef<TPromise<THubRequestResult<TResponse>>> Promise = MakeShared<TPromise<THubRequestResult<TResponse>>>();
+	TFuture<THubRequestResult<TResponse>> Future = Promise->GetFuture();
+
+	const float Timeout = TimeoutSeconds > 0.0f ? TimeoutSeconds : GetDefault<USocketSettings>()->RequestTimeoutSeconds;
+
+	FHubEncodeOptions Options = MakeEncodeOptions();
+	Options.RequestId = PendingRequests.Add(Timeout, [Promise](const EHubRequestStatus Status, const FHubMessagePayload* Payload)
+	{
+		THubRequestResult<TResponse> Result;
+		Result.Status = Status;
+
+		if (Payload && Status == EHubRequestStatus::Success && Payload->IsEmpty() == false && Payload->ReadStruct(Result.Data) == false)
+		{
+			Result.Status = EHubRequestStatus::Error;
+			Result.Error.RawData = Payload->ToString();
+		}
+		else if (Payload && Status == EHubRequestStatus::Error)
+		{
+			Result.Error.RawData = Payload->ToString();
+			Payload->ReadStruct(Result.Error);
+		}
+
+		Promise->SetValue(MoveTemp(Result));
+	});
+
+	const FString TraceScopeName = HubSocketTrace::GetRequestScopeName(Options.RequestId, Key.Method);
+	BFHUB_TRACE_SCOPE_TEXT(*TraceScopeName);
+	HubSocketTrace::RequestSent(Options.RequestId, Key.Method);
+
+	if (IsVerboseLogActive())
+	{
+		LogVerbose(FString::Printf(TEXT("Sending request %lld with method \"%s\""), Options.RequestId, *Key.Method));
+	}
+
+#if WITH_EDITOR
+	if (GetDefault<USocketSettings>()->bUseFakeResponse)
+	{
+		const FString FakeDataString = GetFakeResponseData<TRequest>(Key);
+		if (FakeDataString.IsEmpty() == false)
+		{
+			LogWarning(FString::Printf(TEXT("Fake response for method \"%s\""), *Key.Method));
+
+			FHubMessagePayload FakePayload;
+			FakePayload.Json = FakeDataString;
+			PendingRequests.Complete(Options.RequestId, EHubRequestStatus::Success, &FakePayload);
+			return Future;
 		}
 	}
 #endif
 
-	if (Key.RequiredAuth && ConnectionState != EBFSocketConnectionState::Authorized)
+	FHubActionMetrics& Metrics = *GetActionMetrics(Key);
+	TArray<uint8> MessageToSend = FHubBufferPool::Get().Acquire();
+	bool bEncoded = false;
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BFHub_Encode);
+		FHubMetricScope EncodeScope(&Metrics, EHubActionMetric::Encode);
+		bEncoded = FHubMessageEncoder::Encode(Key, InStructure, Options, MessageToSend);
+	}
+	if (bEncoded == false)
+	{
+		LogError(FString::Printf(TEXT("Failed to setup message for method \"%s\""), *Key.Method));
+		PendingRequests.Complete(Options.RequestId, EHubRequestStatus::SendFailed, nullptr);
+		return Future;
+	}
+	Metrics.RecordOut(MessageToSend.Num());
+
+	// queued request is answered after reconnect or times out, it is never replaced by newer one
+	if (SendInOrder(Key, MoveTemp(MessageToSend), NullOpt, Options.RequestId) == EHubSendResult::Dropped)
+	{
+		PendingRequests.Complete(Options.RequestId, EHubRequestStatus::SendFailed, nullptr);
+	}
+	return Future;
+}
+
+template <typename T>
+TOptional<FHubCoalescingKey> UHubSocketSystem::GetCoalescingKey(const FHubServiceAction& Key, const T& InStructure) const
+{
+	const FHubActionPolicy& Policy = GetActionPolicy(Key);
+	if (Policy.DropPolicy != EHubDropPolicy::CollapseLatest)
+	{
+		return NullOpt;
+	}
+	if (Policy.CoalescingSubKey == nullptr)
 	{
-		EnqueueMessage(Key, StringToSend);
-		return;
+		return FHubCoalescingKey();
 	}
-	if (TrySend(StringToSend) == false)
+	if (ensureMsgf(Policy.CoalescingStruct == T::StaticStruct(), TEXT("Coalescing sub key of \"%s\" is set for other struct"), *Key.Method) == false)
 	{
-		EnqueueMessage(Key, StringToSend);
+		return NullOpt;
 	}
+	return Policy.CoalescingSubKey(&InStructure);
 }
 
 template <typename TStruct>
-typename FCallbackMessageHandle<TStruct>::FOnCallback& UHubSocketSystem::Bind(const FHubServiceAction& Key)
+typename FCallbackMessageHandle<TStruct>::FOnCallback& UHubSocketSystem::Bind(const FHubServiceAction& Key, const EHubDecodeThread DecodeThread)
 {
-	if (Handlers.Contains(Key) == false)
+	const int32 ActionId = RegisterAction(Key);
+	TSharedPtr<FBaseMessageHandle>& Handler = Handlers[ActionId];
+	if (Handler.IsValid() == false)
+	{
+		Handler = MakeShareable(new FCallbackMessageHandle<TStruct>());
+		Handler->Metrics = ActionMetrics[ActionId];
+	}
+
+	if (DecodeThread == EHubDecodeThread::Worker)
 	{
-		TSharedPtr<FCallbackMessageHandle<TStruct>> NewHandler = MakeShareable(new FCallbackMessageHandle<TStruct>());
-		Handlers.Add(Key, NewHandler);
+		Handler->DecodeThread = EHubDecodeThread::Worker;
 	}
 
-	return StaticCastSharedPtr<FCallbackMessageHandle<TStruct>>(Handlers.FindChecked(Key))->MessageHandler;
+	return StaticCastSharedPtr<FCallbackMessageHandle<TStruct>>(Handler)->MessageHandler;
 }
@@ -0,0 +1,714 @@
+﻿#include "CoreMinimal.h"
+#include "HubSocketSystem.h"
+#include "HubBufferPool.h"
+#include "HubLoopbackWebSocket.h"
+#include "HubOrderedDispatcher.h"
+#include "HubWireSerializer.h"
+#include "BFHubSockets/Services/GameServerAPI/BFHubService_ServerInit.h"
+#include "Dom/JsonObject.h"
+#include "HAL/FileManager.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+#include "Misc/ScopeExit.h"
+#include "Serialization/JsonReader.h"
+#include "Serialization/JsonSerializer.h"
+#include "UObject/Package.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+/**
+ * Socket system detached from game instance, connected through socket factory to loopback sockets which echo every frame
+ * Goes through real connect, establish, close and reconnect; authorization is given by test, services and liveness are not running
+ * Test drives it frame by frame with Step, reconnect intervals are shortened so StepUntil waits for them in real time
+ */
+class FHubSocketSystemTestHarness
+{
+public:
+	explicit FHubSocketSystemTestHarness(const FHubLoopbackOptions& InOptions = FHubLoopbackOptions())
+		: Options(InOptions)
+	{
+		UHubSocketSystem::SetSocketFactory([this](const FString&, const FString&) -> TSharedPtr<IWebSocket>
+		{
+			return Sockets.Add_GetRef(MakeShared<FHubLoopbackWebSocket>(Options));
+		});
+
+		// the same setup as Initialize, without game instance
+		System = NewObject<UHubSocketSystem>(GetTransientPackage());
+		System->AddToRoot();
+		System->InboundDispatcher = MakeShared<FHubOrderedDispatcher>();
+		System->OutboundDispatcher = MakeShared<FHubOrderedDispatcher>();
+		System->WireSerializer = &IHubWireSerializer::Get(EHubWireFormat::Json);
+		System->OutboundQueue.SetMaxBytes(GetDefault<USocketSettings>()->OutboundQueueMaxBytes);
+		System->Session.SetMaxBytes(GetDefault<USocketSettings>()->SessionReplayMaxBytes);
+		System->CreateServicesLocator();
+
+		if (GetDefault<USocketSettings>()->bSessionResumeEnabled)
+		{
+			System->SessionAction.Fill("session", EHubControllerType::AUTH);
+			System->SessionAction.RequiredAuth = false;
+			System->ResumeAction.Fill("resume", EHubControllerType::AUTH);
+			System->ResumeAction.RequiredAuth = false;
+			System->LaneAttachAction.Fill("lane.attach", EHubControllerType::AUTH);
+			System->LaneAttachAction.RequiredAuth = false;
+
+			FHubActionPolicy ResumePolicy;
+			ResumePolicy.bBypassBatching = true;
+			ResumePolicy.Priority = EHubOutboundPriority::Critical;
+			System->SetActionPolicy(System->ResumeAction, ResumePolicy);
+
+			System->Bind<FHubSessionData>(System->SessionAction).AddUObject(System, &UHubSocketSystem::OnSessionStarted);
+			BoundActions.Add(System->SessionAction);
+		}
+	}
+
+	~FHubSocketSystemTestHarness()
+	{
+		for (const FHubServiceAction& Action : BoundActions)
+		{
+			System->Unbind(Action);
+		}
+		System->PendingRequests.CancelAll();
+		System->OutboundJournal.Close();
+		System->BulkLanes.Reset();
+
+		if (System->Socket.IsValid())
+		{
+			System->Socket->OnConnected().RemoveAll(System);
+			System->Socket->OnClosed().RemoveAll(System);
+			System->Socket->OnConnectionError().RemoveAll(System);
+			System->Socket->OnRawMessage().RemoveAll(System);
+			System->Socket->Close();
+			System->Socket.Reset();
+		}
+		UHubSocketSystem::SetSocketFactory(FHubSocketFactory());
+		Sockets.Reset();
+
+		System->RemoveFromRoot();
+		System->MarkAsGarbage();
+	}
+
+	UHubSocketSystem& GetSystem() const { return *System; }
+
+	// Control connection is 0, bulk lane N is N; sockets exist after Connect
+	FHubLoopbackWebSocket& GetSocket(const int32 Lane = 0) const { return *Sockets[Lane]; }
+
+	const FHubServiceAction& GetResumeAction() const { return System->ResumeAction; }
+	int32 GetJournalNum() const { return System->OutboundJournal.Num(); }
+
+	// Connects control connection and bulk lanes, hub greets every one of them so they are established
+	void Connect()
+	{
+		System->StartConnection(TEXT("loopback://test"));
+		Step();
+		Establish(0);
+
+		// lanes are started by established control connection
+		Step();
+		for (int32 Lane = 1; Lane < Sockets.Num(); ++Lane)
+		{
+			Establish(Lane);
+		}
+	}
+
+	// First frame from hub, its content does not matter
+	void Establish(const int32 Lane = 0)
+	{
+		static const ANSICHAR Greeting[] = "{}";
+		GetSocket(Lane).Deliver(TConstArrayView<uint8>(reinterpret_cast<const uint8*>(Greeting), UE_ARRAY_COUNT(Greeting) - 1));
+		Step();
+	}
+
+	// Stands for authorization service
+	void Authorize()
+	{
+		System->OnAuthorized();
+		Step();
+	}
+
+	void ConnectAndAuthorize()
+	{
+		Connect();
+		Authorize();
+	}
+
+	// Hub pushes session token, lanes are attached to it
+	void StartSession(const FString& Token)
+	{
+		Deliver(0, System->SessionAction, FHubSessionData{Token});
+		Step();
+	}
+
+	// Journal in given file instead of Saved directory, hub confirms records with journal.ack
+	void OpenJournal(const FString& Filename)
+	{
+		System->OutboundJournal.Open(Filename, EHubWireFormat::Json, GetDefault<USocketSettings>()->OutboundJournalMaxBytes);
+		System->JournalAckAction.Fill("journal.ack", EHubControllerType::AUTH);
+		System->Bind<FHubJournalAckData>(System->JournalAckAction).AddUObject(System, &UHubSocketSystem::OnJournalAcknowledged);
+		BoundActions.Add(System->JournalAckAction);
+	}
+
+	// Hub side message, RequestId answers request of the client
+	template <typename T>
+	void Deliver(const int32 Lane, const FHubServiceAction& Key, const T& Data, const int64 RequestId = 0)
+	{
+		FHubEncodeOptions EncodeOptions = System->MakeEncodeOptions();
+		EncodeOptions.RequestId = RequestId;
+
+		TArray<uint8> Message;
+		if (FHubMessageEncoder::Encode(Key, Data, EncodeOptions, Message))
+		{
+			GetSocket(Lane).Deliver(Message);
+		}
+	}
+
+	// Echo of ServerInit action comes back as its response, handler gets the name
+	FHubServiceAction BindEcho(const FString& Method, TArray<FString>& OutReceived)
+	{
+		FHubServiceAction& Action = BoundActions.AddDefaulted_GetRef();
+		Action.Fill(Method, EHubControllerType::AUTH);
+		System->Bind<FBFHubRequestData_ServerInit>(Action).AddLambda([&OutReceived](const FBFHubRequestData_ServerInit& Data)
+		{
+			OutReceived.Add(Data.Name);
+		});
+		return Action;
+	}
+
+	static FBFHubRequestData_ServerInit MakeRequest(const FString& Name, const FString& Region = TEXT("eu-west"))
+	{
+		return FBFHubRequestData_ServerInit{Name, TEXT("password"), TEXT("1.0.12345"), Region};
+	}
+
+	// One game frame: timers fire, queued and batched messages are sent, hub events are delivered
+	void Step()
+	{
+		System->Tick(0.0f);
+		System->FlushOutboundBatch();
+		for (const TSharedRef<FHubLoopbackWebSocket>& Socket : Sockets)
+		{
+			Socket->Pump();
+		}
+	}
+
+	// Steps until condition is met, false on timeout
+	bool StepUntil(TFunctionRef<bool()> Condition, const double TimeoutSeconds = 2.0)
+	{
+		const double EndTime = FPlatformTime::Seconds() + TimeoutSeconds;
+		while (Condition() == false)
+		{
+			if (FPlatformTime::Seconds() > EndTime)
+			{
+				return false;
+			}
+			FPlatformProcess::Sleep(0.005f);
+			Step();
+		}
+		return true;
+	}
+
+private:
+	USocketSettings* Settings = GetMutableDefault<USocketSettings>();
+	// hub side of the tests reads json, reconnect comes within a few steps
+	TGuardValue<EHubWireFormat> WireFormatGuard{Settings->WireFormat, EHubWireFormat::Json};
+	TGuardValue<bool> CompressionGuard{Settings->bCompressionEnabled, false};
+	TGuardValue<bool> BatchingGuard{Settings->bBatchingEnabled, false};
+	TGuardValue<bool> LivenessGuard{Settings->bLivenessCheckEnabled, false};
+	TGuardValue<bool> ReconnectGuard{Settings->bAutoReconnectEnabled, true};
+	TGuardValue<float> ReconnectIntervalGuard{Settings->ReconnectTimeStartInterval, 0.01f};
+
+	FHubLoopbackOptions Options;
+	UHubSocketSystem* System = nullptr;
+	TArray<TSharedRef<FHubLoopbackWebSocket>> Sockets;
+	TArray<FHubServiceAction> BoundActions;
+};
+
+namespace HubSocketSystemTests
+{
+	// Message as hub received it
+	struct FHubMessage
+	{
+		FString Method;
+		// "name" of ServerInit request, "token" of session messages
+		FString Name;
+		FString Token;
+		int64 RequestId = 0;
+		int64 Seq = 0;
+		int64 Jid = 0;
+	};
+
+	// Batch frame gives several messages
+	TArray<FHubMessage> ReadMessages(const TConstArrayView<uint8> Frame)
+	{
+		const FUTF8ToTCHAR Text(reinterpret_cast<const ANSICHAR*>(Frame.GetData()), Frame.Num());
+
+		TArray<FHubMessage> Messages;
+		TSharedPtr<FJsonValue> Value;
+		if (FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(FString(FStringView(Text.Get(), Text.Length()))), Value) == false || Value.IsValid() == false)
+		{
+			return Messages;
+		}
+
+		TArray<TSharedPtr<FJsonValue>> Values;
+		if (Value->Type == EJson::Array)
+		{
+			Values = Value->AsArray();
+		}
+		else
+		{
+			Values.Add(Value);
+		}
+
+		for (const TSharedPtr<FJsonValue>& MessageValue : Values)
+		{
+			const TSharedPtr<FJsonObject> Object = MessageValue->AsObject();
+			if (Object.IsValid() == false)
+			{
+				continue;
+			}
+
+			FHubMessage& Message = Messages.AddDefaulted_GetRef();
+			Object->TryGetStringField(TEXT("method"), Message.Method);
+			Object->TryGetNumberField(TEXT("requestId"), Message.RequestId);
+			Object->TryGetNumberField(TEXT("seq"), Message.Seq);
+			Object->TryGetNumberField(TEXT("jid"), Message.Jid);
+
+			// string encoded payload is json text in "data"
+			TSharedPtr<FJsonObject> Data;
+			FString DataString;
+			if (Object->TryGetStringField(TEXT("data"), DataString))
+			{
+				FJsonSerializer::Deserialize(TJsonReaderFactory<>::Create(DataString), Data);
+			}
+			else
+			{
+				Data = Object->GetObjectField(TEXT("data"));
+			}
+			if (Data.IsValid())
+			{
+				Data->TryGetStringField(TEXT("name"), Message.Name);
+				Data->TryGetStringField(TEXT("token"), Message.Token);
+			}
+		}
+		return Messages;
+	}
+
+	FString JoinNames(const TArray<FHubMessage>& Messages)
+	{
+		return FString::JoinBy(Messages, TEXT(","), [](const FHubMessage& Message) { return Message.Name; });
+	}
+
+	// Letters without repeats, compression does not make frame smaller than pooled capacity
+	FString MakeIncompressibleString(const int32 Length, const int32 Seed)
+	{
+		FRandomStream Random(Seed);
+		FString Result;
+		Result.Reserve(Length);
+		for (int32 Index = 0; Index < Length; ++Index)
+		{
+			Result.AppendChar(static_cast<TCHAR>(TEXT('a') + Random.RandRange(0, 25)));
+		}
+		return Result;
+	}
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHubSocketSystemFragmentedFrameTest, "BFHub.SocketSystem.FragmentedFrame",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHubSocketSystemFragmentedFrameTest::RunTest(const FString& Parameters)
+{
+	// frame over pool capacity is not returned to the pool, reassembly buffer still has to start empty for the next frame
+	FHubLoopbackOptions Options;
+	Options.FragmentSize = 16 * 1024;
+	FHubSocketSystemTestHarness Harness(Options);
+
+	TArray<FString> Received;
+	const FHubServiceAction Action = Harness.BindEcho(TEXT("test.fragment"), Received);
+	Harness.ConnectAndAuthorize();
+
+	const FString BigName = HubSocketSystemTests::MakeIncompressibleString(2 * FHubBufferPool::MaxPooledCapacity, 1);
+	Harness.GetSystem().Send(Action, FHubSocketSystemTestHarness::MakeRequest(BigName));
+	Harness.Step();
+
+	Harness.GetSystem().Send(Action, FHubSocketSystemTestHarness::MakeRequest(TEXT("small")));
+	Harness.Step();
+
+	if (TestEqual(TEXT("Received messages"), Received.Num(), 2))
+	{
+		TestTrue(TEXT("Big frame reassembled"), Received[0] == BigName);
+		TestEqual(TEXT("Small frame after big one"), Received[1], FString(TEXT("small")));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHubSocketSystemReconnectTest, "BFHub.SocketSystem.Reconnect",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHubSocketSystemReconnectTest::RunTest(const FString& Parameters)
+{
+	TArray<FString> Received;
+	FHubSocketSystemTestHarness Harness;
+	UHubSocketSystem& System = Harness.GetSystem();
+
+	const FHubServiceAction Action = Harness.BindEcho(TEXT("test.reconnect"), Received);
+	Harness.ConnectAndAuthorize();
+
+	System.Send(Action, FHubSocketSystemTestHarness::MakeRequest(TEXT("before")));
+	Harness.Step();
+
+	Harness.GetSocket().SimulateClose(1006, TEXT("Loopback test disconnect"));
+	Harness.Step();
+	TestTrue(TEXT("Waiting for reconnect after abnormal close"), System.GetConnectionState() == EBFSocketConnectionState::WaitingForReconnect);
+
+	TestTrue(TEXT("Message queued while disconnected"),
+		System.Send(Action, FHubSocketSystemTestHarness::MakeRequest(TEXT("while closed"))) == EHubSendResult::Queued);
+
+	const bool bReconnected = Harness.StepUntil([&System]() { return System.GetConnectionState() == EBFSocketConnectionState::Connected; });
+	if (TestTrue(TEXT("Reconnected by timer"), bReconnected) == false)
+	{
+		return false;
+	}
+
+	Harness.Establish();
+	TestEqual(TEXT("Authorized message waits for authorization"), Received.Num(), 1);
+
+	Harness.Authorize();
+	Harness.Step();
+
+	TestEqual(TEXT("Received messages"), FString::Join(Received, TEXT(",")), FString(TEXT("before,while closed")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHubSocketSystemSessionResumeTest, "BFHub.SocketSystem.SessionResume",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHubSocketSystemSessionResumeTest::RunTest(const FString& Parameters)
+{
+	using namespace HubSocketSystemTests;
+
+	TGuardValue<bool> SessionGuard(GetMutableDefault<USocketSettings>()->bSessionResumeEnabled, true);
+
+	// hub keeps what it got and answers resume with the last client message it has
+	TArray<FHubMessage> HubReceived;
+	int64 HubAck = 0;
+	FString ResumeToken;
+
+	FHubSocketSystemTestHarness Harness;
+	UHubSocketSystem& System = Harness.GetSystem();
+
+	FHubServiceAction Action;
+	Action.Fill(TEXT("test.session"), EHubControllerType::AUTH);
+
+	Harness.ConnectAndAuthorize();
+	Harness.GetSocket().SetResponder([&](FHubLoopbackWebSocket&, const TConstArrayView<uint8> Frame, bool)
+	{
+		for (FHubMessage& Message : ReadMessages(Frame))
+		{
+			if (Message.Method == TEXT("resume"))
+			{
+				ResumeToken = Message.Token;
+				Harness.Deliver(0, Harness.GetResumeAction(), FHubSessionResumeResponse{HubAck}, Message.RequestId);
+				continue;
+			}
+			HubReceived.Add(MoveTemp(Message));
+		}
+	});
+	Harness.StartSession(TEXT("token-1"));
+
+	System.Send(Action, FHubSocketSystemTestHarness::MakeRequest(TEXT("one")));
+	System.Send(Action, FHubSocketSystemTestHarness::MakeRequest(TEXT("two")));
+	Harness.Step();
+
+	if (TestEqual(TEXT("Hub received numbered messages"), HubReceived.Num(), 2))
+	{
+		TestEqual(TEXT("First sequence number"), HubReceived[0].Seq, int64(1));
+		TestEqual(TEXT("Second sequence number"), HubReceived[1].Seq, int64(2));
+	}
+
+	// second message was lost with connection
+	HubAck = 1;
+	HubReceived.Reset();
+	Harness.GetSocket().SimulateClose(1006, TEXT("Loopback test disconnect"));
+	Harness.Step();
+	System.Send(Action, FHubSocketSystemTestHarness::MakeRequest(TEXT("three")));
+
+	const bool bReconnected = Harness.StepUntil([&System]() { return System.GetConnectionState() == EBFSocketConnectionState::Connected; });
+	if (TestTrue(TEXT("Reconnected by timer"), bReconnected) == false)
+	{
+		return false;
+	}
+
+	// resume instead of credentials, nothing calls Authorize
+	Harness.Establish();
+	Harness.Step();
+	Harness.Step();
+
+	TestEqual(TEXT("Resume sent with session token"), ResumeToken, FString(TEXT("token-1")));
+	TestTrue(TEXT("Authorized by resume"), System.GetConnectionState() == EBFSocketConnectionState::Authorized);
+	TestEqual(TEXT("Only missed message replayed before queued one"), JoinNames(HubReceived), FString(TEXT("two,three")));
+	if (HubReceived.Num() == 2)
+	{
+		TestEqual(TEXT("Replayed message keeps its number"), HubReceived[0].Seq, int64(2));
+		TestEqual(TEXT("Queued message numbered after replay"), HubReceived[1].Seq, int64(3));
+	}
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHubSocketSystemLaneRoutingTest, "BFHub.SocketSystem.LaneRouting",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHubSocketSystemLaneRoutingTest::RunTest(const FString& Parameters)
+{
+	using namespace HubSocketSystemTests;
+
+	TGuardValue<int32> LaneGuard(GetMutableDefault<USocketSettings>()->BulkLaneCount, 1);
+	TGuardValue<bool> SessionGuard(GetMutableDefault<USocketSettings>()->bSessionResumeEnabled, true);
+
+	TArray<FHubMessage> ControlReceived;
+	TArray<FHubMessage> LaneReceived;
+	int32 LaneAttaches = 0;
+
+	FHubSocketSystemTestHarness Harness;
+	UHubSocketSystem& System = Harness.GetSystem();
+
+	FHubActionPolicy LanePolicy;
+	LanePolicy.Lane = 1;
+
+	FHubServiceAction OpenAction;
+	OpenAction.Fill(TEXT("test.open"), EHubControllerType::AUTH);
+	OpenAction.RequiredAuth = false;
+	System.SetActionPolicy(OpenAction, LanePolicy);
+
+	FHubServiceAction AuthAction;
+	AuthAction.Fill(TEXT("test.auth"), EHubControllerType::AUTH);
+	System.SetActionPolicy(AuthAction, LanePolicy);
+
+	Harness.ConnectAndAuthorize();
+	Harness.GetSocket(0).SetResponder([&](FHubLoopbackWebSocket&, const TConstArrayView<uint8> Frame, bool)
+	{
+		ControlReceived.Append(ReadMessages(Frame));
+	});
+	// hub accepts attach with the session token by echo, echo keeps request id
+	Harness.GetSocket(1).SetResponder([&](FHubLoopbackWebSocket& Socket, const TConstArrayView<uint8> Frame, bool)
+	{
+		for (FHubMessage& Message : ReadMessages(Frame))
+		{
+			if (Message.Method == TEXT("lane.attach"))
+			{
+				LaneAttaches += Message.Token == TEXT("token-1") ? 1 : 0;
+				Socket.Deliver(Frame);
+				continue;
+			}
+			LaneReceived.Add(MoveTemp(Message));
+		}
+	});
+
+	const auto SendBoth = [&](const TCHAR* Suffix)
+	{
+		System.Send(OpenAction, FHubSocketSystemTestHarness::MakeRequest(FString::Printf(TEXT("open %s"), Suffix)));
+		System.Send(AuthAction, FHubSocketSystemTestHarness::MakeRequest(FString::Printf(TEXT("auth %s"), Suffix)));
+		Harness.Step();
+	};
+
+	// lane is not attached without session
+	SendBoth(TEXT("before attach"));
+
+	Harness.StartSession(TEXT("token-1"));
+	Harness.Step();
+	TestEqual(TEXT("Lane attached with session token"), LaneAttaches, 1);
+	SendBoth(TEXT("attached"));
+
+	// reconnected lane is a new connection for hub, authorized actions wait for attach again
+	Harness.GetSocket(1).SimulateClose(1006, TEXT("Loopback test lane disconnect"));
+	Harness.Step();
+	SendBoth(TEXT("lane down"));
+
+	const bool bLaneReconnected = Harness.StepUntil([&Harness]() { return Harness.GetSocket(1).IsConnected(); });
+	if (TestTrue(TEXT("Lane reconnected"), bLaneReconnected) == false)
+	{
+		return false;
+	}
+	Harness.Establish(1);
+	Harness.Step();
+	TestEqual(TEXT("Reconnected lane attached again"), LaneAttaches, 2);
+	SendBoth(TEXT("reattached"));
+
+	TestEqual(TEXT("Control connection messages"), JoinNames(ControlReceived),
+		FString(TEXT("auth before attach,open lane down,auth lane down")));
+	TestEqual(TEXT("Lane messages"), JoinNames(LaneReceived),
+		FString(TEXT("open before attach,open attached,auth attached,open reattached,auth reattached")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHubSocketSystemQueueDropCollapseTest, "BFHub.SocketSystem.QueueDropCollapse",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHubSocketSystemQueueDropCollapseTest::RunTest(const FString& Parameters)
+{
+	// a few bulk messages fill the queue
+	TGuardValue<int32> QueueGuard(GetMutableDefault<USocketSettings>()->OutboundQueueMaxBytes, 4 * 1024);
+
+	TArray<FString> Latest;
+	TArray<FString> Status;
+	TArray<FString> Bulk;
+
+	FHubSocketSystemTestHarness Harness;
+	UHubSocketSystem& System = Harness.GetSystem();
+
+	// high priority messages are not dropped for normal ones
+	const FHubServiceAction LatestAction = Harness.BindEcho(TEXT("test.latest"), Latest);
+	FHubActionPolicy LatestPolicy;
+	LatestPolicy.Priority = EHubOutboundPriority::High;
+	LatestPolicy.DropPolicy = EHubDropPolicy::CollapseLatest;
+	System.SetActionPolicy(LatestAction, LatestPolicy);
+
+	const FHubServiceAction StatusAction = Harness.BindEcho(TEXT("test.status"), Status);
+	FHubActionPolicy StatusPolicy;
+	StatusPolicy.Priority = EHubOutboundPriority::High;
+	StatusPolicy.CoalesceBy<FBFHubRequestData_ServerInit>([](const FBFHubRequestData_ServerInit& Data) { return Data.regionId; });
+	System.SetActionPolicy(StatusAction, StatusPolicy);
+
+	const FHubServiceAction BulkAction = Harness.BindEcho(TEXT("test.bulk"), Bulk);
+
+	// nothing is connected, everything waits in the queue
+	for (const TCHAR* Name : {TEXT("latest 1"), TEXT("latest 2"), TEXT("latest 3")})
+	{
+		System.Send(LatestAction, FHubSocketSystemTestHarness::MakeRequest(Name));
+	}
+	System.Send(StatusAction, FHubSocketSystemTestHarness::MakeRequest(TEXT("eu 1"), TEXT("eu")));
+	System.Send(StatusAction, FHubSocketSystemTestHarness::MakeRequest(TEXT("us 1"), TEXT("us")));
+	System.Send(StatusAction, FHubSocketSystemTestHarness::MakeRequest(TEXT("eu 2"), TEXT("eu")));
+
+	// oldest bulk message is dropped first, request waiting in it is failed at once
+	TFuture<THubRequestResult<FBFHubRequestData_ServerInit>> DroppedRequest =
+		System.Request<FBFHubRequestData_ServerInit>(BulkAction, FHubSocketSystemTestHarness::MakeRequest(TEXT("request")));
+
+	const FString Padding = FString::ChrN(1024, TEXT('x'));
+	TArray<FString> BulkSent;
+	for (int32 Index = 0; Index < 8; ++Index)
+	{
+		FBFHubRequestData_ServerInit Request = FHubSocketSystemTestHarness::MakeRequest(FString::Printf(TEXT("bulk %d"), Index));
+		Request.Password = Padding;
+		System.Send(BulkAction, Request);
+		BulkSent.Add(Request.Name);
+	}
+
+	if (TestTrue(TEXT("Dropped request completed"), DroppedRequest.IsReady()))
+	{
+		TestTrue(TEXT("Dropped request failed to send"), DroppedRequest.Get().Status == EHubRequestStatus::SendFailed);
+	}
+
+	Harness.ConnectAndAuthorize();
+	Harness.Step();
+
+	TestEqual(TEXT("Only latest message of collapsed action"), FString::Join(Latest, TEXT(",")), FString(TEXT("latest 3")));
+	if (TestEqual(TEXT("One message per sub key"), Status.Num(), 2))
+	{
+		TestTrue(TEXT("Other sub key kept"), Status.Contains(TEXT("us 1")));
+		TestTrue(TEXT("Same sub key replaced"), Status.Contains(TEXT("eu 2")));
+	}
+
+	TestTrue(TEXT("Oldest bulk messages dropped"), Bulk.Num() > 0 && Bulk.Num() < BulkSent.Num());
+	TestEqual(TEXT("Newest bulk messages kept in order"), FString::Join(Bulk, TEXT(",")),
+		FString::Join(MakeArrayView(BulkSent).Right(Bulk.Num()), TEXT(",")));
+	return true;
+}
+
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FHubSocketSystemJournalReplayTest, "BFHub.SocketSystem.JournalReplay",
+	EAutomationTestFlags::ApplicationContextMask | EAutomationTestFlags::ProductFilter)
+
+bool FHubSocketSystemJournalReplayTest::RunTest(const FString& Parameters)
+{
+	using namespace HubSocketSystemTests;
+
+	// a few messages overflow the queue into the journal
+	TGuardValue<int32> SpillGuard(GetMutableDefault<USocketSettings>()->OutboundJournalSpillBytes, 2 * 1024);
+
+	const FString Directory = FPaths::AutomationTransientDir() / TEXT("HubSocketSystemJournal");
+	IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	ON_SCOPE_EXIT
+	{
+		IFileManager::Get().DeleteDirectory(*Directory, false, true);
+	};
+
+	TArray<FHubMessage> HubReceived;
+	bool bHubAcknowledges = false;
+
+	FHubSocketSystemTestHarness Harness;
+	UHubSocketSystem& System = Harness.GetSystem();
+	Harness.OpenJournal(Directory / TEXT("Outbound.journal"));
+
+	FHubServiceAction Action;
+	Action.Fill(TEXT("test.journal"), EHubControllerType::AUTH);
+
+	Harness.Connect();
+	FHubServiceAction AckAction;
+	AckAction.Fill(TEXT("journal.ack"), EHubControllerType::AUTH);
+	Harness.GetSocket().SetResponder([&](FHubLoopbackWebSocket&, const TConstArrayView<uint8> Frame, bool)
+	{
+		for (FHubMessage& Message : ReadMessages(Frame))
+		{
+			if (bHubAcknowledges && Message.Jid > 0)
+			{
+				Harness.Deliver(0, AckAction, FHubJournalAckData{Message.Jid});
+			}
+			HubReceived.Add(MoveTemp(Message));
+		}
+	});
+
+	const FString Padding = FString::ChrN(400, TEXT('x'));
+	TArray<FString> Sent;
+	for (int32 Index = 0; Index < 10; ++Index)
+	{
+		FBFHubRequestData_ServerInit Request = FHubSocketSystemTestHarness::MakeRequest(FString::Printf(TEXT("journal %d"), Index));
+		Request.Password = Padding;
+		System.Send(Action, Request);
+		Sent.Add(Request.Name);
+	}
+
+	const int32 NumJournaled = Harness.GetJournalNum();
+	if (TestTrue(TEXT("Queue overflow spilled to journal"), NumJournaled > 0 && NumJournaled < Sent.Num()) == false)
+	{
+		return false;
+	}
+
+	// journal is older than queued messages, it goes first
+	Harness.Authorize();
+	Harness.Step();
+	TestEqual(TEXT("Every message sent in order"), JoinNames(HubReceived), FString::Join(Sent, TEXT(",")));
+
+	TArray<int64> Jids;
+	for (const FHubMessage& Message : HubReceived)
+	{
+		if (Message.Jid > 0)
+		{
+			Jids.Add(Message.Jid);
+		}
+	}
+	TestEqual(TEXT("Replayed messages carry journal id"), Jids.Num(), NumJournaled);
+	TestEqual(TEXT("Records kept until hub confirms them"), Harness.GetJournalNum(), NumJournaled);
+
+	// connection lost before confirmation, the same records are replayed with the same ids
+	HubReceived.Reset();
+	bHubAcknowledges = true;
+	Harness.GetSocket().SimulateClose(1006, TEXT("Loopback test disconnect"));
+	Harness.Step();
+
+	const bool bReconnected = Harness.StepUntil([&System]() { return System.GetConnectionState() == EBFSocketConnectionState::Connected; });
+	if (TestTrue(TEXT("Reconnected by timer"), bReconnected) == false)
+	{
+		return false;
+	}
+	Harness.Establish();
+	Harness.Authorize();
+	Harness.Step();
+
+	TestEqual(TEXT("Only journaled messages replayed again"), JoinNames(HubReceived),
+		FString::Join(MakeArrayView(Sent).Left(NumJournaled), TEXT(",")));
+	for (int32 Index = 0; Index < HubReceived.Num() && Index < Jids.Num(); ++Index)
+	{
+		TestEqual(TEXT("Journal id kept across replays"), HubReceived[Index].Jid, Jids[Index]);
+	}
+	TestEqual(TEXT("Confirmed records removed"), Harness.GetJournalNum(), 0);
+	return true;
+}
+
+#endif
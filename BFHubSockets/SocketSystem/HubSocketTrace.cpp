@@ -0,0 +1,86 @@
+﻿#include "HubSocketTrace.h"
+
+#include "ProfilingDebugging/CountersTrace.h"
+#include "ProfilingDebugging/MiscTrace.h"
+
+UE_TRACE_CHANNEL_DEFINE(BFHubChannel);
+
+UE_TRACE_EVENT_BEGIN(BFHub, ConnectionState)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(uint8, State)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(BFHub, RequestBegin)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int64, RequestId)
+	UE_TRACE_EVENT_FIELD(UE::Trace::WideString, Method)
+UE_TRACE_EVENT_END()
+
+UE_TRACE_EVENT_BEGIN(BFHub, RequestEnd)
+	UE_TRACE_EVENT_FIELD(uint64, Cycle)
+	UE_TRACE_EVENT_FIELD(int64, RequestId)
+	UE_TRACE_EVENT_FIELD(uint8, Status)
+UE_TRACE_EVENT_END()
+
+TRACE_DECLARE_INT_COUNTER(BFHub_QueueMessages, TEXT("BFHub/Outbound Queue Messages"));
+TRACE_DECLARE_MEMORY_COUNTER(BFHub_QueueBytes, TEXT("BFHub/Outbound Queue Bytes"));
+TRACE_DECLARE_INT_COUNTER(BFHub_JournalMessages, TEXT("BFHub/Outbound Journal Messages"));
+TRACE_DECLARE_INT_COUNTER(BFHub_BatchMessages, TEXT("BFHub/Outbound Batch Messages"));
+TRACE_DECLARE_INT_COUNTER(BFHub_PendingRequests, TEXT("BFHub/Pending Requests"));
+
+namespace HubSocketTrace
+{
+	void QueueDepths(const FQueueDepths& Depths)
+	{
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(BFHubChannel) == false)
+		{
+			return;
+		}
+
+		TRACE_COUNTER_SET(BFHub_QueueMessages, Depths.QueueMessages);
+		TRACE_COUNTER_SET(BFHub_QueueBytes, Depths.QueueBytes);
+		TRACE_COUNTER_SET(BFHub_JournalMessages, Depths.JournalMessages);
+		TRACE_COUNTER_SET(BFHub_BatchMessages, Depths.BatchMessages);
+		TRACE_COUNTER_SET(BFHub_PendingRequests, Depths.PendingRequests);
+	}
+
+	void ConnectionStateChanged(const uint8 State, const TCHAR* StateName)
+	{
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(BFHubChannel) == false)
+		{
+			return;
+		}
+
+		UE_TRACE_LOG(BFHub, ConnectionState, BFHubChannel)
+			<< ConnectionState.Cycle(FPlatformTime::Cycles64())
+			<< ConnectionState.State(State);
+
+		// visible on timeline of Insights
+		TRACE_BOOKMARK(TEXT("BFHub %s"), StateName);
+	}
+
+	void RequestSent(const int64 RequestId, const FString& Method)
+	{
+		UE_TRACE_LOG(BFHub, RequestBegin, BFHubChannel)
+			<< RequestBegin.Cycle(FPlatformTime::Cycles64())
+			<< RequestBegin.RequestId(RequestId)
+			<< RequestBegin.Method(*Method, Method.Len());
+	}
+
+	FString GetRequestScopeName(const int64 RequestId, const FStringView Suffix)
+	{
+		if (UE_TRACE_CHANNELEXPR_IS_ENABLED(BFHubChannel) == false)
+		{
+			return FString();
+		}
+		return FString::Printf(TEXT("Request %lld %.*s"), RequestId, Suffix.Len(), Suffix.GetData());
+	}
+
+	void RequestCompleted(const int64 RequestId, const uint8 Status)
+	{
+		UE_TRACE_LOG(BFHub, RequestEnd, BFHubChannel)
+			<< RequestEnd.Cycle(FPlatformTime::Cycles64())
+			<< RequestEnd.RequestId(RequestId)
+			<< RequestEnd.Status(Status);
+	}
+}
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+
+/**
+ * Unreal Insights channel of hub socket system, off by default: -trace=default,BFHub or Trace.Enable BFHub
+ * CPU scopes of send and receive path are named by action method, so a hitch can be attributed to a hub message
+ */
+UE_TRACE_CHANNEL_EXTERN(BFHubChannel, BFHUBSOCKETS_API);
+
+#define BFHUB_TRACE_SCOPE(Name) TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL(Name, BFHubChannel)
+// Dynamic name, the text is used only while channel is enabled
+#define BFHUB_TRACE_SCOPE_TEXT(Text) TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(Text, BFHubChannel)
+
+namespace HubSocketTrace
+{
+	struct FQueueDepths
+	{
+		int32 QueueMessages = 0;
+		int64 QueueBytes = 0;
+		int32 JournalMessages = 0;
+		int32 BatchMessages = 0;
+		int32 PendingRequests = 0;
+	};
+
+	// Counters, sent only when changed
+	BFHUBSOCKETS_API void QueueDepths(const FQueueDepths& Depths);
+
+	// Instant event and bookmark of connection state transition
+	BFHUBSOCKETS_API void ConnectionStateChanged(uint8 State, const TCHAR* StateName);
+
+	/** Request and its completion (response, error, timeout, cancel) are linked by RequestId:
+	 * RequestBegin/RequestEnd events of BFHub logger and "Request N" in names of their CPU scopes */
+	BFHUBSOCKETS_API void RequestSent(int64 RequestId, const FString& Method);
+	BFHUBSOCKETS_API void RequestCompleted(int64 RequestId, uint8 Status);
+	// "Request N Suffix" while channel is enabled, empty otherwise
+	BFHUBSOCKETS_API FString GetRequestScopeName(int64 RequestId, FStringView Suffix);
+}
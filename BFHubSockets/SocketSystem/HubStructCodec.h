@@ -0,0 +1,315 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "JsonObjectConverter.h"
+#include "HubMessagePack.h"
+#include "HubUtf8JsonReader.h"
+
+/**
+ * Opt-in codec for hot path structs - fields read and written straight from json stream, without DOM and reflection
+ * Specialize it next to the struct, set bEnabled and implement Read/Write, socket system templates pick it up automatically:
+ *
+ * template <>
+ * struct THubStructCodec<FMyData>
+ * {
+ *	static constexpr bool bEnabled = true;
+ *
+ *	template <typename ReaderType>
+ *	static bool Read(ReaderType& Reader, FMyData& Out)
+ *	{
+ *		return Reader.ReadObject([&Out](ReaderType& Field)
+ *		{
+ *			if (Field.IsField(TEXT("value"))) return Field.Read(Out.Value);
+ *			return Field.Skip();
+ *		});
+ *	}
+ *
+ *	template <typename WriterType>
+ *	static void Write(WriterType& Writer, const FMyData& In)
+ *	{
+ *		Writer.WriteValue(TEXT("value"), In.Value);
+ *	}
+ * };
+ *
+ * Field names must match FJsonObjectConverter naming (first letter lower case, "ID" as "Id")
+ */
+template <typename TStruct>
+struct THubStructCodec
+{
+	static constexpr bool bEnabled = false;
+};
+
+template <typename TStruct>
+bool FHubMessagePackReader::ReadStruct(TStruct& OutStruct)
+{
+	static_assert(THubStructCodec<TStruct>::bEnabled, "Nested struct must have codec too");
+	return TryReadNil() || THubStructCodec<TStruct>::Read(*this, OutStruct);
+}
+
+template <typename TStruct>
+bool FHubUtf8JsonReader::ReadStruct(TStruct& OutStruct)
+{
+	static_assert(THubStructCodec<TStruct>::bEnabled, "Nested struct must have codec too");
+	return TryReadNull() || THubStructCodec<TStruct>::Read(*this, OutStruct);
+}
+
+/**
+ * Thin wrapper over streaming json reader used by codecs
+ */
+template <typename CharType = TCHAR>
+class THubCodecReader
+{
+public:
+	explicit THubCodecReader(const TSharedRef<TJsonReader<CharType>>& InReader)
+		: Reader(InReader)
+	{
+	}
+
+	// Reads root object of the stream into the struct
+	template <typename TStruct>
+	bool ReadRoot(TStruct& OutStruct)
+	{
+		return Reader->ReadNext(Notation) && ReadStruct(OutStruct);
+	}
+
+	// Calls visitor for every field of current object, visitor must consume the value (read or skip)
+	template <typename FieldVisitor>
+	bool ReadObject(FieldVisitor&& Visitor)
+	{
+		if (Notation != EJsonNotation::ObjectStart)
+		{
+			return false;
+		}
+
+		while (Reader->ReadNext(Notation))
+		{
+			if (Notation == EJsonNotation::ObjectEnd)
+			{
+				return true;
+			}
+			if (Notation == EJsonNotation::Error || Visitor(*this) == false)
+			{
+				return false;
+			}
+		}
+
+		return false;
+	}
+
+	bool IsField(const TCHAR* Name) const
+	{
+		return Reader->GetIdentifier().Equals(Name, ESearchCase::IgnoreCase);
+	}
+
+	template <typename TStruct>
+	bool ReadStruct(TStruct& OutStruct)
+	{
+		static_assert(THubStructCodec<TStruct>::bEnabled, "Nested struct must have codec too");
+		return Notation == EJsonNotation::Null || THubStructCodec<TStruct>::Read(*this, OutStruct);
+	}
+
+	bool Read(FString& OutValue) const
+	{
+		if (Notation == EJsonNotation::String)
+		{
+			OutValue = Reader->GetValueAsString();
+			return true;
+		}
+		return Notation == EJsonNotation::Null;
+	}
+
+	bool Read(bool& OutValue) const
+	{
+		if (Notation == EJsonNotation::Boolean)
+		{
+			OutValue = Reader->GetValueAsBoolean();
+			return true;
+		}
+		return Notation == EJsonNotation::Null;
+	}
+
+	bool Read(int32& OutValue) const { return ReadNumber(OutValue); }
+	bool Read(int64& OutValue) const { return ReadNumber(OutValue); }
+	bool Read(float& OutValue) const { return ReadNumber(OutValue); }
+	bool Read(double& OutValue) const { return ReadNumber(OutValue); }
+
+	bool Skip()
+	{
+		if (Notation == EJsonNotation::ObjectStart)
+		{
+			return Reader->SkipObject();
+		}
+		if (Notation == EJsonNotation::ArrayStart)
+		{
+			return Reader->SkipArray();
+		}
+		return Notation != EJsonNotation::Error;
+	}
+
+private:
+	template <typename TNumber>
+	bool ReadNumber(TNumber& OutValue) const
+	{
+		if (Notation == EJsonNotation::Number)
+		{
+			OutValue = static_cast<TNumber>(Reader->GetValueAsNumber());
+			return true;
+		}
+		return Notation == EJsonNotation::Null;
+	}
+
+	TSharedRef<TJsonReader<CharType>> Reader;
+	EJsonNotation Notation = EJsonNotation::Null;
+};
+
+namespace HubStructCodec
+{
+	template <typename TStruct>
+	bool ReadWithReflection(const FStringView Json, TStruct& OutStruct)
+	{
+		TSharedPtr<FJsonObject> JsonObject;
+		const auto JsonReader = TJsonReaderFactory<>::CreateFromView(Json);
+
+		if (!FJsonSerializer::Deserialize(JsonReader, JsonObject) || !JsonObject.IsValid())
+		{
+			return false;
+		}
+
+		return FJsonObjectConverter::JsonObjectToUStruct(JsonObject.ToSharedRef(), &OutStruct);
+	}
+
+	template <typename TStruct>
+	bool ReadWithCodec(const FStringView Json, TStruct& OutStruct)
+	{
+		THubCodecReader<> Reader(TJsonReaderFactory<>::CreateFromView(Json));
+		return Reader.ReadRoot(OutStruct);
+	}
+
+	// Utf-8 json of received frame, read without converting whole text to TCHAR
+	template <typename TStruct>
+	bool ReadWithReflection(const FUtf8StringView Json, TStruct& OutStruct)
+	{
+		TSharedPtr<FJsonObject> JsonObject;
+		const auto JsonReader = TJsonReaderFactory<UTF8CHAR>::CreateFromView(Json);
+
+		if (!FJsonSerializer::Deserialize(JsonReader, JsonObject) || !JsonObject.IsValid())
+		{
+			return false;
+		}
+
+		return FJsonObjectConverter::JsonObjectToUStruct(JsonObject.ToSharedRef(), &OutStruct);
+	}
+
+	template <typename TStruct>
+	bool ReadWithCodec(const FUtf8StringView Json, TStruct& OutStruct)
+	{
+		FHubUtf8JsonReader Reader(Json);
+		return Reader.ReadRoot(OutStruct);
+	}
+
+	template <typename TStruct>
+	bool ReadWithReflection(const TConstArrayView<uint8> MessagePack, TStruct& OutStruct)
+	{
+		TSharedPtr<FJsonValue> JsonValue;
+		FHubMessagePackReader Reader(MessagePack);
+
+		if (Reader.ReadJsonValue(JsonValue) == false || JsonValue->Type != EJson::Object)
+		{
+			return false;
+		}
+
+		return FJsonObjectConverter::JsonObjectToUStruct(JsonValue->AsObject().ToSharedRef(), &OutStruct);
+	}
+
+	template <typename TStruct>
+	bool ReadWithCodec(const TConstArrayView<uint8> MessagePack, TStruct& OutStruct)
+	{
+		FHubMessagePackReader Reader(MessagePack);
+		return Reader.ReadRoot(OutStruct);
+	}
+
+	template <typename TStruct>
+	bool Read(const TConstArrayView<uint8> MessagePack, TStruct& OutStruct)
+	{
+		if constexpr (THubStructCodec<TStruct>::bEnabled)
+		{
+			return ReadWithCodec(MessagePack, OutStruct);
+		}
+		else
+		{
+			return ReadWithReflection(MessagePack, OutStruct);
+		}
+	}
+
+	template <typename TStruct>
+	bool Read(const FStringView Json, TStruct& OutStruct)
+	{
+		if constexpr (THubStructCodec<TStruct>::bEnabled)
+		{
+			return ReadWithCodec(Json, OutStruct);
+		}
+		else
+		{
+			return ReadWithReflection(Json, OutStruct);
+		}
+	}
+
+	template <typename TStruct>
+	bool Read(const FUtf8StringView Json, TStruct& OutStruct)
+	{
+		if constexpr (THubStructCodec<TStruct>::bEnabled)
+		{
+			return ReadWithCodec(Json, OutStruct);
+		}
+		else
+		{
+			return ReadWithReflection(Json, OutStruct);
+		}
+	}
+
+	// Writes struct as json object, with identifier when writer is inside of another object
+	template <typename TStruct, typename WriterType>
+	void WriteWithCodec(WriterType& Writer, const TStruct& InStruct, const TCHAR* Identifier = nullptr)
+	{
+		static_assert(THubStructCodec<TStruct>::bEnabled, "Struct must have codec");
+
+		if (Identifier)
+		{
+			Writer.WriteObjectStart(Identifier);
+		}
+		else
+		{
+			Writer.WriteObjectStart();
+		}
+
+		THubStructCodec<TStruct>::Write(Writer, InStruct);
+		Writer.WriteObjectEnd();
+	}
+
+	template <typename TStruct>
+	bool WriteWithCodec(const TStruct& InStruct, FString& OutJson)
+	{
+		const auto JsonWriter = TJsonWriterFactory<TCHAR, TCondensedJsonPrintPolicy<TCHAR>>::Create(&OutJson);
+		WriteWithCodec(*JsonWriter, InStruct);
+		return JsonWriter->Close();
+	}
+
+	template <typename TStruct>
+	bool WriteWithReflection(const TStruct& InStruct, FString& OutJson)
+	{
+		return FJsonObjectConverter::UStructToJsonObjectString(InStruct, OutJson, 0, 0, 0, nullptr, false);
+	}
+
+	template <typename TStruct>
+	bool Write(const TStruct& InStruct, FString& OutJson)
+	{
+		if constexpr (THubStructCodec<TStruct>::bEnabled)
+		{
+			return WriteWithCodec(InStruct, OutJson);
+		}
+		else
+		{
+			return WriteWithReflection(InStruct, OutJson);
+		}
+	}
+}
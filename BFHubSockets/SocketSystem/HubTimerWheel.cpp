@@ -0,0 +1,135 @@
+﻿#include "HubTimerWheel.h"
+
+FHubTimerWheel::FHubTimerWheel(const double InResolution)
+	: Resolution(InResolution)
+	, StartTime(FPlatformTime::Seconds())
+{
+}
+
+FHubTimerHandle FHubTimerWheel::Schedule(const double Deadline, TUniqueFunction<void()>&& Callback)
+{
+	const uint64 Id = ++LastId;
+
+	FTimer& Timer = Timers.Add(Id);
+	Timer.Deadline = Deadline;
+	Timer.Callback = MoveTemp(Callback);
+
+	Insert(Id, Deadline);
+	return FHubTimerHandle{Id};
+}
+
+bool FHubTimerWheel::Cancel(FHubTimerHandle& Handle)
+{
+	// slot entry is left behind, it is dropped when its slot is processed
+	const bool bRemoved = Handle.IsValid() && Timers.Remove(Handle.Id) > 0;
+	Handle = FHubTimerHandle();
+	return bRemoved;
+}
+
+void FHubTimerWheel::Advance(const double Now)
+{
+	const uint64 TargetTick = GetTick(Now);
+
+	// nothing to wait for, long idle periods are not walked tick by tick, entries of cancelled timers are dropped
+	if (Timers.IsEmpty())
+	{
+		CurrentTick = FMath::Max(CurrentTick, TargetTick);
+		if (bHasEntries)
+		{
+			for (int32 Level = 0; Level < NumLevels; ++Level)
+			{
+				for (TArray<uint64>& Slot : Slots[Level])
+				{
+					Slot.Reset();
+				}
+			}
+			Due.Reset();
+			bHasEntries = false;
+		}
+		return;
+	}
+
+	TArray<uint64> Expired = MoveTemp(Due);
+	while (CurrentTick < TargetTick)
+	{
+		++CurrentTick;
+
+		// upper level slot is spread over lower levels when lower ones wrap around
+		for (int32 Level = 1; Level < NumLevels && (CurrentTick & ((uint64(1) << (SlotBits * Level)) - 1)) == 0; ++Level)
+		{
+			Cascade(Level);
+		}
+
+		Expired.Append(MoveTemp(Slots[0][CurrentTick & (SlotsPerLevel - 1)]));
+		Slots[0][CurrentTick & (SlotsPerLevel - 1)].Reset();
+	}
+	// cascaded timers of the current tick
+	Expired.Append(MoveTemp(Due));
+	Due.Reset();
+
+	for (const uint64 Id : Expired)
+	{
+		FTimer Timer;
+		if (Timers.RemoveAndCopyValue(Id, Timer) == false)
+		{
+			continue;
+		}
+
+		// deadline beyond the last level came back to the wheel before it is due
+		if (Timer.Deadline > Now)
+		{
+			const double Deadline = Timer.Deadline;
+			Timers.Add(Id, MoveTemp(Timer));
+			Insert(Id, Deadline);
+			continue;
+		}
+
+		// removed before the call, callback may schedule the same kind of timer again
+		Timer.Callback();
+	}
+}
+
+uint64 FHubTimerWheel::GetTick(const double Time) const
+{
+	return Time <= StartTime ? 0 : static_cast<uint64>((Time - StartTime) / Resolution);
+}
+
+void FHubTimerWheel::Insert(const uint64 Id, const double Deadline)
+{
+	bHasEntries = true;
+
+	// rounded up, timer never fires before deadline
+	const uint64 Tick = static_cast<uint64>(FMath::CeilToDouble(FMath::Max(0.0, Deadline - StartTime) / Resolution));
+	if (Tick <= CurrentTick)
+	{
+		Due.Add(Id);
+		return;
+	}
+
+	const uint64 Delta = Tick - CurrentTick;
+	for (int32 Level = 0; Level < NumLevels; ++Level)
+	{
+		if (Delta < (uint64(1) << (SlotBits * (Level + 1))) || Level == NumLevels - 1)
+		{
+			// beyond the last level timer waits in the farthest slot and is inserted again from there
+			const uint64 SlotTick = Level == NumLevels - 1 ? FMath::Min(Tick, CurrentTick + (uint64(1) << (SlotBits * NumLevels)) - 1) : Tick;
+			Slots[Level][(SlotTick >> (SlotBits * Level)) & (SlotsPerLevel - 1)].Add(Id);
+			return;
+		}
+	}
+}
+
+void FHubTimerWheel::Cascade(const int32 Level)
+{
+	TArray<uint64>& Slot = Slots[Level][(CurrentTick >> (SlotBits * Level)) & (SlotsPerLevel - 1)];
+	const TArray<uint64> Ids = MoveTemp(Slot);
+	Slot.Reset();
+
+	for (const uint64 Id : Ids)
+	{
+		if (const FTimer* Timer = Timers.Find(Id))
+		{
+			Insert(Id, Timer->Deadline);
+		}
+	}
+}
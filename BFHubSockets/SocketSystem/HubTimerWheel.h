@@ -0,0 +1,68 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+
+// Timer of FHubTimerWheel, stays valid until timer fires or is cancelled
+struct FHubTimerHandle
+{
+	uint64 Id = 0;
+
+	bool IsValid() const { return Id != 0; }
+};
+
+/**
+ * Hierarchical timer wheel of socket system, advanced from its FTSTicker tick, works without world
+ * Every level has SlotsPerLevel slots, slot of level N spans SlotsPerLevel^N ticks of Resolution;
+ * timers move to lower levels as their deadline comes closer, schedule and cancel are O(1)
+ * Timers fire on game thread not earlier than deadline and not later than a tick after it
+ * One-shot: repeating timer is scheduled again by its callback, keepalive kind of timer should check
+ * its own last activity time when it fires instead of being rescheduled on every activity
+ */
+class BFHUBSOCKETS_API FHubTimerWheel
+{
+public:
+	explicit FHubTimerWheel(double InResolution = 0.01);
+
+	// Deadline on FPlatformTime::Seconds clock, passed deadline fires on next Advance
+	FHubTimerHandle Schedule(double Deadline, TUniqueFunction<void()>&& Callback);
+	FHubTimerHandle ScheduleIn(double DelaySeconds, TUniqueFunction<void()>&& Callback) { return Schedule(FPlatformTime::Seconds() + DelaySeconds, MoveTemp(Callback)); }
+
+	// False if timer already fired or was cancelled, handle is reset anyway
+	bool Cancel(FHubTimerHandle& Handle);
+
+	bool IsScheduled(const FHubTimerHandle& Handle) const { return Timers.Contains(Handle.Id); }
+	int32 Num() const { return Timers.Num(); }
+
+	// Fires timers with deadline up to Now
+	void Advance(double Now);
+
+	static constexpr int32 SlotBits = 6;
+	static constexpr int32 SlotsPerLevel = 1 << SlotBits;
+	// 10 ms resolution covers ~46 hours, later deadlines wait in the last level
+	static constexpr int32 NumLevels = 4;
+
+private:
+	struct FTimer
+	{
+		double Deadline = 0.0;
+		TUniqueFunction<void()> Callback;
+	};
+
+	uint64 GetTick(double Time) const;
+	void Insert(uint64 Id, double Deadline);
+	void Cascade(int32 Level);
+
+	double Resolution = 0.01;
+	double StartTime = 0.0;
+	// all ticks up to this one are processed
+	uint64 CurrentTick = 0;
+
+	TMap<uint64, FTimer> Timers;
+	uint64 LastId = 0;
+
+	// ids of timers, cancelled ones are skipped when their slot is processed
+	TArray<uint64> Slots[NumLevels][SlotsPerLevel];
+	// deadline passed when scheduled
+	TArray<uint64> Due;
+	bool bHasEntries = false;
+};
@@ -0,0 +1,184 @@
+﻿#include "HubUtf8JsonReader.h"
+
+FHubUtf8JsonReader::FHubUtf8JsonReader(const FUtf8StringView InJson)
+	: Scanner(InJson)
+{
+}
+
+bool FHubUtf8JsonReader::ReadKey()
+{
+	FUtf8StringView Key;
+	bool bHasEscapes = false;
+	if (Scanner.ReadString(Key, bHasEscapes) == false || Scanner.TryConsume(':') == false)
+	{
+		return false;
+	}
+
+	if (bHasEscapes)
+	{
+		if (HubJson::Unescape(Key, KeyStorage) == false)
+		{
+			return false;
+		}
+		Key = FUtf8StringView(KeyStorage.GetData(), KeyStorage.Num());
+	}
+
+	CurrentKey = Key;
+	return true;
+}
+
+bool FHubUtf8JsonReader::Read(FString& OutValue)
+{
+	if (TryReadNull())
+	{
+		return true;
+	}
+
+	FUtf8StringView Raw;
+	bool bHasEscapes = false;
+	if (Scanner.ReadString(Raw, bHasEscapes) == false)
+	{
+		return false;
+	}
+
+	if (bHasEscapes)
+	{
+		return HubJson::Unescape(Raw, OutValue);
+	}
+
+	OutValue = HubJson::ToString(Raw);
+	return true;
+}
+
+bool FHubUtf8JsonReader::Read(bool& OutValue)
+{
+	if (TryReadNull())
+	{
+		return true;
+	}
+
+	const ANSICHAR Next = Scanner.Peek();
+	if (Next != 't' && Next != 'f')
+	{
+		return false;
+	}
+
+	FUtf8StringView Raw;
+	if (Scanner.SkipValue(Raw) == false)
+	{
+		return false;
+	}
+
+	OutValue = Next == 't';
+	return Raw.Len() == (OutValue ? 4 : 5);
+}
+
+bool FHubUtf8JsonReader::Read(int32& OutValue)
+{
+	int64 Number = 0;
+	if (TryReadNull())
+	{
+		return true;
+	}
+	if (ReadInteger(Number) == false)
+	{
+		return false;
+	}
+	OutValue = static_cast<int32>(Number);
+	return true;
+}
+
+bool FHubUtf8JsonReader::Read(int64& OutValue)
+{
+	return TryReadNull() || ReadInteger(OutValue);
+}
+
+bool FHubUtf8JsonReader::Read(float& OutValue)
+{
+	double Number = 0.0;
+	if (TryReadNull())
+	{
+		return true;
+	}
+	if (ReadNumber(Number) == false)
+	{
+		return false;
+	}
+	OutValue = static_cast<float>(Number);
+	return true;
+}
+
+bool FHubUtf8JsonReader::Read(double& OutValue)
+{
+	return TryReadNull() || ReadNumber(OutValue);
+}
+
+bool FHubUtf8JsonReader::Skip()
+{
+	FUtf8StringView Unused;
+	return Scanner.SkipValue(Unused);
+}
+
+bool FHubUtf8JsonReader::TryReadNull()
+{
+	if (Scanner.Peek() != 'n')
+	{
+		return false;
+	}
+
+	FUtf8StringView Raw;
+	return Scanner.SkipValue(Raw) && HubJson::IsNull(Raw);
+}
+
+bool FHubUtf8JsonReader::ReadNumberText(FUtf8StringView& OutText)
+{
+	const ANSICHAR Next = Scanner.Peek();
+	if (Next != '-' && FChar::IsDigit(Next) == false)
+	{
+		return false;
+	}
+	return Scanner.SkipValue(OutText);
+}
+
+bool FHubUtf8JsonReader::ReadNumber(double& OutValue)
+{
+	FUtf8StringView Text;
+	if (ReadNumberText(Text) == false)
+	{
+		return false;
+	}
+
+	// Atod needs terminated string, numbers are short enough for inline buffer
+	TAnsiStringBuilder<64> Terminated;
+	Terminated.Append(reinterpret_cast<const ANSICHAR*>(Text.GetData()), Text.Len());
+	OutValue = FCStringAnsi::Atod(*Terminated);
+	return true;
+}
+
+bool FHubUtf8JsonReader::ReadInteger(int64& OutValue)
+{
+	FUtf8StringView Text;
+	if (ReadNumberText(Text) == false)
+	{
+		return false;
+	}
+
+	// parsed exactly, int64 ids and timestamps do not fit into double
+	const bool bNegative = Text[0] == '-';
+	int64 Value = 0;
+	for (int32 Index = bNegative ? 1 : 0; Index < Text.Len(); ++Index)
+	{
+		if (THubJsonScanner<UTF8CHAR>::IsDigit(Text[Index]) == false)
+		{
+			// fraction or exponent, truncated the same way as THubCodecReader does
+			TAnsiStringBuilder<64> Terminated;
+			Terminated.Append(reinterpret_cast<const ANSICHAR*>(Text.GetData()), Text.Len());
+			OutValue = static_cast<int64>(FCStringAnsi::Atod(*Terminated));
+			return true;
+		}
+		Value = Value * 10 + (Text[Index] - '0');
+	}
+
+	OutValue = bNegative ? -Value : Value;
+	return true;
+}
@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "HubJsonScanner.h"
+
+/**
+ * Json reader over utf-8 bytes of received frame, has the same API for struct codecs as THubCodecReader
+ * Only string values are converted to TCHAR, numbers and keys are read from the bytes in place
+ * Every Read/Skip consumes exactly one value
+ */
+class BFHUBSOCKETS_API FHubUtf8JsonReader
+{
+public:
+	explicit FHubUtf8JsonReader(FUtf8StringView InJson);
+
+	template <typename TStruct>
+	bool ReadRoot(TStruct& OutStruct)
+	{
+		return ReadStruct(OutStruct);
+	}
+
+	template <typename FieldVisitor>
+	bool ReadObject(FieldVisitor&& Visitor)
+	{
+		if (Scanner.TryConsume('{') == false)
+		{
+			return false;
+		}
+
+		if (Scanner.TryConsume('}'))
+		{
+			return true;
+		}
+
+		do
+		{
+			if (ReadKey() == false || Visitor(*this) == false)
+			{
+				return false;
+			}
+		}
+		while (Scanner.TryConsume(','));
+
+		return Scanner.TryConsume('}');
+	}
+
+	// Field names expected to be ascii
+	bool IsField(const TCHAR* Name) const { return HubJson::IsKey(CurrentKey, Name); }
+
+	template <typename TStruct>
+	bool ReadStruct(TStruct& OutStruct);
+
+	bool Read(FString& OutValue);
+	bool Read(bool& OutValue);
+	bool Read(int32& OutValue);
+	bool Read(int64& OutValue);
+	bool Read(float& OutValue);
+	bool Read(double& OutValue);
+
+	bool Skip();
+
+	bool TryReadNull();
+	bool ReadNumber(double& OutValue);
+	bool ReadInteger(int64& OutValue);
+
+private:
+	// Key and colon, key with escapes is unescaped into KeyStorage
+	bool ReadKey();
+	bool ReadNumberText(FUtf8StringView& OutText);
+
+	THubJsonScanner<UTF8CHAR> Scanner;
+	FUtf8StringView CurrentKey;
+	TArray<UTF8CHAR> KeyStorage;
+};
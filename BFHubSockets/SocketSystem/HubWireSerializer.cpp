@@ -0,0 +1,187 @@
+﻿#include "HubWireSerializer.h"
+
+#include "HubMessageEnvelope.h"
+#include "HubMessagePack.h"
+
+const IHubWireSerializer& IHubWireSerializer::Get(const EHubWireFormat Format)
+{
+	static const FHubJsonWireSerializer Json;
+	static const FHubMessagePackWireSerializer MessagePack;
+
+	return Format == EHubWireFormat::MessagePack ? static_cast<const IHubWireSerializer&>(MessagePack) : Json;
+}
+
+const IHubWireSerializer& IHubWireSerializer::GetForFrame(const TConstArrayView<uint8> Frame)
+{
+	return Get(FHubMessagePackReader::IsMessagePack(Frame) ? EHubWireFormat::MessagePack : EHubWireFormat::Json);
+}
+
+// FHubJsonWireSerializer
+
+namespace HubJsonWireSerializer
+{
+	// Fields start with '{' and have no trailing comma, the rest of condensed object is copied as is
+	bool PrependFields(const TConstArrayView<uint8> Message, TAnsiStringBuilder<64>& Fields, TArray<uint8>& OutMessage)
+	{
+		if (Message.Num() < 2 || Message[0] != '{')
+		{
+			return false;
+		}
+
+		if (Message[1] != '}')
+		{
+			Fields.AppendChar(',');
+		}
+
+		OutMessage.Reset(Fields.Len() + Message.Num() - 1);
+		OutMessage.Append(reinterpret_cast<const uint8*>(Fields.GetData()), Fields.Len());
+		OutMessage.Append(Message.GetData() + 1, Message.Num() - 1);
+		return true;
+	}
+}
+
+void FHubJsonWireSerializer::MakeBatchFrame(const TConstArrayView<TArray<uint8>> Messages, TArray<uint8>& OutFrame) const
+{
+	int32 FrameSize = Messages.Num() + 1;
+	for (const TArray<uint8>& Message : Messages)
+	{
+		FrameSize += Message.Num();
+	}
+
+	OutFrame.Reset(FrameSize);
+	OutFrame.Add('[');
+	for (int32 Index = 0; Index < Messages.Num(); ++Index)
+	{
+		if (Index > 0)
+		{
+			OutFrame.Add(',');
+		}
+		OutFrame.Append(Messages[Index]);
+	}
+	OutFrame.Add(']');
+}
+
+bool FHubJsonWireSerializer::StampSequence(const TConstArrayView<uint8> Message, const int64 Seq, const int64 Ack, TArray<uint8>& OutMessage) const
+{
+	TAnsiStringBuilder<64> Fields;
+	Fields.Appendf("{\"seq\":%lld,\"ack\":%lld", Seq, Ack);
+	return HubJsonWireSerializer::PrependFields(Message, Fields, OutMessage);
+}
+
+bool FHubJsonWireSerializer::StampJournalId(const TConstArrayView<uint8> Message, const int64 JournalId, TArray<uint8>& OutMessage) const
+{
+	TAnsiStringBuilder<64> Fields;
+	Fields.Appendf("{\"jid\":%lld", JournalId);
+	return HubJsonWireSerializer::PrependFields(Message, Fields, OutMessage);
+}
+
+bool FHubJsonWireSerializer::DecodeFrame(const TConstArrayView<uint8> Frame, FHubDecodeArena& Arena, const TFunctionRef<void(const FHubMessageEnvelope&)> Visitor) const
+{
+	// frame bytes are parsed as utf-8 in place, no conversion to TCHAR
+	const FUtf8StringView Text(reinterpret_cast<const UTF8CHAR*>(Frame.GetData()), Frame.Num());
+
+	if (FHubMessageEnvelope::IsBatch(Text) == false)
+	{
+		FHubMessageEnvelope Envelope;
+		if (FHubMessageEnvelope::TryDecode(Text, Arena, Envelope) == false)
+		{
+			return false;
+		}
+
+		Visitor(Envelope);
+		return true;
+	}
+
+	bool bAllDecoded = true;
+	const bool bBatchParsed = FHubMessageEnvelope::ForEachInBatch(Text, [&Arena, &Visitor, &bAllDecoded](const FUtf8StringView Element)
+	{
+		FHubMessageEnvelope Envelope;
+		if (FHubMessageEnvelope::TryDecode(Element, Arena, Envelope))
+		{
+			Visitor(Envelope);
+		}
+		else
+		{
+			bAllDecoded = false;
+		}
+	});
+
+	return bBatchParsed && bAllDecoded;
+}
+
+FString FHubJsonWireSerializer::ToDebugString(const TConstArrayView<uint8> Frame) const
+{
+	const FUTF8ToTCHAR Converted(reinterpret_cast<const ANSICHAR*>(Frame.GetData()), Frame.Num());
+	return FString(Converted.Length(), Converted.Get());
+}
+
+// FHubMessagePackWireSerializer
+
+void FHubMessagePackWireSerializer::MakeBatchFrame(const TConstArrayView<TArray<uint8>> Messages, TArray<uint8>& OutFrame) const
+{
+	int32 FrameSize = 5;
+	for (const TArray<uint8>& Message : Messages)
+	{
+		FrameSize += Message.Num();
+	}
+
+	OutFrame.Reset(FrameSize);
+	FHubMessagePackWriter Writer(OutFrame);
+	Writer.WriteArrayStart();
+	for (const TArray<uint8>& Message : Messages)
+	{
+		Writer.WriteRaw(Message);
+	}
+	Writer.WriteArrayEnd();
+}
+
+bool FHubMessagePackWireSerializer::StampSequence(const TConstArrayView<uint8> Message, const int64 Seq, const int64 Ack, TArray<uint8>& OutMessage) const
+{
+	const TPair<FStringView, int64> Fields[] = {{TEXT("seq"), Seq}, {TEXT("ack"), Ack}};
+	return FHubMessagePackWriter::PrependToMap(Message, Fields, OutMessage);
+}
+
+bool FHubMessagePackWireSerializer::StampJournalId(const TConstArrayView<uint8> Message, const int64 JournalId, TArray<uint8>& OutMessage) const
+{
+	const TPair<FStringView, int64> Fields[] = {{TEXT("jid"), JournalId}};
+	return FHubMessagePackWriter::PrependToMap(Message, Fields, OutMessage);
+}
+
+bool FHubMessagePackWireSerializer::DecodeFrame(const TConstArrayView<uint8> Frame, FHubDecodeArena& Arena, const TFunctionRef<void(const FHubMessageEnvelope&)> Visitor) const
+{
+	if (FHubMessageEnvelope::IsBatch(Frame) == false)
+	{
+		FHubMessageEnvelope Envelope;
+		if (FHubMessageEnvelope::TryDecode(Frame, Envelope) == false)
+		{
+			return false;
+		}
+
+		Visitor(Envelope);
+		return true;
+	}
+
+	bool bAllDecoded = true;
+	const bool bBatchParsed = FHubMessageEnvelope::ForEachInBatch(Frame, [&Visitor, &bAllDecoded](const TConstArrayView<uint8> Element)
+	{
+		FHubMessageEnvelope Envelope;
+		if (FHubMessageEnvelope::TryDecode(Element, Envelope))
+		{
+			Visitor(Envelope);
+		}
+		else
+		{
+			bAllDecoded = false;
+		}
+	});
+
+	return bBatchParsed && bAllDecoded;
+}
+
+FString FHubMessagePackWireSerializer::ToDebugString(const TConstArrayView<uint8> Frame) const
+{
+	// batch array converted the same way as single map
+	FHubMessagePayload Payload;
+	Payload.MessagePack = Frame;
+	return Payload.ToString();
+}
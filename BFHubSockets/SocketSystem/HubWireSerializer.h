@@ -0,0 +1,74 @@
+﻿#pragma once
+
+#include "CoreMinimal.h"
+#include "SocketSettings.h"
+
+class FHubDecodeArena;
+struct FHubMessageEnvelope;
+
+/**
+ * Wire format of hub connection, selected once when socket is created
+ * Typed request data is encoded by FHubMessageEncoder templates, serializer covers everything that does not depend on struct type
+ */
+class BFHUBSOCKETS_API IHubWireSerializer
+{
+public:
+	virtual ~IHubWireSerializer() = default;
+
+	virtual EHubWireFormat GetFormat() const = 0;
+
+	// Sec-WebSocket-Protocol offered to hub on connect
+	virtual FString GetSubprotocol() const = 0;
+
+	// Frames sent as binary websocket frames
+	virtual bool IsBinary() const = 0;
+
+	// Combines several encoded messages into one frame, single message should be sent as is
+	virtual void MakeBatchFrame(TConstArrayView<TArray<uint8>> Messages, TArray<uint8>& OutFrame) const = 0;
+
+	// Copy of encoded message with "seq" and "ack" of resumable session (see FHubSession), message is not encoded again
+	virtual bool StampSequence(TConstArrayView<uint8> Message, int64 Seq, int64 Ack, TArray<uint8>& OutMessage) const = 0;
+
+	// Copy of encoded message with "jid", id of outbound journal record hub dedupes replayed messages by (see FHubOutboundJournal)
+	virtual bool StampJournalId(TConstArrayView<uint8> Message, int64 JournalId, TArray<uint8>& OutMessage) const = 0;
+
+	/** Visits every envelope of single or batch frame, broken envelopes are skipped and make result false
+	 * Scratch strings of envelopes are allocated in the arena, caller resets it after the frame is handled */
+	virtual bool DecodeFrame(TConstArrayView<uint8> Frame, FHubDecodeArena& Arena, TFunctionRef<void(const FHubMessageEnvelope&)> Visitor) const = 0;
+
+	// Json text of the frame for logs
+	virtual FString ToDebugString(TConstArrayView<uint8> Frame) const = 0;
+
+	static const IHubWireSerializer& Get(EHubWireFormat Format);
+
+	// Frames received as bytes (binary or decompressed) may be of either format
+	static const IHubWireSerializer& GetForFrame(TConstArrayView<uint8> Frame);
+};
+
+class BFHUBSOCKETS_API FHubJsonWireSerializer : public IHubWireSerializer
+{
+public:
+	virtual EHubWireFormat GetFormat() const override { return EHubWireFormat::Json; }
+	virtual FString GetSubprotocol() const override { return TEXT("wss"); }
+	virtual bool IsBinary() const override { return false; }
+
+	virtual void MakeBatchFrame(TConstArrayView<TArray<uint8>> Messages, TArray<uint8>& OutFrame) const override;
+	virtual bool StampSequence(TConstArrayView<uint8> Message, int64 Seq, int64 Ack, TArray<uint8>& OutMessage) const override;
+	virtual bool StampJournalId(TConstArrayView<uint8> Message, int64 JournalId, TArray<uint8>& OutMessage) const override;
+	virtual bool DecodeFrame(TConstArrayView<uint8> Frame, FHubDecodeArena& Arena, TFunctionRef<void(const FHubMessageEnvelope&)> Visitor) const override;
+	virtual FString ToDebugString(TConstArrayView<uint8> Frame) const override;
+};
+
+class BFHUBSOCKETS_API FHubMessagePackWireSerializer : public IHubWireSerializer
+{
+public:
+	virtual EHubWireFormat GetFormat() const override { return EHubWireFormat::MessagePack; }
+	virtual FString GetSubprotocol() const override { return TEXT("bfhub.msgpack"); }
+	virtual bool IsBinary() const override { return true; }
+
+	virtual void MakeBatchFrame(TConstArrayView<TArray<uint8>> Messages, TArray<uint8>& OutFrame) const override;
+	virtual bool StampSequence(TConstArrayView<uint8> Message, int64 Seq, int64 Ack, TArray<uint8>& OutMessage) const override;
+	virtual bool StampJournalId(TConstArrayView<uint8> Message, int64 JournalId, TArray<uint8>& OutMessage) const override;
+	virtual bool DecodeFrame(TConstArrayView<uint8> Frame, FHubDecodeArena& Arena, TFunctionRef<void(const FHubMessageEnvelope&)> Visitor) const override;
+	virtual FString ToDebugString(TConstArrayView<uint8> Frame) const override;
+};
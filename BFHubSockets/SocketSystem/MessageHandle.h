@@ -1,17 +1,47 @@
 ﻿#pragma once
 
 #include "CoreMinimal.h"
-#include "JsonObjectConverter.h"
+#include "HubActionMetrics.h"
+#include "HubMessageEnvelope.h"
 #include "HubServicesBaseData.h"
 
+// Where payload converted into struct, broadcast is always on game thread
+enum class EHubDecodeThread : uint8
+{
+	GameThread,
+	Worker,
+};
+
+// Decoded struct on the way from worker thread to game thread broadcast
+struct FHubDecodedMessage
+{
+	virtual ~FHubDecodedMessage() = default;
+};
+
+template <class TStruct>
+struct THubDecodedMessage : FHubDecodedMessage
+{
+	TStruct Structure;
+};
+
 struct FBaseMessageHandle
 {
 	virtual ~FBaseMessageHandle() = default;
 
-	virtual bool HandleMessage(const FString& InMessage) = 0;
+	virtual bool HandleMessage(const FHubMessagePayload& InPayload) = 0;
 	virtual bool HandleError(const FHubErrorData& ErrorData) const = 0;
 
+	// HandleMessage split in two for decoding off the game thread
+	// Decode must be thread safe, returns nullptr if payload not match the struct
+	virtual TUniquePtr<FHubDecodedMessage> DecodeMessage(const FHubMessagePayload& InPayload) const = 0;
+	virtual void DispatchMessage(const FHubDecodedMessage& InMessage) = 0;
+
 	virtual void Clear() = 0;
+
+	EHubDecodeThread DecodeThread = EHubDecodeThread::GameThread;
+
+	// decode and handler timings of the action, set by socket system on bind
+	TSharedPtr<FHubActionMetrics> Metrics;
 };
 
 struct FCallbackErrorHandle : FBaseMessageHandle
@@ -49,25 +79,45 @@ struct FCallbackMessageHandle : FCallbackErrorHandle
 protected:
 	FOnCallback MessageHandler;
 
-	virtual bool HandleMessage(const FString& InMessage) override
+	virtual bool HandleMessage(const FHubMessagePayload& InPayload) override
 	{
 		TStruct Structure;
-		if(InMessage.IsEmpty())
+		if (InPayload.IsEmpty() == false)
 		{
-			MessageHandler.Broadcast(Structure);
-			return true;
-		}
-		if (FJsonObjectConverter::JsonObjectStringToUStruct(InMessage, &Structure))
-		{
-			if (MessageHandler.IsBound())
+			SCOPE_CYCLE_COUNTER(STAT_BFHub_Decode);
+			FHubMetricScope DecodeScope(Metrics.Get(), EHubActionMetric::Decode);
+
+			if (InPayload.ReadStruct(Structure) == false)
 			{
-				MessageHandler.Broadcast(Structure);
+				return false;
 			}
+		}
+
+		SCOPE_CYCLE_COUNTER(STAT_BFHub_Handler);
+		FHubMetricScope HandlerScope(Metrics.Get(), EHubActionMetric::Handler);
+		MessageHandler.Broadcast(Structure);
+		return true;
+	}
 
-			return true;
+	virtual TUniquePtr<FHubDecodedMessage> DecodeMessage(const FHubMessagePayload& InPayload) const override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BFHub_Decode);
+		FHubMetricScope DecodeScope(Metrics.Get(), EHubActionMetric::Decode);
+
+		TUniquePtr<THubDecodedMessage<TStruct>> Message = MakeUnique<THubDecodedMessage<TStruct>>();
+		if (InPayload.IsEmpty() || InPayload.ReadStruct(Message->Structure))
+		{
+			return MoveTemp(Message);
 		}
 
-		return false;
+		return nullptr;
+	}
+
+	virtual void DispatchMessage(const FHubDecodedMessage& InMessage) override
+	{
+		SCOPE_CYCLE_COUNTER(STAT_BFHub_Handler);
+		FHubMetricScope HandlerScope(Metrics.Get(), EHubActionMetric::Handler);
+		MessageHandler.Broadcast(static_cast<const THubDecodedMessage<TStruct>&>(InMessage).Structure);
 	}
 
 	virtual void Clear() override
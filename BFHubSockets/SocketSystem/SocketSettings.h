@@ -5,6 +5,24 @@
 #include "CoreMinimal.h"
 #include "SocketSettings.generated.h"
 
+UENUM(BlueprintType)
+enum class EHubPayloadEncoding : uint8
+{
+	// "data" sent as json string inside of json message, supported by every hub version
+	StringEncoded,
+	// "data" sent as nested json object, message serialized once without escaping
+	NestedObject,
+};
+
+UENUM(BlueprintType)
+enum class EHubWireFormat : uint8
+{
+	// utf-8 json text frames
+	Json,
+	// MessagePack binary frames, requested from hub through websocket subprotocol
+	MessagePack,
+};
+
 UCLASS(Config=Game, DefaultConfig, meta = (DisplayName = "Socket"))
 class BFHUBSOCKETS_API USocketSettings : public UDeveloperSettings
 {
@@ -23,6 +41,115 @@ public:
 	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Reconnect")
 	float ReconnectTimeIncreaseStep = 2.0f;
 
+	/** How request data written into the message
+	 * Receiving accepts both encodings regardless of this setting */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Protocol")
+	EHubPayloadEncoding PayloadEncoding = EHubPayloadEncoding::StringEncoded;
+
+	/** Format of frames, applied when socket is created
+	 * MessagePack always nests "data", PayloadEncoding is used only by json */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Protocol")
+	EHubWireFormat WireFormat = EHubWireFormat::Json;
+
+	// Default time to wait for response of correlated request (UHubSocketSystem::Request)
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Protocol", meta = (ClampMin = 0))
+	float RequestTimeoutSeconds = 10.0f;
+
+	/** Requests sent during the same tick (or batching window) combined into one array frame "[{...},{...}]"
+	 * Hub must accept array frames, inbound array frames are always accepted */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Batching")
+	bool bBatchingEnabled = false;
+
+	// How long first message in batch can wait for others, 0 - batch is sent at the end of tick
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Batching", meta = (ClampMin = 0))
+	float BatchWindowSeconds = 0.0f;
+
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Batching", meta = (ClampMin = 1))
+	int32 MaxBatchMessages = 32;
+
+	/** Messages waiting for connection or authorization are limited by size, see EHubDropPolicy for what is dropped
+	 * 0 - not limited */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Queue", meta = (ClampMin = 0))
+	int32 OutboundQueueMaxBytes = 4 * 1024 * 1024;
+
+	// Services notified to throttle own traffic when queue fill ratio reaches high watermark, and again when it falls below low one
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Queue", meta = (ClampMin = 0, ClampMax = 1))
+	float BackpressureHighWatermark = 0.75f;
+
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Queue", meta = (ClampMin = 0, ClampMax = 1))
+	float BackpressureLowWatermark = 0.5f;
+
+	/** Queued messages are sent during several ticks after reconnect, 0 - not limited
+	 * Budget is checked before each message, so one big message is always sent */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Queue", meta = (ClampMin = 0))
+	int32 QueueDrainMessagesPerTick = 64;
+
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Queue", meta = (ClampMin = 0))
+	int32 QueueDrainBytesPerTick = 256 * 1024;
+
+	/** When in-memory queue reaches OutboundJournalSpillBytes, its oldest least important messages which require authorization spill to file
+	 * File survives restart of the process, messages are sent after next authorization (see FHubOutboundJournal) */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Journal")
+	bool bOutboundJournalEnabled = false;
+
+	// Relative to Saved/HubSockets, every socket system gets own file with role and slot added to the name
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Journal")
+	FString OutboundJournalFile = TEXT("Outbound.journal");
+
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Journal", meta = (ClampMin = 0))
+	int32 OutboundJournalSpillBytes = 1024 * 1024;
+
+	// Messages over the limit are dropped, 0 - not limited
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Outbound Journal", meta = (ClampMin = 0))
+	int64 OutboundJournalMaxBytes = 256 * 1024 * 1024;
+
+	/** Frames bigger than threshold sent as zlib compressed binary frames (see FHubFrameCompression)
+	 * Hub must accept them, compressed inbound frames are always accepted */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Compression")
+	bool bCompressionEnabled = false;
+
+	// Compared with encoded frame size, small frames are not worth compression cost
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Compression", meta = (ClampMin = 0))
+	int32 CompressionThresholdBytes = 1024;
+
+	/** Extra connections to the same hub for actions with FHubActionPolicy::Lane, bulk traffic does not delay control messages then
+	 * Lanes are opened when control connection is established, they send no credentials: actions with RequiredAuth use a lane
+	 * only after it is attached to hub session by its token, so it needs bSessionResumeEnabled; until then they go through control connection */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Lanes", meta = (ClampMin = 0, ClampMax = 4))
+	int32 BulkLaneCount = 0;
+
+	/** Hub issues resume token after authorization and numbers messages, reconnect resumes the session without authorization
+	 * and only messages missed by either side are replayed (see FHubSession). Hub must support it */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Session")
+	bool bSessionResumeEnabled = false;
+
+	// Sent messages kept until hub acknowledges them, session is authorized again when missed messages did not fit, 0 - not limited
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Session", meta = (ClampMin = 0))
+	int64 SessionReplayMaxBytes = 4 * 1024 * 1024;
+
+	/** Control connection silent for keepalive interval gets heartbeat (ping), after missed heartbeats it is considered dead
+	 * and replaced by reconnect, so half-open connection does not keep messages and requests (see FHubLiveness) */
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Liveness")
+	bool bLivenessCheckEnabled = true;
+
+	// Keepalive interval adapts to traffic between these values
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Liveness", meta = (ClampMin = 1))
+	float LivenessMinIntervalSeconds = 5.0f;
+
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Liveness", meta = (ClampMin = 1))
+	float LivenessMaxIntervalSeconds = 20.0f;
+
+	// Minimal wait for heartbeat answer, longer when measured RTT needs it
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Liveness", meta = (ClampMin = 0.5))
+	float LivenessBeatTimeoutSeconds = 4.0f;
+
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Liveness", meta = (ClampMin = 1))
+	int32 LivenessMissedBeats = 2;
+
+	// Per action metrics (BFHub.Metrics) written to log with this period, 0 - only by console command
+	UPROPERTY(GlobalConfig, EditAnywhere, BlueprintReadOnly, Category = "Metrics", meta = (ClampMin = 0))
+	float MetricsLogIntervalSeconds = 0.0f;
+
 	/** Try do not use this way, get actual hub response instead
 	* Fake response useful when hub is not ready and we need to test some logic
 	* But this is dangerous way because we need to keep quality for two version of data  */